@@ -0,0 +1,263 @@
+// -*- C++ -*-
+#ifndef AUTOTUNING_H
+#define AUTOTUNING_H
+
+// the best schedule and grain size for each parallel test on this machine.
+//  an autotuning run times every candidate for every threaded test, at
+//  every number of threads and problem size in its sweep, and for the
+//  kokkos openmp and threads tests, whose chunk size is the grain size, and
+//  keeps the fastest in a tuning file, which it rewrites after each test.
+//  a normal run loads the file and gives each of those tests its tuned
+//  settings, so that every machine runs what's best for it without anyone
+//  working it out by hand.
+//
+//  the file is csv, one line per tuned test:
+//   exercise,section,backend,threads,problemSize,schedule,partitioner,
+//   grainSize,median
+//  where schedule is blank for tests that keep each loop's own, and threads
+//  is 0 for kokkos, which runs on however many it was initialized with.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+
+#include <unistd.h>
+
+#include "Utilities.h"
+#include "LoadBalance.h"
+
+namespace Utilities {
+
+// the tuning file is named after the exercise and the host, so that the
+//  files of every node can sit in a shared directory
+inline
+string
+getDefaultTuningFileName(const string & exerciseName) {
+  char hostName[256] = {0};
+  gethostname(hostName, sizeof(hostName) - 1);
+  return exerciseName + string("_tuning_") + string(hostName) +
+    string(".csv");
+}
+
+// what an autotuning run tries: every grain size, with every omp schedule
+//  or tbb partitioner if they're used.  grain sizes are in iterations of
+//  each test's own loop, so they go from the loop's default up past where
+//  any of the exercises' loops would stop splitting.
+inline
+vector<SchedulingOptions>
+getTuningCandidates(const bool tuneOmpSchedule,
+                    const bool tuneTbbPartitioner) {
+  const unsigned int grainSizes[] = {0, 1, 16, 256, 4096};
+  vector<SchedulingOptions> candidates;
+  if (tuneOmpSchedule == true) {
+    const omp_sched_t ompSchedules[] =
+      {omp_sched_static, omp_sched_dynamic, omp_sched_guided};
+    for (const omp_sched_t ompSchedule : ompSchedules) {
+      for (const unsigned int grainSize : grainSizes) {
+        SchedulingOptions candidate;
+        candidate._overrideOmpSchedule = true;
+        candidate._ompSchedule = ompSchedule;
+        candidate._grainSize = grainSize;
+        candidates.push_back(candidate);
+      }
+    }
+  } else if (tuneTbbPartitioner == true) {
+    const TbbPartitionerType tbbPartitioners[] =
+      {AutoPartitioner, SimplePartitioner, AffinityPartitioner};
+    for (const TbbPartitionerType tbbPartitioner : tbbPartitioners) {
+      for (const unsigned int grainSize : grainSizes) {
+        // a tbb range's grain size is 1 when it's left at 0, so 1 would
+        //  only try the default again
+        if (grainSize == 1) {
+          continue;
+        }
+        // the simple partitioner splits all the way down to the grain
+        //  size, which would be one task per iteration
+        if (tbbPartitioner == SimplePartitioner && grainSize < 16) {
+          continue;
+        }
+        SchedulingOptions candidate;
+        candidate._tbbPartitioner = tbbPartitioner;
+        candidate._grainSize = grainSize;
+        candidates.push_back(candidate);
+      }
+    }
+  } else {
+    for (const unsigned int grainSize : grainSizes) {
+      SchedulingOptions candidate;
+      candidate._grainSize = grainSize;
+      candidates.push_back(candidate);
+    }
+  }
+  return candidates;
+}
+
+struct TunedSchedule {
+
+  TunedSchedule() :
+    _problemSize(0),
+    _medianTime(0) {
+  }
+
+  LargeIndex _problemSize;
+  SchedulingOptions _schedulingOptions;
+  double _medianTime;
+};
+
+class TuningTable {
+public:
+
+  // a missing file is an empty table, because nothing's been tuned yet
+  void
+  load(const string & fileName) {
+    std::ifstream file(fileName.c_str());
+    if (file.is_open() == false) {
+      return;
+    }
+    string line;
+    // skip the header
+    std::getline(file, line);
+    while (std::getline(file, line)) {
+      vector<string> fields;
+      std::istringstream lineStream(line);
+      string field;
+      while (std::getline(lineStream, field, ',')) {
+        fields.push_back(field);
+      }
+      if (fields.size() < 9) {
+        continue;
+      }
+      TunedSchedule tunedSchedule;
+      tunedSchedule._problemSize = atoll(fields[4].c_str());
+      SchedulingOptions & options = tunedSchedule._schedulingOptions;
+      options._overrideOmpSchedule =
+        parseOmpScheduleName(fields[5], &options._ompSchedule);
+      if (parseTbbPartitionerName(fields[6], &options._tbbPartitioner) ==
+          false) {
+        fprintf(stderr, "unknown partitioner %s in tuning file %s\n",
+                fields[6].c_str(), fileName.c_str());
+        exit(1);
+      }
+      options._grainSize = atoi(fields[7].c_str());
+      tunedSchedule._medianTime = atof(fields[8].c_str());
+      _tunedSchedules[makeKey(fields[0], fields[1], fields[2],
+                              atoi(fields[3].c_str()))].push_back(
+                                tunedSchedule);
+    }
+  }
+
+  void
+  save(const string & fileName) const {
+    FILE * file = fopen(fileName.c_str(), "w");
+    if (file == NULL) {
+      fprintf(stderr, "cannot open %s for writing\n", fileName.c_str());
+      exit(1);
+    }
+    fprintf(file, "exercise,section,backend,threads,problemSize,schedule,"
+            "partitioner,grainSize,median\n");
+    for (const std::pair<const string, vector<TunedSchedule> > & entry :
+           _tunedSchedules) {
+      for (const TunedSchedule & tunedSchedule : entry.second) {
+        const SchedulingOptions & options = tunedSchedule._schedulingOptions;
+        fprintf(file, "%s,%lld,%s,%s,%u,%.6e\n",
+                entry.first.c_str(),
+                (long long)tunedSchedule._problemSize,
+                (options._overrideOmpSchedule == true) ?
+                getOmpScheduleName(options._ompSchedule).c_str() : "",
+                getTbbPartitionerName(options._tbbPartitioner).c_str(),
+                options._grainSize,
+                tunedSchedule._medianTime);
+      }
+    }
+    fclose(file);
+  }
+
+  size_t
+  getNumberOfTunedSchedules() const {
+    size_t numberOfTunedSchedules = 0;
+    for (const std::pair<const string, vector<TunedSchedule> > & entry :
+           _tunedSchedules) {
+      numberOfTunedSchedules += entry.second.size();
+    }
+    return numberOfTunedSchedules;
+  }
+
+  // replaces whatever was tuned for exactly this test and problem size
+  void
+  set(const string & exerciseName,
+      const string & sectionName,
+      const string & backendName,
+      const unsigned int numberOfThreads,
+      const TunedSchedule & tunedSchedule) {
+    vector<TunedSchedule> & tunedSchedules =
+      _tunedSchedules[makeKey(exerciseName, sectionName, backendName,
+                              numberOfThreads)];
+    for (TunedSchedule & existing : tunedSchedules) {
+      if (existing._problemSize == tunedSchedule._problemSize) {
+        existing = tunedSchedule;
+        return;
+      }
+    }
+    tunedSchedules.push_back(tunedSchedule);
+  }
+
+  // the schedule tuned for the problem size closest to this one, on a log
+  //  scale, since the best grain size follows the size of the problem.
+  //  returns false if this test was never tuned at this number of threads.
+  bool
+  find(const string & exerciseName,
+       const string & sectionName,
+       const string & backendName,
+       const unsigned int numberOfThreads,
+       const LargeIndex problemSize,
+       TunedSchedule * tunedSchedule) const {
+    const std::map<string, vector<TunedSchedule> >::const_iterator entry =
+      _tunedSchedules.find(makeKey(exerciseName, sectionName, backendName,
+                                   numberOfThreads));
+    if (entry == _tunedSchedules.end() || entry->second.empty() == true) {
+      return false;
+    }
+    double closestDistance = INFINITY;
+    for (const TunedSchedule & candidate : entry->second) {
+      const double distance =
+        std::abs(std::log(double(candidate._problemSize) / problemSize));
+      if (distance < closestDistance) {
+        closestDistance = distance;
+        *tunedSchedule = candidate;
+      }
+    }
+    return true;
+  }
+
+private:
+
+  // the section names end in a space on the command line, which doesn't
+  //  belong in the file
+  static
+  string
+  makeKey(const string & exerciseName,
+          const string & sectionName,
+          const string & backendName,
+          const unsigned int numberOfThreads) {
+    string trimmedSectionName = sectionName;
+    while (trimmedSectionName.empty() == false &&
+           trimmedSectionName[trimmedSectionName.size() - 1] == ' ') {
+      trimmedSectionName.resize(trimmedSectionName.size() - 1);
+    }
+    std::ostringstream key;
+    key << exerciseName << "," << trimmedSectionName << "," << backendName
+        << "," << numberOfThreads;
+    return key.str();
+  }
+
+  std::map<string, vector<TunedSchedule> > _tunedSchedules;
+};
+
+}
+
+#endif // AUTOTUNING_H
@@ -0,0 +1,1074 @@
+// -*- C++ -*-
+#ifndef BENCHMARK_DRIVER_H
+#define BENCHMARK_DRIVER_H
+
+// the parts of main() that every exercise shares.  the problem size, thread
+//  sweeps, backends and repeat policy come from the command line instead of
+//  constants, and each exercise registers its test functors with a
+//  TestRegistry, which runs them over the right sweep for their backend,
+//  checks their answers, and prints and records their timings.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <limits>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <functional>
+#include <thread>
+#include <algorithm>
+
+#include "BenchmarkHarness.h"
+#include "BenchmarkResults.h"
+#include "ThreadAffinity.h"
+#include "ScalingAnalysis.h"
+#include "DatasetCache.h"
+#include "LoadBalance.h"
+#include "Autotuning.h"
+#include "WorkStealingPool.h"
+#include "CpuDispatch.h"
+#include "PerThreadAccumulator.h"
+
+// header files so that i can set the number of threads for tbb.  tbb 2019
+//  made global_control the way to do it, and onetbb took out
+//  task_scheduler_init.
+#include "TbbVersion.h"
+#if TBB_INTERFACE_VERSION >= 11000
+#include <tbb/global_control.h>
+#else
+#include <tbb/task_scheduler_init.h>
+#endif
+
+// header file so that i can set the number of threads for omp
+#include <omp.h>
+
+namespace Utilities {
+
+enum BackendType {SerialBackend,
+                  TbbBackend,
+                  OmpBackend,
+                  StealingBackend,
+                  StdParBackend,
+                  CudaBackend,
+                  KokkosOmpBackend,
+                  KokkosCudaBackend,
+                  KokkosSerialBackend,
+                  KokkosThreadsBackend,
+                  NumberOfBackendTypes};
+
+// the names used on the command line
+inline
+string
+getBackendName(const BackendType backend) {
+  const char * const backendNames[NumberOfBackendTypes] =
+    {"serial", "tbb", "omp", "stealing", "stdpar", "cuda", "kokkos-omp",
+     "kokkos-cuda", "kokkos-serial", "kokkos-threads"};
+  return string(backendNames[backend]);
+}
+
+// 1, 2, 4, ... up to the number of hardware threads, and then that number
+//  itself if it isn't a power of two.
+inline
+vector<unsigned int>
+getDefaultNumberOfThreadsArray() {
+  const unsigned int numberOfHardwareThreads =
+    std::max(1u, std::thread::hardware_concurrency());
+  vector<unsigned int> numberOfThreadsArray;
+  for (unsigned int numberOfThreads = 1;
+       numberOfThreads < numberOfHardwareThreads; numberOfThreads *= 2) {
+    numberOfThreadsArray.push_back(numberOfThreads);
+  }
+  numberOfThreadsArray.push_back(numberOfHardwareThreads);
+  return numberOfThreadsArray;
+}
+
+inline
+vector<unsigned int>
+getDefaultThreadsPerBlockArray() {
+  vector<unsigned int> threadsPerBlockArray;
+  for (unsigned int threadsPerBlock = 4;
+       threadsPerBlock <= 512; threadsPerBlock *= 2) {
+    threadsPerBlockArray.push_back(threadsPerBlock);
+  }
+  return threadsPerBlockArray;
+}
+
+struct DriverOptions {
+
+  DriverOptions() :
+    _problemSize(0),
+    _numberOfThreadsArray(getDefaultNumberOfThreadsArray()),
+    _threadsPerBlockArray(getDefaultThreadsPerBlockArray()),
+    _measureMachinePeaks(true),
+    _scalingMode(StrongScaling),
+    _schedulingFromCommandLine(false),
+    _autotune(false),
+    _overrideInstructionSet(false),
+    _instructionSet(Sse2InstructionSet) {
+    std::fill(_enabledBackends, _enabledBackends + NumberOfBackendTypes, true);
+  }
+
+  LargeIndex _problemSize;
+  // for tbb, omp, the work-stealing pool and the standard algorithms
+  vector<unsigned int> _numberOfThreadsArray;
+  // for cuda
+  vector<unsigned int> _threadsPerBlockArray;
+  // serial is always enabled, because everything else is checked against it
+  bool _enabledBackends[NumberOfBackendTypes];
+  RepeatPolicy _repeatPolicy;
+  // for placing the tests on the roofline
+  bool _measureMachinePeaks;
+  AffinityOptions _affinityOptions;
+  // how the thread sweeps size their problems
+  ScalingMode _scalingMode;
+  // how the tbb, omp, work-stealing and kokkos loops hand out their
+  //  iterations
+  SchedulingOptions _schedulingOptions;
+  // if so, it's used for every test instead of the tuned schedules
+  bool _schedulingFromCommandLine;
+  // search for the best schedule for every threaded test, and save it
+  bool _autotune;
+  // empty for none
+  string _tuningFileName;
+  // where the inputs are kept between runs
+  DatasetCacheOptions _datasetCacheOptions;
+  // if not, the vectorized kernels use the best that the cpu has
+  bool _overrideInstructionSet;
+  InstructionSet _instructionSet;
+  // where to write the timeline of every thread, if anywhere
+  string _traceFileName;
+  ResultsOptions _resultsOptions;
+};
+
+inline
+void
+printDriverUsage(const char * programName,
+                 const LargeIndex defaultProblemSize) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --size n              problem size (default %lld)\n"
+          "  --threads n,n,...     thread counts for tbb, omp, stealing and "
+          "stdpar\n"
+          "                        (default 1,2,4,... up to %u)\n"
+          "  --blocks n,n,...      threads per block for cuda "
+          "(default 4,8,...,512)\n"
+          "  --backends b,b,...    any of tbb,omp,stealing,stdpar,cuda,"
+          "kokkos-omp,\n"
+          "                        kokkos-cuda,kokkos-serial,kokkos-threads, "
+          "or all\n"
+          "                        (default all); backends this build "
+          "doesn't have\n"
+          "                        are skipped\n"
+          "  --warmups n           untimed repeats before the timed ones\n"
+          "  --min-repeats n       timed repeats before checking for "
+          "convergence\n"
+          "  --max-repeats n       most timed repeats\n"
+          "  --target-ci fraction  stop once the 95%% confidence interval "
+          "is within\n"
+          "                        this fraction of the mean\n"
+          "  --time-budget s       most seconds to spend on each test\n"
+          "  --cache cold|warm     flush the cpu caches between repeats "
+          "or not\n"
+          "  --counters on|off     read cycles, instructions and cache, "
+          "branch and tlb\n"
+          "                        misses around every repeat, summed over "
+          "all threads\n"
+          "                        (default off)\n"
+          "  --roofline on|off     measure the machine's peaks at startup "
+          "and report\n"
+          "                        every test against them (default on)\n"
+          "  --affinity policy     none, compact, scatter, one-per-core or "
+          "cpuset:0-3,8,...\n"
+          "                        for pinning threads (default none)\n"
+          "  --scaling strong|weak whether the problem grows with the "
+          "number of threads\n"
+          "                        in the thread sweeps "
+          "(default strong)\n"
+          "  --schedule static|dynamic|guided\n"
+          "                        schedule for every omp loop (default "
+          "each loop's own)\n"
+          "  --partitioner auto|simple|affinity\n"
+          "                        partitioner for the tbb loops "
+          "(default auto)\n"
+          "  --grain-size n        omp and kokkos chunk size and smallest "
+          "tbb or\n"
+          "                        work-stealing range, in iterations of "
+          "each loop\n"
+          "                        (default each loop's own)\n"
+          "  --autotune on|off     time every schedule and grain size for "
+          "the threaded\n"
+          "                        and kokkos tests and save the fastest "
+          "(default off)\n"
+          "  --tuning file|none    tuned schedules to use, and to save to "
+          "when autotuning\n"
+          "                        (default <exercise>_tuning_<host>.csv)\n"
+          "  --isa sse2|avx2|avx512\n"
+          "                        instruction set for the vectorized "
+          "kernels (default the\n"
+          "                        best that the cpu has)\n"
+          "  --dataset-cache dir   keep the inputs in dir between runs "
+          "(default none)\n"
+          "  --json file           where to write the json results\n"
+          "  --csv file            where to write the csv results\n"
+          "  --trace file.json     where to write a chrome trace of every "
+          "thread's spans\n"
+          "                        (default none)\n"
+          "  --baseline file.csv   compare against the results of an "
+          "earlier run\n"
+          "  --threshold fraction  slowdown that counts as a regression\n",
+          programName, (long long)defaultProblemSize,
+          std::max(1u, std::thread::hardware_concurrency()));
+}
+
+// the whole string has to be a number, from the minimum up to what fits in
+//  an unsigned int
+inline
+unsigned int
+parseUnsigned(const string & item, const string & optionName,
+              const unsigned int minimum) {
+  const char * const begin = item.c_str();
+  char * end = NULL;
+  errno = 0;
+  const unsigned long value = strtoul(begin, &end, 10);
+  if (item.empty() == true || item.find('-') != string::npos ||
+      *end != '\0' || errno == ERANGE || value < minimum ||
+      value > std::numeric_limits<unsigned int>::max()) {
+    fprintf(stderr, "invalid value '%s' for %s\n", item.c_str(),
+            optionName.c_str());
+    exit(1);
+  }
+  return value;
+}
+
+// the whole string has to be a finite, positive number
+inline
+double
+parseDouble(const string & item, const string & optionName) {
+  const char * const begin = item.c_str();
+  char * end = NULL;
+  errno = 0;
+  const double value = strtod(begin, &end);
+  // written this way around so that a nan fails too
+  if (item.empty() == true || *end != '\0' || errno == ERANGE ||
+      !(value > 0 && value <= std::numeric_limits<double>::max())) {
+    fprintf(stderr, "invalid value '%s' for %s\n", item.c_str(),
+            optionName.c_str());
+    exit(1);
+  }
+  return value;
+}
+
+inline
+vector<unsigned int>
+parseUnsignedList(const string & list, const string & optionName) {
+  vector<unsigned int> values;
+  std::istringstream listStream(list);
+  string item;
+  while (std::getline(listStream, item, ',')) {
+    values.push_back(parseUnsigned(item, optionName, 1));
+  }
+  if (values.empty() == true) {
+    fprintf(stderr, "%s needs at least one value\n", optionName.c_str());
+    exit(1);
+  }
+  return values;
+}
+
+// the results go to <exerciseName>_results.json and .csv unless told
+//  otherwise.
+inline
+DriverOptions
+parseDriverOptions(const int argc, char * argv[],
+                   const string & exerciseName,
+                   const LargeIndex defaultProblemSize) {
+  DriverOptions options;
+  options._problemSize = defaultProblemSize;
+  options._resultsOptions._jsonFileName =
+    exerciseName + string("_results.json");
+  options._resultsOptions._csvFileName =
+    exerciseName + string("_results.csv");
+  options._tuningFileName = getDefaultTuningFileName(exerciseName);
+
+  for (int argumentIndex = 1; argumentIndex < argc; ++argumentIndex) {
+    const string argument(argv[argumentIndex]);
+    if (argument == "--help" || argumentIndex + 1 >= argc) {
+      printDriverUsage(argv[0], defaultProblemSize);
+      exit(argument == "--help" ? 0 : 1);
+    }
+    const string value(argv[++argumentIndex]);
+    if (argument == "--size") {
+      // a double, so that 1e8 works, but it has to be a whole number that
+      //  fits in an index.  2^63 itself is a double but not an index.
+      const double problemSize = parseDouble(value, argument);
+      if (problemSize != std::floor(problemSize) ||
+          problemSize >=
+          std::ldexp(1., std::numeric_limits<LargeIndex>::digits)) {
+        fprintf(stderr, "invalid value '%s' for %s\n", value.c_str(),
+                argument.c_str());
+        exit(1);
+      }
+      options._problemSize = LargeIndex(problemSize);
+    } else if (argument == "--threads") {
+      options._numberOfThreadsArray = parseUnsignedList(value, argument);
+    } else if (argument == "--blocks") {
+      options._threadsPerBlockArray = parseUnsignedList(value, argument);
+    } else if (argument == "--backends") {
+      const bool enableAll = (value == "all");
+      std::fill(options._enabledBackends + 1,
+                options._enabledBackends + NumberOfBackendTypes, enableAll);
+      std::istringstream listStream(value);
+      string item;
+      while (enableAll == false && std::getline(listStream, item, ',')) {
+        unsigned int backendIndex = 0;
+        while (backendIndex < NumberOfBackendTypes &&
+               getBackendName(BackendType(backendIndex)) != item) {
+          ++backendIndex;
+        }
+        if (backendIndex == NumberOfBackendTypes) {
+          fprintf(stderr, "unknown backend %s\n", item.c_str());
+          exit(1);
+        }
+        options._enabledBackends[backendIndex] = true;
+      }
+    } else if (argument == "--warmups") {
+      options._repeatPolicy._numberOfWarmupRepeats =
+        parseUnsigned(value, argument, 0);
+    } else if (argument == "--min-repeats") {
+      options._repeatPolicy._minimumNumberOfRepeats =
+        parseUnsigned(value, argument, 0);
+    } else if (argument == "--max-repeats") {
+      options._repeatPolicy._maximumNumberOfRepeats =
+        parseUnsigned(value, argument, 1);
+    } else if (argument == "--target-ci") {
+      options._repeatPolicy._targetRelativeConfidenceInterval =
+        parseDouble(value, argument);
+    } else if (argument == "--time-budget") {
+      options._repeatPolicy._timeBudget = parseDouble(value, argument);
+    } else if (argument == "--cache") {
+      if (value == "cold") {
+        options._repeatPolicy._cacheState = ColdCache;
+      } else if (value == "warm") {
+        options._repeatPolicy._cacheState = WarmCache;
+      } else {
+        fprintf(stderr, "--cache must be cold or warm, not %s\n",
+                value.c_str());
+        exit(1);
+      }
+    } else if (argument == "--counters") {
+      if (value == "on") {
+        options._repeatPolicy._collectCounters = true;
+      } else if (value == "off") {
+        options._repeatPolicy._collectCounters = false;
+      } else {
+        fprintf(stderr, "--counters must be on or off, not %s\n",
+                value.c_str());
+        exit(1);
+      }
+    } else if (argument == "--roofline") {
+      if (value == "on") {
+        options._measureMachinePeaks = true;
+      } else if (value == "off") {
+        options._measureMachinePeaks = false;
+      } else {
+        fprintf(stderr, "--roofline must be on or off, not %s\n",
+                value.c_str());
+        exit(1);
+      }
+    } else if (argument == "--affinity") {
+      AffinityOptions & affinityOptions = options._affinityOptions;
+      if (value == "none") {
+        affinityOptions._policy = NoAffinity;
+      } else if (value == "compact") {
+        affinityOptions._policy = CompactAffinity;
+      } else if (value == "scatter") {
+        affinityOptions._policy = ScatterAffinity;
+      } else if (value == "one-per-core") {
+        affinityOptions._policy = OnePerCoreAffinity;
+      } else if (value.compare(0, 7, "cpuset:") == 0) {
+        affinityOptions._policy = CpusetAffinity;
+        affinityOptions._cpus = parseCpuList(value.substr(7));
+      } else {
+        fprintf(stderr, "unknown affinity policy %s\n", value.c_str());
+        exit(1);
+      }
+    } else if (argument == "--scaling") {
+      if (value == "strong") {
+        options._scalingMode = StrongScaling;
+      } else if (value == "weak") {
+        options._scalingMode = WeakScaling;
+      } else {
+        fprintf(stderr, "--scaling must be strong or weak, not %s\n",
+                value.c_str());
+        exit(1);
+      }
+    } else if (argument == "--schedule") {
+      options._schedulingOptions._overrideOmpSchedule = true;
+      options._schedulingFromCommandLine = true;
+      if (parseOmpScheduleName(value,
+                               &options._schedulingOptions._ompSchedule) ==
+          false) {
+        fprintf(stderr, "--schedule must be static, dynamic or guided, "
+                "not %s\n", value.c_str());
+        exit(1);
+      }
+    } else if (argument == "--partitioner") {
+      options._schedulingFromCommandLine = true;
+      if (parseTbbPartitionerName(
+            value, &options._schedulingOptions._tbbPartitioner) == false) {
+        fprintf(stderr, "--partitioner must be auto, simple or affinity, "
+                "not %s\n", value.c_str());
+        exit(1);
+      }
+    } else if (argument == "--grain-size") {
+      options._schedulingFromCommandLine = true;
+      // one grain size for every loop; --autotune is what tries several
+      options._schedulingOptions._grainSize =
+        parseUnsigned(value, argument, 1);
+    } else if (argument == "--isa") {
+      options._overrideInstructionSet = true;
+      if (parseInstructionSetName(value, &options._instructionSet) ==
+          false) {
+        fprintf(stderr, "--isa must be sse2, avx2 or avx512, not %s\n",
+                value.c_str());
+        exit(1);
+      }
+    } else if (argument == "--autotune") {
+      if (value == "on") {
+        options._autotune = true;
+      } else if (value == "off") {
+        options._autotune = false;
+      } else {
+        fprintf(stderr, "--autotune must be on or off, not %s\n",
+                value.c_str());
+        exit(1);
+      }
+    } else if (argument == "--tuning") {
+      options._tuningFileName = (value == "none") ? string() : value;
+    } else if (argument == "--dataset-cache") {
+      options._datasetCacheOptions._directory = value;
+    } else if (argument == "--trace") {
+      options._traceFileName = value;
+    } else if (argument == "--json") {
+      options._resultsOptions._jsonFileName = value;
+    } else if (argument == "--csv") {
+      options._resultsOptions._csvFileName = value;
+    } else if (argument == "--baseline") {
+      options._resultsOptions._baselineFileName = value;
+    } else if (argument == "--threshold") {
+      options._resultsOptions._regressionThreshold =
+        parseDouble(value, argument);
+    } else {
+      fprintf(stderr, "unknown option %s\n", argument.c_str());
+      printDriverUsage(argv[0], defaultProblemSize);
+      exit(1);
+    }
+  }
+
+  if (options._autotune == true && options._tuningFileName.empty() == true) {
+    fprintf(stderr, "--autotune needs a tuning file to save to\n");
+    exit(1);
+  }
+  if (options._repeatPolicy._maximumNumberOfRepeats <
+      std::max(1u, options._repeatPolicy._minimumNumberOfRepeats)) {
+    fprintf(stderr, "--max-repeats must be at least --min-repeats and 1\n");
+    exit(1);
+  }
+  return options;
+}
+
+// holds the options and the results for a whole run.  make one at the top
+//  of main(), and return finish() at the bottom.
+class BenchmarkDriver {
+public:
+
+  BenchmarkDriver(const string & exerciseName,
+                  const int argc, char * argv[],
+                  const LargeIndex defaultProblemSize) :
+    _exerciseName(exerciseName),
+    _options(parseDriverOptions(argc, argv, exerciseName,
+                                defaultProblemSize)),
+    _results(exerciseName),
+    _defaultNumberOfOmpThreads(omp_get_max_threads()) {
+    printf("topology: %s\n",
+           HardwareTopology::getInstance().getDescription().c_str());
+    if (_options._traceFileName.empty() == false) {
+      Tracer::getInstance().enable(_options._traceFileName, _exerciseName);
+    }
+    LoadBalance::getInstance().setSchedulingOptions(
+      _options._schedulingOptions);
+    const string scheduling =
+      describeSchedulingOptions(_options._schedulingOptions);
+    printf("scheduling: %s\n", scheduling.c_str());
+    _results.setScheduling(scheduling);
+    CpuDispatch & cpuDispatch = CpuDispatch::getInstance();
+    if (_options._overrideInstructionSet == true) {
+      cpuDispatch.setInstructionSet(_options._instructionSet);
+    }
+    const string instructionSet =
+      getInstructionSetName(cpuDispatch.getInstructionSet());
+    printf("instruction set: %s, of up to %s on this cpu\n",
+           instructionSet.c_str(),
+           getInstructionSetName(
+             cpuDispatch.getDetectedInstructionSet()).c_str());
+    _results.setInstructionSet(instructionSet);
+    // the default tuning file is picked up from the working directory
+    //  without being asked for, so say which one it was either way
+    if (_options._tuningFileName.empty() == false) {
+      _tuningTable.load(_options._tuningFileName);
+      if (_options._autotune == true) {
+        printf("autotuning into %s\n", _options._tuningFileName.c_str());
+      } else if (_tuningTable.getNumberOfTunedSchedules() > 0) {
+        printf("loaded %zu tuned schedules from %s%s\n",
+               _tuningTable.getNumberOfTunedSchedules(),
+               _options._tuningFileName.c_str(),
+               (_options._schedulingFromCommandLine == true) ?
+               ", overridden by the command line" :
+               " (--tuning none ignores them)");
+      } else {
+        printf("no tuned schedules in %s\n",
+               _options._tuningFileName.c_str());
+      }
+    } else {
+      printf("not using a tuning file\n");
+    }
+    // pin omp's whole pool, which is what kokkos runs on and which makes
+    //  this thread, and so the serial tests, land on the first cpu
+    applyOmpPlacement(computePlacement(_options._affinityOptions,
+                                       _defaultNumberOfOmpThreads));
+    if (_options._measureMachinePeaks == true) {
+      _machinePeaks = measureMachinePeaks();
+      _results.setMachinePeaks(_machinePeaks);
+    }
+  }
+
+  const DriverOptions &
+  getOptions() const {
+    return _options;
+  }
+
+  LargeIndex
+  getProblemSize() const {
+    return _options._problemSize;
+  }
+
+  const RepeatPolicy &
+  getRepeatPolicy() const {
+    return _options._repeatPolicy;
+  }
+
+  bool
+  isBackendEnabled(const BackendType backend) const {
+    return _options._enabledBackends[backend];
+  }
+
+  // adds a test's record and rewrites the results files with everything so
+  //  far, so that a run that stops partway, like on a wrong answer, still
+  //  leaves the tests that finished before it
+  void
+  addRecord(const string & testName,
+            const unsigned int numberOfThreads,
+            const LargeIndex problemSize,
+            const TimingStatistics & timingStatistics,
+            const RooflinePoint & rooflinePoint = RooflinePoint(),
+            const string & placement = string("unpinned")) {
+    _results.addRecord(testName, numberOfThreads, problemSize,
+                       timingStatistics, rooflinePoint, placement);
+    _results.write(_options._resultsOptions);
+  }
+
+  // zero if they weren't measured
+  const MachinePeaks &
+  getMachinePeaks() const {
+    return _machinePeaks;
+  }
+
+  const AffinityOptions &
+  getAffinityOptions() const {
+    return _options._affinityOptions;
+  }
+
+  const DatasetCacheOptions &
+  getDatasetCacheOptions() const {
+    return _options._datasetCacheOptions;
+  }
+
+  const string &
+  getExerciseName() const {
+    return _exerciseName;
+  }
+
+  const TuningTable &
+  getTuningTable() const {
+    return _tuningTable;
+  }
+
+  // keeps a test's tuned schedule and rewrites the tuning file, so that a
+  //  run that stops partway doesn't lose the tests that were tuned before it
+  void
+  setTunedSchedule(const string & sectionName,
+                   const string & backendName,
+                   const unsigned int numberOfThreads,
+                   const TunedSchedule & tunedSchedule) {
+    _tuningTable.set(_exerciseName, sectionName, backendName,
+                     numberOfThreads, tunedSchedule);
+    _tuningTable.save(_options._tuningFileName);
+  }
+
+  // the size of omp's pool before anyone changed it, which is also the
+  //  size of kokkos's
+  unsigned int
+  getDefaultNumberOfOmpThreads() const {
+    return _defaultNumberOfOmpThreads;
+  }
+
+  // writes the results and the tuned schedules and compares the results
+  //  against the baseline, if any.  returns what main should.  the trace is
+  //  written at exit.
+  int
+  finish() const {
+    if (_options._autotune == true) {
+      _tuningTable.save(_options._tuningFileName);
+      printf("wrote the tuned schedules to %s\n",
+             _options._tuningFileName.c_str());
+    }
+    return _results.finish(_options._resultsOptions);
+  }
+
+private:
+  const string _exerciseName;
+  const DriverOptions _options;
+  BenchmarkResults _results;
+  MachinePeaks _machinePeaks;
+  const unsigned int _defaultNumberOfOmpThreads;
+  TuningTable _tuningTable;
+};
+
+// the tests of one section of an exercise, which all compute the same
+//  answer for the same problem size.  a test is registered as a factory that
+//  makes its functor for a given parallelism: the number of threads for tbb,
+//  omp, the work-stealing pool and the standard algorithms, the number of
+//  threads per block for cuda, and 0 for kokkos, which uses whatever it was
+//  initialized with.  the work counts of one run place every test on the
+//  roofline.
+//
+//   TestRegistry<double> registry(&driver, "", numberOfIntervals,
+//                                 WorkCounts(flops, bytes), checkAnswer);
+//   registry.addTest(TbbBackend, [&] (const unsigned int) {
+//       return TbbTestFunctor(integrationBounds, numberOfIntervals);
+//     });
+//   registry.runTests(serialAnswer, serialElapsedTime);
+//
+//  for weak scaling, a section also gives a problem scaler, which rebuilds
+//  the inputs that its factories refer to so that there's the given
+//  multiple of the work, and returns the new size, work and answer.
+//  sections without one are always strong scaled.
+template <class AnswerType>
+struct ScaledProblem {
+
+  ScaledProblem(const LargeIndex problemSize,
+                const WorkCounts & workCounts,
+                const AnswerType & correctAnswer) :
+    _problemSize(problemSize),
+    _workCounts(workCounts),
+    _correctAnswer(correctAnswer) {
+  }
+
+  LargeIndex _problemSize;
+  WorkCounts _workCounts;
+  AnswerType _correctAnswer;
+};
+
+template <class AnswerType>
+class TestRegistry {
+public:
+
+  typedef void (*AnswerChecker)(const AnswerType & correctAnswer,
+                                const AnswerType & testAnswer,
+                                const string & testName);
+
+  typedef std::function<ScaledProblem<AnswerType> (const unsigned int)>
+    ProblemScaler;
+
+  // the section name goes in front of "calculations" in the output, so it
+  //  should be empty or end in a space.
+  TestRegistry(BenchmarkDriver * driver,
+               const string & sectionName,
+               const LargeIndex problemSize,
+               const WorkCounts & workCounts,
+               const AnswerChecker answerChecker) :
+    _driver(driver),
+    _sectionName(sectionName),
+    _problemSize(problemSize),
+    _workCounts(workCounts),
+    _answerChecker(answerChecker) {
+  }
+
+  void
+  setProblemScaler(const ProblemScaler & problemScaler) {
+    _problemScaler = problemScaler;
+  }
+
+  template <class FunctorFactory>
+  void
+  addTest(const BackendType backend,
+          const FunctorFactory & functorFactory) {
+    RegisteredTest test;
+    test._backend = backend;
+    test._run = [functorFactory] (const unsigned int parallelism,
+                                  const RepeatPolicy & repeatPolicy,
+                                  const AnswerType & correctAnswer,
+                                  const AnswerChecker answerChecker,
+                                  TimingStatistics * timingStatistics)
+      -> string {
+      const auto testFunctor = functorFactory(parallelism);
+      AnswerType answer;
+      runTimingTest(testFunctor, repeatPolicy, &answer, timingStatistics);
+      answerChecker(correctAnswer, answer, testFunctor.getName());
+      return testFunctor.getName();
+    };
+    _tests.push_back(test);
+  }
+
+  // time the serial version, which everything else is checked against and
+  //  compared to.
+  template <class TestFunctor>
+  TimingStatistics
+  runSerialTest(const TestFunctor & serialTestFunctor,
+                AnswerType * serialAnswer) {
+    printf("performing %scalculations with serial\n", _sectionName.c_str());
+    TimingStatistics timingStatistics;
+    runTimingTest(serialTestFunctor, _driver->getRepeatPolicy(),
+                  serialAnswer, &timingStatistics);
+    printf("serial time %8.2e\n", timingStatistics._median);
+    recordTest(serialTestFunctor.getName(), 1, timingStatistics,
+               computePlacement(_driver->getAffinityOptions(), 1));
+    return timingStatistics;
+  }
+
+  // and again without flushing the caches in between, to see how much of
+  //  the time went to getting the data out of memory
+  template <class TestFunctor>
+  void
+  runWarmCacheComparison(const TestFunctor & serialTestFunctor,
+                         const TimingStatistics & coldTimingStatistics) {
+    RepeatPolicy warmRepeatPolicy = _driver->getRepeatPolicy();
+    warmRepeatPolicy._cacheState = WarmCache;
+    AnswerType warmAnswer;
+    TimingStatistics warmTimingStatistics;
+    runTimingTest(serialTestFunctor, warmRepeatPolicy,
+                  &warmAnswer, &warmTimingStatistics);
+    printf("serial : cold cache time %8.2e warm cache time %8.2e "
+           "(flushing %zu MB of last-level cache)\n",
+           coldTimingStatistics._median,
+           warmTimingStatistics._median,
+           CacheFlusher::getInstance().getLastLevelCacheSize() >> 20);
+    recordTest(serialTestFunctor.getName() + string(" warm cache"), 1,
+               warmTimingStatistics,
+               computePlacement(_driver->getAffinityOptions(), 1));
+  }
+
+  // run every registered test whose backend is enabled, in the order they
+  //  were registered, over the sweep for its backend.
+  void
+  runTests(const AnswerType & correctAnswer,
+           const double serialElapsedTime) {
+    const DriverOptions & options = _driver->getOptions();
+    const AffinityOptions & affinityOptions = options._affinityOptions;
+    for (const RegisteredTest & test : _tests) {
+      if (_driver->isBackendEnabled(test._backend) == false) {
+        continue;
+      }
+      printf("performing %scalculations with %s\n", _sectionName.c_str(),
+             getBackendName(test._backend).c_str());
+
+      if (test._backend == TbbBackend || test._backend == OmpBackend ||
+          test._backend == StealingBackend ||
+          test._backend == StdParBackend) {
+        const bool weakScaling =
+          options._scalingMode == WeakScaling && bool(_problemScaler);
+        vector<ScalingPoint> scalingPoints;
+        string testName;
+        for (const unsigned int numberOfThreads :
+               options._numberOfThreadsArray) {
+          // weak scaling gives every thread as much work as serial had
+          const ScaledProblem<AnswerType> scaledProblem =
+            (weakScaling == true) ? _problemScaler(numberOfThreads) :
+            ScaledProblem<AnswerType>(_problemSize, _workCounts,
+                                      correctAnswer);
+          const vector<int> placement =
+            computePlacement(affinityOptions, numberOfThreads);
+          const auto runWithThreads =
+            [&] (const RepeatPolicy & repeatPolicy,
+                 TimingStatistics * timingStatistics) -> string {
+            // the caches are flushed between repeats on the test's cpus
+            CacheFlushThreads cacheFlushThreads(numberOfThreads, placement);
+            // gcc's standard library runs the parallel algorithms on tbb
+            if (test._backend == TbbBackend ||
+                test._backend == StdParBackend) {
+              // initialize tbb's threading system for this number of threads
+#if TBB_INTERFACE_VERSION >= 11000
+              tbb::global_control init(
+                tbb::global_control::max_allowed_parallelism,
+                numberOfThreads);
+#else
+              tbb::task_scheduler_init init(numberOfThreads);
+#endif
+              TbbPlacementObserver placementObserver(placement);
+              return test._run(numberOfThreads, repeatPolicy,
+                               scaledProblem._correctAnswer, _answerChecker,
+                               timingStatistics);
+            }
+            if (test._backend == StealingBackend) {
+              WorkStealingPoolInit init(numberOfThreads, placement);
+              return test._run(numberOfThreads, repeatPolicy,
+                               scaledProblem._correctAnswer, _answerChecker,
+                               timingStatistics);
+            }
+            // initialize omp's threading system for this number of threads
+            omp_set_num_threads(numberOfThreads);
+            applyOmpPlacement(placement);
+            return test._run(numberOfThreads, repeatPolicy,
+                             scaledProblem._correctAnswer, _answerChecker,
+                             timingStatistics);
+          };
+          // the standard algorithms have nothing to tune
+          if (options._autotune == true && test._backend != StdParBackend) {
+            tuneSchedule(test._backend, numberOfThreads,
+                         scaledProblem._problemSize, runWithThreads);
+          }
+          applySchedule(test._backend, numberOfThreads,
+                        scaledProblem._problemSize);
+          TimingStatistics timingStatistics;
+          testName = runWithThreads(options._repeatPolicy, &timingStatistics);
+          // everything else gets the schedule from the command line
+          LoadBalance::getInstance().setSchedulingOptions(
+            options._schedulingOptions);
+          addIdleThreads(numberOfThreads,
+                         &timingStatistics._threadActivities);
+          ScalingPoint point;
+          point._numberOfThreads = numberOfThreads;
+          point._problemSize = scaledProblem._problemSize;
+          point._elapsedTime = timingStatistics._median;
+          // with as much more work as the problem actually grew by, which
+          //  for sizes that have to be rounded isn't exactly the threads
+          point._speedup = serialElapsedTime / point._elapsedTime;
+          if (weakScaling == true) {
+            point._speedup *=
+              computeWorkRatio(scaledProblem._workCounts, _workCounts,
+                               numberOfThreads);
+          }
+          scalingPoints.push_back(point);
+          printf("%3u : time %8.2e speedup %8.2e (%%%5.1f of ideal)\n",
+                 numberOfThreads,
+                 point._elapsedTime,
+                 point._speedup,
+                 100. * computeParallelEfficiency(point));
+          recordTest(testName, numberOfThreads, timingStatistics, placement,
+                     scaledProblem._problemSize, scaledProblem._workCounts);
+        }
+        printScalingSummary(testName,
+                            (weakScaling == true) ? WeakScaling :
+                            StrongScaling,
+                            scalingPoints);
+        // put the inputs back the way the other backends expect them
+        if (weakScaling == true) {
+          _problemScaler(1);
+        }
+      } else if (test._backend == CudaBackend) {
+        for (const unsigned int numberOfThreadsPerBlock :
+               options._threadsPerBlockArray) {
+          TimingStatistics timingStatistics;
+          const string testName =
+            test._run(numberOfThreadsPerBlock, options._repeatPolicy,
+                      correctAnswer, _answerChecker, &timingStatistics);
+          const double elapsedTime = timingStatistics._median;
+          printf("%3u : time %8.2e speedup %8.2e\n",
+                 numberOfThreadsPerBlock,
+                 elapsedTime,
+                 serialElapsedTime / elapsedTime);
+          // only the host thread is pinned
+          recordTest(testName, numberOfThreadsPerBlock, timingStatistics,
+                     computePlacement(affinityOptions, 1));
+        }
+      } else {
+        // kokkos's openmp backend runs on all of omp's original pool, which
+        //  the omp tests may have moved around.  kokkos's threads backend
+        //  binds its own pool, and the rest run on this thread.
+        vector<int> placement;
+        if (test._backend == KokkosOmpBackend) {
+          placement = computePlacement(affinityOptions,
+                                       _driver->getDefaultNumberOfOmpThreads());
+          applyOmpPlacement(placement);
+        } else if (test._backend != KokkosThreadsBackend) {
+          placement = computePlacement(affinityOptions, 1);
+        }
+        const auto runOnKokkos =
+          [&] (const RepeatPolicy & repeatPolicy,
+               TimingStatistics * timingStatistics) -> string {
+          return test._run(0, repeatPolicy, correctAnswer, _answerChecker,
+                           timingStatistics);
+        };
+        // only kokkos's openmp and threads backends split their ranges into
+        //  chunks, so they're the ones with a chunk size to tune
+        const bool chunked = test._backend == KokkosOmpBackend ||
+          test._backend == KokkosThreadsBackend;
+        if (chunked == true) {
+          if (options._autotune == true) {
+            tuneSchedule(test._backend, 0, _problemSize, runOnKokkos);
+          }
+          applySchedule(test._backend, 0, _problemSize);
+        }
+        TimingStatistics timingStatistics;
+        const string testName =
+          runOnKokkos(options._repeatPolicy, &timingStatistics);
+        LoadBalance::getInstance().setSchedulingOptions(
+          options._schedulingOptions);
+        addIdleThreads(getNumberOfKokkosThreads(test._backend),
+                       &timingStatistics._threadActivities);
+        const double elapsedTime = timingStatistics._median;
+        printf("%s time %8.2e speedup %8.2e\n",
+               testName.c_str(),
+               elapsedTime,
+               serialElapsedTime / elapsedTime);
+        recordTest(testName, 0, timingStatistics, placement);
+      }
+    }
+  }
+
+private:
+
+  struct RegisteredTest {
+    BackendType _backend;
+    // makes the functor, times it, checks its answer, and returns its name
+    std::function<string (const unsigned int parallelism,
+                          const RepeatPolicy & repeatPolicy,
+                          const AnswerType & correctAnswer,
+                          const AnswerChecker answerChecker,
+                          TimingStatistics * timingStatistics)> _run;
+  };
+
+  // the size of the pool that a kokkos host space's tests mark their chunks
+  //  on, so that the threads that never got one count as idle
+  unsigned int
+  getNumberOfKokkosThreads(const BackendType backend) const {
+    if (backend == KokkosOmpBackend) {
+      return getKokkosNumberOfThreadIndices<Kokkos::OpenMP>();
+    }
+#ifdef HAVE_KOKKOS_THREADS
+    if (backend == KokkosThreadsBackend) {
+      return getKokkosNumberOfThreadIndices<Kokkos::Threads>();
+    }
+#endif
+    return 1;
+  }
+
+  // time every candidate schedule with a short repeat policy, and keep the
+  //  fastest.  the candidates are checked like any other run.
+  template <class RunWithThreads>
+  void
+  tuneSchedule(const BackendType backend,
+               const unsigned int numberOfThreads,
+               const LargeIndex problemSize,
+               const RunWithThreads & runWithThreads) {
+    RepeatPolicy tuningRepeatPolicy = _driver->getRepeatPolicy();
+    tuningRepeatPolicy._minimumNumberOfRepeats =
+      std::min(3u, tuningRepeatPolicy._minimumNumberOfRepeats);
+    tuningRepeatPolicy._maximumNumberOfRepeats =
+      std::max(tuningRepeatPolicy._minimumNumberOfRepeats,
+               std::min(10u, tuningRepeatPolicy._maximumNumberOfRepeats));
+    tuningRepeatPolicy._timeBudget =
+      std::min(1., tuningRepeatPolicy._timeBudget);
+    tuningRepeatPolicy._collectCounters = false;
+    TunedSchedule bestSchedule;
+    bestSchedule._problemSize = problemSize;
+    bestSchedule._medianTime = INFINITY;
+    // the work-stealing and kokkos loops only have a grain size to tune
+    const vector<SchedulingOptions> candidates =
+      getTuningCandidates(backend == OmpBackend, backend == TbbBackend);
+    for (const SchedulingOptions & candidate : candidates) {
+      LoadBalance::getInstance().setSchedulingOptions(candidate);
+      TimingStatistics timingStatistics;
+      runWithThreads(tuningRepeatPolicy, &timingStatistics);
+      if (timingStatistics._median < bestSchedule._medianTime) {
+        bestSchedule._schedulingOptions = candidate;
+        bestSchedule._medianTime = timingStatistics._median;
+      }
+    }
+    printf("      tuned %s, %8.2e over %zu candidates\n",
+           describeSchedulingOptions(
+             bestSchedule._schedulingOptions).c_str(),
+           bestSchedule._medianTime, candidates.size());
+    _driver->setTunedSchedule(_sectionName, getBackendName(backend),
+                              numberOfThreads, bestSchedule);
+  }
+
+  // the tuned schedule for this test if there is one and the command line
+  //  didn't say otherwise, or else the command line's
+  void
+  applySchedule(const BackendType backend,
+                const unsigned int numberOfThreads,
+                const LargeIndex problemSize) {
+    const DriverOptions & options = _driver->getOptions();
+    TunedSchedule tunedSchedule;
+    if (options._schedulingFromCommandLine == false &&
+        _driver->getTuningTable().find(_driver->getExerciseName(),
+                                       _sectionName, getBackendName(backend),
+                                       numberOfThreads, problemSize,
+                                       &tunedSchedule) == true) {
+      LoadBalance::getInstance().setSchedulingOptions(
+        tunedSchedule._schedulingOptions);
+      printf("      using the tuned %s\n",
+             describeSchedulingOptions(
+               tunedSchedule._schedulingOptions).c_str());
+    } else {
+      LoadBalance::getInstance().setSchedulingOptions(
+        options._schedulingOptions);
+    }
+  }
+
+  void
+  recordTest(const string & testName,
+             const unsigned int parallelism,
+             const TimingStatistics & timingStatistics,
+             const vector<int> & placement) {
+    recordTest(testName, parallelism, timingStatistics, placement,
+               _problemSize, _workCounts);
+  }
+
+  void
+  recordTest(const string & testName,
+             const unsigned int parallelism,
+             const TimingStatistics & timingStatistics,
+             const vector<int> & placement,
+             const LargeIndex problemSize,
+             const WorkCounts & workCounts) {
+    printTimingStatistics(timingStatistics);
+    const string placementDescription =
+      describePlacement(_driver->getAffinityOptions(), placement);
+    printf("      placement %s\n", placementDescription.c_str());
+    const RooflinePoint rooflinePoint =
+      computeRooflinePoint(workCounts, timingStatistics._median,
+                           _driver->getMachinePeaks());
+    printRooflinePoint(rooflinePoint);
+    _driver->addRecord(testName,
+                       parallelism,
+                       problemSize,
+                       timingStatistics,
+                       rooflinePoint,
+                       placementDescription);
+  }
+
+  BenchmarkDriver * const _driver;
+  const string _sectionName;
+  const LargeIndex _problemSize;
+  const WorkCounts _workCounts;
+  const AnswerChecker _answerChecker;
+  vector<RegisteredTest> _tests;
+  ProblemScaler _problemScaler;
+};
+
+}
+
+#endif // BENCHMARK_DRIVER_H
@@ -0,0 +1,379 @@
+// -*- C++ -*-
+#ifndef BENCHMARK_HARNESS_H
+#define BENCHMARK_HARNESS_H
+
+// the timing loop that every exercise uses.  rather than averaging a fixed
+//  handful of repeats, it keeps repeating until the 95% confidence interval
+//  on the mean is tight enough (or it runs out of time), and then reports
+//  robust statistics of all the repeats along with how many were outliers.
+//  whatever the functors allocate through the workspace is timed apart from
+//  the repeats, as the test's setup, and the phases that they time are
+//  reported as a breakdown of the repeats, as is how busy each of their
+//  threads was and, on the work-stealing pool, how many tasks they spawned
+//  and stole.
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include "Utilities.h"
+#include "PerformanceCounters.h"
+#include "Workspace.h"
+#include "PhaseTimers.h"
+#include "Tracer.h"
+#include "LoadBalance.h"
+#include "WorkStealingPool.h"
+
+namespace Utilities {
+
+struct RepeatPolicy {
+
+  RepeatPolicy() :
+    _numberOfWarmupRepeats(1),
+    _minimumNumberOfRepeats(5),
+    _maximumNumberOfRepeats(100),
+    _targetRelativeConfidenceInterval(0.02),
+    _timeBudget(10),
+    _cacheState(ColdCache),
+    _collectCounters(false) {
+  }
+
+  // untimed runs before the timed ones
+  unsigned int _numberOfWarmupRepeats;
+  unsigned int _minimumNumberOfRepeats;
+  unsigned int _maximumNumberOfRepeats;
+  // stop once the 95% confidence interval on the mean is within this
+  //  fraction of the mean
+  double _targetRelativeConfidenceInterval;
+  // or once this many seconds have been spent on the test, counting warmups
+  //  and cache flushes
+  double _timeBudget;
+  CacheState _cacheState;
+  // read the hardware counters around every timed repeat
+  bool _collectCounters;
+};
+
+struct TimingStatistics {
+
+  TimingStatistics() :
+    _numberOfRepeats(0),
+    _minimum(0),
+    _median(0),
+    _percentile90(0),
+    _mean(0),
+    _standardDeviation(0),
+    _confidenceInterval(0),
+    _numberOfOutliers(0),
+    _converged(false),
+    _setupTime(0),
+    _numberOfSpawns(0),
+    _numberOfSteals(0) {
+  }
+
+  unsigned int _numberOfRepeats;
+  double _minimum;
+  double _median;
+  double _percentile90;
+  double _mean;
+  double _standardDeviation;
+  // half-width of the 95% confidence interval on the mean
+  double _confidenceInterval;
+  // repeats outside of tukey's fences, 1.5 interquartile ranges beyond the
+  //  quartiles
+  unsigned int _numberOfOutliers;
+  // whether the confidence interval got down to the target
+  bool _converged;
+  // seconds the workspace spent making buffers and views over the whole
+  //  test, warmups included, none of which is in the times above
+  double _setupTime;
+  // per repeat, averaged over the timed repeats
+  vector<PhaseTime> _phaseTimes;
+  // per repeat, averaged over the timed repeats, for the tests that mark
+  //  their chunks
+  vector<ThreadActivity> _threadActivities;
+  // per repeat, averaged over the timed repeats, for the tests that run on
+  //  the work-stealing pool
+  double _numberOfSpawns;
+  double _numberOfSteals;
+  // per repeat, averaged over the timed repeats
+  CounterValues _counterValues;
+};
+
+// two-sided 95% critical values of student's t distribution
+inline
+double
+getStudentTCriticalValue(const unsigned int degreesOfFreedom) {
+  const double criticalValues[30] =
+    {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+     2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+     2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  if (degreesOfFreedom == 0) {
+    return INFINITY;
+  }
+  if (degreesOfFreedom <= 30) {
+    return criticalValues[degreesOfFreedom - 1];
+  }
+  return 1.960;
+}
+
+// linearly interpolated percentile of sorted values
+inline
+double
+computePercentile(const vector<double> & sortedValues,
+                  const double percentile) {
+  const double position = percentile / 100. * (sortedValues.size() - 1);
+  const size_t lowerIndex = size_t(position);
+  const size_t upperIndex = std::min(lowerIndex + 1, sortedValues.size() - 1);
+  const double fraction = position - lowerIndex;
+  return sortedValues[lowerIndex] * (1 - fraction) +
+    sortedValues[upperIndex] * fraction;
+}
+
+inline
+TimingStatistics
+computeTimingStatistics(const vector<double> & times,
+                        const double targetRelativeConfidenceInterval) {
+  TimingStatistics statistics;
+  statistics._numberOfRepeats = times.size();
+  if (times.empty()) {
+    return statistics;
+  }
+
+  vector<double> sortedTimes(times);
+  std::sort(sortedTimes.begin(), sortedTimes.end());
+  statistics._minimum = sortedTimes.front();
+  statistics._median = computePercentile(sortedTimes, 50);
+  statistics._percentile90 = computePercentile(sortedTimes, 90);
+
+  double sum = 0;
+  for (const double time : times) {
+    sum += time;
+  }
+  statistics._mean = sum / times.size();
+  double sumOfSquaredDeviations = 0;
+  for (const double time : times) {
+    sumOfSquaredDeviations +=
+      (time - statistics._mean) * (time - statistics._mean);
+  }
+  if (times.size() > 1) {
+    statistics._standardDeviation =
+      std::sqrt(sumOfSquaredDeviations / (times.size() - 1));
+    statistics._confidenceInterval =
+      getStudentTCriticalValue(times.size() - 1) *
+      statistics._standardDeviation / std::sqrt(double(times.size()));
+  } else {
+    statistics._confidenceInterval = INFINITY;
+  }
+  statistics._converged =
+    statistics._confidenceInterval <=
+    targetRelativeConfidenceInterval * statistics._mean;
+
+  const double firstQuartile = computePercentile(sortedTimes, 25);
+  const double thirdQuartile = computePercentile(sortedTimes, 75);
+  const double interquartileRange = thirdQuartile - firstQuartile;
+  for (const double time : times) {
+    if (time < firstQuartile - 1.5 * interquartileRange ||
+        time > thirdQuartile + 1.5 * interquartileRange) {
+      ++statistics._numberOfOutliers;
+    }
+  }
+  return statistics;
+}
+
+inline
+void
+printTimingStatistics(const TimingStatistics & statistics) {
+  printf("      min %8.2e median %8.2e p90 %8.2e stddev %8.2e "
+         "mean %8.2e +-%5.1f%% (%u repeats, %u outliers%s)\n",
+         statistics._minimum,
+         statistics._median,
+         statistics._percentile90,
+         statistics._standardDeviation,
+         statistics._mean,
+         100. * statistics._confidenceInterval / statistics._mean,
+         statistics._numberOfRepeats,
+         statistics._numberOfOutliers,
+         (statistics._converged == true) ? "" : ", not converged");
+  if (statistics._setupTime > 0) {
+    printf("      setup %8.2e, outside of the repeats\n",
+           statistics._setupTime);
+  }
+  for (const PhaseTime & phaseTime : statistics._phaseTimes) {
+    printf("      phase %-32s %8.2e (%%%5.1f of the mean, %.1f calls)\n",
+           phaseTime._name.c_str(),
+           phaseTime._time,
+           100. * phaseTime._time / statistics._mean,
+           phaseTime._numberOfCalls);
+  }
+  if (statistics._threadActivities.empty() == false) {
+    double totalNumberOfChunks = 0;
+    for (const ThreadActivity & threadActivity :
+           statistics._threadActivities) {
+      totalNumberOfChunks += threadActivity._numberOfChunks;
+    }
+    printf("      imbalance %5.2f over %zu threads, %.1f chunks\n",
+           computeImbalanceFactor(statistics._threadActivities),
+           statistics._threadActivities.size(),
+           totalNumberOfChunks);
+    for (size_t threadIndex = 0;
+         threadIndex < statistics._threadActivities.size(); ++threadIndex) {
+      const ThreadActivity & threadActivity =
+        statistics._threadActivities[threadIndex];
+      printf("      thread %3zu busy %8.2e (%%%5.1f of the mean), "
+             "%.1f chunks\n",
+             threadIndex,
+             threadActivity._busyTime,
+             100. * threadActivity._busyTime / statistics._mean,
+             threadActivity._numberOfChunks);
+    }
+  }
+  if (statistics._numberOfSpawns > 0) {
+    printf("      spawned %.1f tasks, %.1f stolen (%%%5.1f)\n",
+           statistics._numberOfSpawns,
+           statistics._numberOfSteals,
+           100. * statistics._numberOfSteals / statistics._numberOfSpawns);
+  }
+  const CounterValues & counterValues = statistics._counterValues;
+  if (counterValues._collected == false) {
+    return;
+  }
+  printf("     ");
+  for (unsigned int counterIndex = 0;
+       counterIndex < NumberOfCounterTypes; ++counterIndex) {
+    if (counterValues._available[counterIndex] == true) {
+      printf(" %s %8.2e",
+             getCounterName(CounterType(counterIndex)).c_str(),
+             counterValues._values[counterIndex]);
+    } else {
+      printf(" %s n/a", getCounterName(CounterType(counterIndex)).c_str());
+    }
+  }
+  if (counterValues._available[CycleCounter] == true &&
+      counterValues._available[InstructionCounter] == true &&
+      counterValues._values[CycleCounter] > 0) {
+    printf(" ipc %5.2f", counterValues._values[InstructionCounter] /
+           counterValues._values[CycleCounter]);
+  }
+  printf("\n");
+}
+
+template <class TestFunctor, class AnswerType>
+void
+runTimingTest(const TestFunctor & testFunctor,
+              const RepeatPolicy & repeatPolicy,
+              AnswerType * answer,
+              TimingStatistics * timingStatistics) {
+
+  typedef std::chrono::high_resolution_clock Clock;
+  const Clock::time_point startOfTest = Clock::now();
+
+  // nothing that the last test left in the workspace is any use to this one
+  Workspace & workspace = Workspace::getInstance();
+  workspace.release();
+
+  // every repeat is a span on the timeline of the thread that runs it
+  Tracer & tracer = Tracer::getInstance();
+  const char * const traceName = (tracer.isEnabled() == true) ?
+    tracer.internName(testFunctor.getName()) : NULL;
+
+  vector<double> times;
+  times.reserve(repeatPolicy._maximumNumberOfRepeats);
+  CounterValues totalCounterValues;
+  for (unsigned int repeatIndex = 0;
+       repeatIndex < repeatPolicy._numberOfWarmupRepeats +
+         repeatPolicy._maximumNumberOfRepeats; ++repeatIndex) {
+
+    // reset the device
+    resetProcessorForTiming(TestFunctor::ProcessorType,
+                            repeatPolicy._cacheState);
+
+    // the phases, the threads' activity and the tasks only count the timed
+    //  repeats
+    if (repeatIndex == repeatPolicy._numberOfWarmupRepeats) {
+      PhaseTimers::getInstance().reset();
+      LoadBalance::getInstance().reset();
+      WorkStealingPool::getInstance().resetCounts();
+    }
+
+    // run the test, with the counters outside of the timed part
+    if (repeatPolicy._collectCounters == true) {
+      PerformanceCounters::getInstance().start();
+    }
+    const double setupTimeBefore = workspace.getSetupTime();
+    const Clock::time_point tic = Clock::now();
+    {
+      const TraceSpan span(traceName);
+      testFunctor.computeAnswer(answer);
+    }
+    const Clock::time_point toc = Clock::now();
+    const double repeatSetupTime =
+      workspace.getSetupTime() - setupTimeBefore;
+    CounterValues counterValues;
+    if (repeatPolicy._collectCounters == true) {
+      counterValues = PerformanceCounters::getInstance().stop();
+    }
+
+    if (repeatIndex < repeatPolicy._numberOfWarmupRepeats) {
+      continue;
+    }
+    totalCounterValues._collected = counterValues._collected;
+    for (unsigned int counterIndex = 0;
+         counterIndex < NumberOfCounterTypes; ++counterIndex) {
+      totalCounterValues._available[counterIndex] =
+        counterValues._available[counterIndex];
+      totalCounterValues._values[counterIndex] +=
+        counterValues._values[counterIndex];
+    }
+    // only the steady state, which is usually all of it after the warmups
+    const double elapsedTime =
+      std::chrono::duration_cast<std::chrono::duration<double> >(toc -
+                                                                 tic).count();
+    times.push_back(elapsedTime - repeatSetupTime);
+
+    // see if we've done enough
+    if (times.size() >= repeatPolicy._minimumNumberOfRepeats &&
+        computeTimingStatistics(
+          times, repeatPolicy._targetRelativeConfidenceInterval)._converged) {
+      break;
+    }
+    const double timeSpent =
+      std::chrono::duration_cast<std::chrono::duration<double> >(
+        Clock::now() - startOfTest).count();
+    if (timeSpent >= repeatPolicy._timeBudget) {
+      break;
+    }
+  }
+
+  *timingStatistics =
+    computeTimingStatistics(times,
+                            repeatPolicy._targetRelativeConfidenceInterval);
+  timingStatistics->_counterValues = totalCounterValues;
+  timingStatistics->_setupTime = workspace.getSetupTime();
+  timingStatistics->_phaseTimes = PhaseTimers::getInstance().getPhaseTimes();
+  for (PhaseTime & phaseTime : timingStatistics->_phaseTimes) {
+    phaseTime._time /= times.size();
+    phaseTime._numberOfCalls /= times.size();
+  }
+  timingStatistics->_threadActivities =
+    LoadBalance::getInstance().getThreadActivities();
+  for (ThreadActivity & threadActivity :
+         timingStatistics->_threadActivities) {
+    threadActivity._busyTime /= times.size();
+    threadActivity._numberOfChunks /= times.size();
+  }
+  timingStatistics->_numberOfSpawns =
+    double(WorkStealingPool::getInstance().getNumberOfSpawns()) / times.size();
+  timingStatistics->_numberOfSteals =
+    double(WorkStealingPool::getInstance().getNumberOfSteals()) / times.size();
+  workspace.release();
+  for (unsigned int counterIndex = 0;
+       counterIndex < NumberOfCounterTypes; ++counterIndex) {
+    timingStatistics->_counterValues._values[counterIndex] /= times.size();
+  }
+}
+
+}
+
+#endif // BENCHMARK_HARNESS_H
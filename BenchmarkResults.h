@@ -0,0 +1,480 @@
+// -*- C++ -*-
+#ifndef BENCHMARK_RESULTS_H
+#define BENCHMARK_RESULTS_H
+
+// machine-readable records of every timing test, written as json and csv as
+//  each test finishes, and a comparison against the csv from an earlier run so
+//  that slowdowns between releases get caught without diffing terminal
+//  output by hand.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+
+#include <unistd.h>
+
+#include "BenchmarkHarness.h"
+#include "Roofline.h"
+#include "ThreadAffinity.h"
+#include "Tracer.h"
+
+namespace Utilities {
+
+// these come from the command line, see BenchmarkDriver.h
+struct ResultsOptions {
+
+  ResultsOptions() :
+    _regressionThreshold(0.05) {
+  }
+
+  string _jsonFileName;
+  string _csvFileName;
+  // empty if there's nothing to compare against
+  string _baselineFileName;
+  // a test has regressed if its median got slower by more than this fraction
+  double _regressionThreshold;
+};
+
+struct HostMetadata {
+  string _hostName;
+  string _cpuModel;
+  unsigned int _numberOfProcessors;
+  size_t _lastLevelCacheSize;
+  // packages, numa nodes, cores and hardware threads, as hwloc sees them
+  string _topology;
+  string _compiler;
+  // when the run started, in utc
+  string _timestamp;
+  // zero if they weren't measured
+  MachinePeaks _machinePeaks;
+  // how the omp and tbb loops were scheduled, which isn't about the host
+  //  but goes with it
+  string _scheduling;
+  // what the vectorized kernels were dispatched to
+  string _instructionSet;
+};
+
+inline
+HostMetadata
+collectHostMetadata() {
+  HostMetadata metadata;
+
+  char hostName[256] = {0};
+  gethostname(hostName, sizeof(hostName) - 1);
+  metadata._hostName = string(hostName);
+
+  std::ifstream cpuInfo("/proc/cpuinfo");
+  string line;
+  while (std::getline(cpuInfo, line)) {
+    if (line.compare(0, 10, "model name") == 0) {
+      const size_t colonPosition = line.find(':');
+      if (colonPosition != string::npos &&
+          colonPosition + 2 <= line.size()) {
+        metadata._cpuModel = line.substr(colonPosition + 2);
+      }
+      break;
+    }
+  }
+
+  metadata._numberOfProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+  metadata._lastLevelCacheSize = detectLastLevelCacheSize();
+  metadata._topology = HardwareTopology::getInstance().getDescription();
+  metadata._compiler = string(__VERSION__);
+
+  const time_t now = time(NULL);
+  char timestamp[32];
+  strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+  metadata._timestamp = string(timestamp);
+
+  return metadata;
+}
+
+struct BenchmarkRecord {
+  string _testName;
+  // threads for the cpu backends, threads per block for cuda, and 0 for
+  //  backends that use however many threads they were initialized with
+  unsigned int _numberOfThreads;
+  LargeIndex _problemSize;
+  TimingStatistics _timingStatistics;
+  RooflinePoint _rooflinePoint;
+  // where the threads ran, like "compact on cpus 0-7"
+  string _placement;
+};
+
+// json has no inf or nan, so those are written as null
+inline
+string
+formatJsonNumber(const double value) {
+  if (std::isfinite(value) == false) {
+    return string("null");
+  }
+  char formatted[32];
+  snprintf(formatted, sizeof(formatted), "%.6e", value);
+  return string(formatted);
+}
+
+// a csv field that has a comma, a quote or a line break in it is quoted,
+//  with its quotes doubled
+inline
+string
+quoteCsvField(const string & input) {
+  if (input.find_first_of(",\"\r\n") == string::npos) {
+    return input;
+  }
+  string output("\"");
+  for (const char character : input) {
+    if (character == '"') {
+      output += '"';
+    }
+    output += character;
+  }
+  output += '"';
+  return output;
+}
+
+// the other way around
+inline
+vector<string>
+splitCsvLine(const string & line) {
+  vector<string> fields(1);
+  bool quoted = false;
+  for (size_t characterIndex = 0; characterIndex < line.size();
+       ++characterIndex) {
+    const char character = line[characterIndex];
+    if (quoted == true) {
+      if (character == '"' && characterIndex + 1 < line.size() &&
+          line[characterIndex + 1] == '"') {
+        fields.back() += '"';
+        ++characterIndex;
+      } else if (character == '"') {
+        quoted = false;
+      } else {
+        fields.back() += character;
+      }
+    } else if (character == '"') {
+      quoted = true;
+    } else if (character == ',') {
+      fields.push_back(string());
+    } else {
+      fields.back() += character;
+    }
+  }
+  return fields;
+}
+
+class BenchmarkResults {
+public:
+
+  BenchmarkResults(const string & exerciseName) :
+    _exerciseName(exerciseName),
+    _hostMetadata(collectHostMetadata()) {
+  }
+
+  void
+  addRecord(const string & testName,
+            const unsigned int numberOfThreads,
+            const LargeIndex problemSize,
+            const TimingStatistics & timingStatistics,
+            const RooflinePoint & rooflinePoint = RooflinePoint(),
+            const string & placement = string("unpinned")) {
+    BenchmarkRecord record;
+    record._testName = testName;
+    record._numberOfThreads = numberOfThreads;
+    record._problemSize = problemSize;
+    record._timingStatistics = timingStatistics;
+    record._rooflinePoint = rooflinePoint;
+    record._placement = placement;
+    _records.push_back(record);
+  }
+
+  void
+  setMachinePeaks(const MachinePeaks & machinePeaks) {
+    _hostMetadata._machinePeaks = machinePeaks;
+  }
+
+  void
+  setScheduling(const string & scheduling) {
+    _hostMetadata._scheduling = scheduling;
+  }
+
+  void
+  setInstructionSet(const string & instructionSet) {
+    _hostMetadata._instructionSet = instructionSet;
+  }
+
+  void
+  writeJson(const string & fileName) const {
+    FILE * file = fopen(fileName.c_str(), "w");
+    if (file == NULL) {
+      fprintf(stderr, "cannot open %s for writing\n", fileName.c_str());
+      exit(1);
+    }
+    fprintf(file, "{\n");
+    fprintf(file, "  \"exercise\": \"%s\",\n",
+            escapeJsonString(_exerciseName).c_str());
+    fprintf(file, "  \"host\": {\n");
+    fprintf(file, "    \"hostName\": \"%s\",\n",
+            escapeJsonString(_hostMetadata._hostName).c_str());
+    fprintf(file, "    \"cpuModel\": \"%s\",\n",
+            escapeJsonString(_hostMetadata._cpuModel).c_str());
+    fprintf(file, "    \"numberOfProcessors\": %u,\n",
+            _hostMetadata._numberOfProcessors);
+    fprintf(file, "    \"lastLevelCacheSize\": %zu,\n",
+            _hostMetadata._lastLevelCacheSize);
+    fprintf(file, "    \"topology\": \"%s\",\n",
+            escapeJsonString(_hostMetadata._topology).c_str());
+    fprintf(file, "    \"compiler\": \"%s\",\n",
+            escapeJsonString(_hostMetadata._compiler).c_str());
+    fprintf(file, "    \"timestamp\": \"%s\",\n",
+            escapeJsonString(_hostMetadata._timestamp).c_str());
+    fprintf(file, "    \"triadBandwidth\": %s,\n",
+            formatJsonNumber(_hostMetadata._machinePeaks._bandwidth).c_str());
+    fprintf(file, "    \"flopRate\": %s,\n",
+            formatJsonNumber(_hostMetadata._machinePeaks._flopRate).c_str());
+    fprintf(file, "    \"scheduling\": \"%s\",\n",
+            escapeJsonString(_hostMetadata._scheduling).c_str());
+    fprintf(file, "    \"instructionSet\": \"%s\"\n",
+            escapeJsonString(_hostMetadata._instructionSet).c_str());
+    fprintf(file, "  },\n");
+    fprintf(file, "  \"records\": [");
+    for (size_t recordIndex = 0; recordIndex < _records.size();
+         ++recordIndex) {
+      const BenchmarkRecord & record = _records[recordIndex];
+      const TimingStatistics & statistics = record._timingStatistics;
+      fprintf(file, "%s\n    {\"test\": \"%s\", \"threads\": %u, "
+              "\"problemSize\": %lld, \"repeats\": %u, "
+              "\"min\": %s, \"median\": %s, \"p90\": %s, "
+              "\"mean\": %s, \"stddev\": %s, \"ci95\": %s, "
+              "\"outliers\": %u, \"converged\": %s, \"setup\": %s, "
+              "\"placement\": \"%s\"",
+              (recordIndex == 0) ? "" : ",",
+              escapeJsonString(record._testName).c_str(),
+              record._numberOfThreads,
+              (long long)record._problemSize,
+              statistics._numberOfRepeats,
+              formatJsonNumber(statistics._minimum).c_str(),
+              formatJsonNumber(statistics._median).c_str(),
+              formatJsonNumber(statistics._percentile90).c_str(),
+              formatJsonNumber(statistics._mean).c_str(),
+              formatJsonNumber(statistics._standardDeviation).c_str(),
+              formatJsonNumber(statistics._confidenceInterval).c_str(),
+              statistics._numberOfOutliers,
+              (statistics._converged == true) ? "true" : "false",
+              formatJsonNumber(statistics._setupTime).c_str(),
+              escapeJsonString(record._placement).c_str());
+      const CounterValues & counterValues = statistics._counterValues;
+      if (counterValues._collected == true) {
+        // unavailable counters are left out
+        fprintf(file, ", \"counters\": {");
+        const char * separator = "";
+        for (unsigned int counterIndex = 0;
+             counterIndex < NumberOfCounterTypes; ++counterIndex) {
+          if (counterValues._available[counterIndex] == true) {
+            fprintf(file, "%s\"%s\": %s", separator,
+                    getCounterName(CounterType(counterIndex)).c_str(),
+                    formatJsonNumber(
+                      counterValues._values[counterIndex]).c_str());
+            separator = ", ";
+          }
+        }
+        fprintf(file, "}");
+      }
+      if (statistics._phaseTimes.empty() == false) {
+        fprintf(file, ", \"phases\": {");
+        for (size_t phaseIndex = 0;
+             phaseIndex < statistics._phaseTimes.size(); ++phaseIndex) {
+          const PhaseTime & phaseTime = statistics._phaseTimes[phaseIndex];
+          fprintf(file, "%s\"%s\": %s", (phaseIndex == 0) ? "" : ", ",
+                  escapeJsonString(phaseTime._name).c_str(),
+                  formatJsonNumber(phaseTime._time).c_str());
+        }
+        fprintf(file, "}");
+      }
+      if (statistics._threadActivities.empty() == false) {
+        fprintf(file, ", \"imbalance\": %s, \"threadActivities\": [",
+                formatJsonNumber(computeImbalanceFactor(
+                  statistics._threadActivities)).c_str());
+        for (size_t threadIndex = 0;
+             threadIndex < statistics._threadActivities.size();
+             ++threadIndex) {
+          const ThreadActivity & threadActivity =
+            statistics._threadActivities[threadIndex];
+          fprintf(file, "%s{\"busy\": %s, \"chunks\": %s}",
+                  (threadIndex == 0) ? "" : ", ",
+                  formatJsonNumber(threadActivity._busyTime).c_str(),
+                  formatJsonNumber(threadActivity._numberOfChunks).c_str());
+        }
+        fprintf(file, "]");
+      }
+      if (statistics._numberOfSpawns > 0) {
+        fprintf(file, ", \"spawns\": %s, \"steals\": %s",
+                formatJsonNumber(statistics._numberOfSpawns).c_str(),
+                formatJsonNumber(statistics._numberOfSteals).c_str());
+      }
+      const RooflinePoint & rooflinePoint = record._rooflinePoint;
+      if (rooflinePoint._valid == true) {
+        fprintf(file, ", \"flopRate\": %s, \"bandwidth\": %s, "
+                "\"fractionOfRoofline\": %s",
+                formatJsonNumber(rooflinePoint._flopRate).c_str(),
+                formatJsonNumber(rooflinePoint._bandwidth).c_str(),
+                formatJsonNumber(rooflinePoint._fractionOfBound).c_str());
+      }
+      fprintf(file, "}");
+    }
+    fprintf(file, "\n  ]\n}\n");
+    fclose(file);
+  }
+
+  // one row per test, with the host repeated on every row so that files from
+  //  different machines can simply be concatenated.  the counters go at the
+  //  end, and are empty if they weren't collected.  the imbalance is 0 for
+  //  tests that don't mark their chunks.
+  void
+  writeCsv(const string & fileName) const {
+    FILE * file = fopen(fileName.c_str(), "w");
+    if (file == NULL) {
+      fprintf(stderr, "cannot open %s for writing\n", fileName.c_str());
+      exit(1);
+    }
+    fprintf(file, "exercise,test,threads,problemSize,repeats,min,median,p90,"
+            "mean,stddev,ci95,outliers,converged,setup,imbalance,hostName,"
+            "timestamp,instructionSet");
+    for (unsigned int counterIndex = 0;
+         counterIndex < NumberOfCounterTypes; ++counterIndex) {
+      fprintf(file, ",%s", getCounterName(CounterType(counterIndex)).c_str());
+    }
+    fprintf(file, "\n");
+    for (const BenchmarkRecord & record : _records) {
+      const TimingStatistics & statistics = record._timingStatistics;
+      fprintf(file, "%s,%s,%u,%lld,%u,%.6e,%.6e,%.6e,%.6e,%.6e,%.6e,%u,%d,"
+              "%.6e,%.6e,%s,%s,%s",
+              quoteCsvField(_exerciseName).c_str(),
+              quoteCsvField(record._testName).c_str(),
+              record._numberOfThreads,
+              (long long)record._problemSize,
+              statistics._numberOfRepeats,
+              statistics._minimum,
+              statistics._median,
+              statistics._percentile90,
+              statistics._mean,
+              statistics._standardDeviation,
+              std::isfinite(statistics._confidenceInterval) ?
+              statistics._confidenceInterval : 0.,
+              statistics._numberOfOutliers,
+              int(statistics._converged),
+              statistics._setupTime,
+              computeImbalanceFactor(statistics._threadActivities),
+              quoteCsvField(_hostMetadata._hostName).c_str(),
+              quoteCsvField(_hostMetadata._timestamp).c_str(),
+              quoteCsvField(_hostMetadata._instructionSet).c_str());
+      const CounterValues & counterValues = statistics._counterValues;
+      for (unsigned int counterIndex = 0;
+           counterIndex < NumberOfCounterTypes; ++counterIndex) {
+        if (counterValues._available[counterIndex] == true) {
+          fprintf(file, ",%.6e", counterValues._values[counterIndex]);
+        } else {
+          fprintf(file, ",");
+        }
+      }
+      fprintf(file, "\n");
+    }
+    fclose(file);
+  }
+
+  // compare the medians against a csv written by an earlier run.  tests are
+  //  matched on exercise, name, threads and problem size; anything that
+  //  isn't in the baseline is reported as new and otherwise ignored.
+  //  returns the number of tests that got slower by more than the threshold.
+  unsigned int
+  compareAgainstBaseline(const string & baselineFileName,
+                         const double regressionThreshold) const {
+    std::ifstream baselineFile(baselineFileName.c_str());
+    if (baselineFile.is_open() == false) {
+      fprintf(stderr, "cannot open baseline file %s\n",
+              baselineFileName.c_str());
+      exit(1);
+    }
+    std::map<string, double> baselineMedians;
+    string line;
+    // skip the header
+    std::getline(baselineFile, line);
+    while (std::getline(baselineFile, line)) {
+      const vector<string> fields = splitCsvLine(line);
+      if (fields.size() < 7) {
+        continue;
+      }
+      const string key =
+        fields[0] + "|" + fields[1] + "|" + fields[2] + "|" + fields[3];
+      baselineMedians[key] = atof(fields[6].c_str());
+    }
+
+    printf("comparing against baseline %s (threshold %%%.1f)\n",
+           baselineFileName.c_str(), 100. * regressionThreshold);
+    unsigned int numberOfRegressions = 0;
+    for (const BenchmarkRecord & record : _records) {
+      std::ostringstream key;
+      key << _exerciseName << "|" << record._testName << "|"
+          << record._numberOfThreads << "|" << record._problemSize;
+      const std::map<string, double>::const_iterator baseline =
+        baselineMedians.find(key.str());
+      if (baseline == baselineMedians.end()) {
+        printf("  %-28s %3u : new\n", record._testName.c_str(),
+               record._numberOfThreads);
+        continue;
+      }
+      const double ratio = record._timingStatistics._median / baseline->second;
+      const bool regressed = ratio > 1 + regressionThreshold;
+      if (regressed == true) {
+        ++numberOfRegressions;
+      }
+      printf("  %-28s %3u : baseline %8.2e now %8.2e (%+6.1f%%)%s\n",
+             record._testName.c_str(),
+             record._numberOfThreads,
+             baseline->second,
+             record._timingStatistics._median,
+             100. * (ratio - 1),
+             (regressed == true) ? " REGRESSION" : "");
+    }
+    printf("%u regression%s\n", numberOfRegressions,
+           (numberOfRegressions == 1) ? "" : "s");
+    return numberOfRegressions;
+  }
+
+  // rewrites both files with the records so far
+  void
+  write(const ResultsOptions & options) const {
+    writeJson(options._jsonFileName);
+    writeCsv(options._csvFileName);
+  }
+
+  // write the records and, if there's a baseline, compare against it.
+  //  returns what main should: nonzero if anything regressed.
+  int
+  finish(const ResultsOptions & options) const {
+    write(options);
+    printf("wrote results to %s and %s\n", options._jsonFileName.c_str(),
+           options._csvFileName.c_str());
+    if (options._baselineFileName.empty() == false &&
+        compareAgainstBaseline(options._baselineFileName,
+                               options._regressionThreshold) > 0) {
+      return 1;
+    }
+    return 0;
+  }
+
+private:
+  const string _exerciseName;
+  HostMetadata _hostMetadata;
+  vector<BenchmarkRecord> _records;
+};
+
+}
+
+#endif // BENCHMARK_RESULTS_H
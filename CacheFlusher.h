@@ -0,0 +1,391 @@
+// -*- C++ -*-
+#ifndef CACHE_FLUSHER_H
+#define CACHE_FLUSHER_H
+
+// evicts the cpu caches between timing repeats.  the buffer is sized from
+//  the last-level caches that sysfs reports, allocated and first touched
+//  once, so each flush is just two parallel passes over memory that's
+//  already mapped.  the passes run on as many threads as the test that's
+//  being timed, on the same cpus if it's pinned, so that they evict what
+//  that test's cores cached.  they're threads of the flusher's own, which
+//  sleep on a condition variable between flushes, because a pool like
+//  omp's would keep spinning on those cores for a while into a test that
+//  runs on tbb or the work-stealing pool.  they're started as they're first
+//  needed and kept for the rest of the run, and they move to a test's cpus
+//  on the first flush after it sets them, so a flush doesn't allocate or
+//  start anything.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <set>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <dirent.h>
+#include <sched.h>
+
+// header files for omp
+#include <omp.h>
+
+namespace Utilities {
+
+// cold: caches are flushed before every repeat.  warm: they are left alone,
+//  so each repeat sees whatever the previous one left behind.
+enum CacheState {ColdCache, WarmCache};
+
+inline
+string
+getCacheStateName(const CacheState cacheState) {
+  return (cacheState == ColdCache) ? string("cold") : string("warm");
+}
+
+// the size of a cache as sysfs prints it, like "32768K"
+inline
+size_t
+parseCacheSize(const string & sizeString) {
+  std::istringstream stream(sizeString);
+  size_t size = 0;
+  char unit = 0;
+  stream >> size >> unit;
+  if (unit == 'K') {
+    size *= 1024;
+  } else if (unit == 'M') {
+    size *= 1024 * 1024;
+  } else if (unit == 'G') {
+    size *= 1024 * 1024 * 1024;
+  }
+  return size;
+}
+
+inline
+string
+readSysfsLine(const string & path) {
+  std::ifstream file(path.c_str());
+  string line;
+  std::getline(file, line);
+  return line;
+}
+
+// the total size of all of the last-level caches on the machine.  on a
+//  multi-socket node every socket has its own, and we have to flush them
+//  all, so we add up the distinct ones as told apart by which cpus share
+//  them.  returns 0 if sysfs isn't there.
+inline
+size_t
+detectLastLevelCacheSize() {
+  unsigned int lastLevel = 0;
+  std::set<string> countedCaches;
+  size_t totalSize = 0;
+  const string cpuDirectory("/sys/devices/system/cpu");
+  DIR * directory = opendir(cpuDirectory.c_str());
+  if (directory == NULL) {
+    return 0;
+  }
+  // two passes: first find the last level, then add up its caches
+  for (unsigned int pass = 0; pass < 2; ++pass) {
+    rewinddir(directory);
+    while (const struct dirent * entry = readdir(directory)) {
+      const string cpuName(entry->d_name);
+      if (cpuName.compare(0, 3, "cpu") != 0 ||
+          cpuName.size() == 3 ||
+          cpuName.find_first_not_of("0123456789", 3) != string::npos) {
+        continue;
+      }
+      for (unsigned int cacheIndex = 0; ; ++cacheIndex) {
+        std::ostringstream cachePath;
+        cachePath << cpuDirectory << "/" << cpuName << "/cache/index"
+                  << cacheIndex << "/";
+        const string levelString = readSysfsLine(cachePath.str() + "level");
+        if (levelString.empty()) {
+          break;
+        }
+        const string type = readSysfsLine(cachePath.str() + "type");
+        if (type == "Instruction") {
+          continue;
+        }
+        const unsigned int level = atoi(levelString.c_str());
+        if (pass == 0) {
+          lastLevel = std::max(lastLevel, level);
+        } else if (level == lastLevel) {
+          const string sharedCpus =
+            readSysfsLine(cachePath.str() + "shared_cpu_list");
+          if (countedCaches.insert(sharedCpus).second == true) {
+            totalSize +=
+              parseCacheSize(readSysfsLine(cachePath.str() + "size"));
+          }
+        }
+      }
+    }
+  }
+  closedir(directory);
+  return totalSize;
+}
+
+class CacheFlusher {
+public:
+
+  // there's one buffer for the whole program, made on first use.
+  static
+  CacheFlusher &
+  getInstance() {
+    static CacheFlusher cacheFlusher;
+    return cacheFlusher;
+  }
+
+  // stream a write and then a read over the whole buffer, a block per
+  //  thread.  the write pushes everything else out, and the read replaces
+  //  the dirty lines that the write left with clean ones, so the test that
+  //  runs next doesn't pay for our writebacks.
+  void
+  flush() {
+    _value = ++_numberOfFlushes;
+    runOnThreads(FlushTask);
+    // so that the optimizer can't decide the reads are pointless
+    double sum = 0;
+    for (unsigned int threadIndex = 0; threadIndex < _numberOfThreads;
+         ++threadIndex) {
+      sum += _sums[threadIndex]._sum;
+    }
+    _sink = sum;
+  }
+
+  // the threads that the flushes run on: one for each of the test's, and
+  //  pinned to the test's cpus if there are any.  the one that calls flush
+  //  is the first of them, so it's pinned already if the test is.  only
+  //  call this between flushes.
+  void
+  setThreads(const unsigned int numberOfThreads,
+             const vector<int> & placement) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _numberOfThreads = std::max(1u, numberOfThreads);
+    _placement = placement;
+    ++_placementGeneration;
+    if (_sums.size() < _numberOfThreads) {
+      _sums.resize(_numberOfThreads);
+    }
+    while (_helpers.size() + 1 < _numberOfThreads) {
+      _helpers.push_back(std::thread(&CacheFlusher::runHelper, this,
+                                     _helpers.size() + 1, _taskGeneration));
+    }
+  }
+
+  // every processor, unpinned, for the tests that don't have a number of
+  //  threads of their own
+  void
+  resetThreads() {
+    setThreads(_numberOfProcessors, vector<int>());
+  }
+
+  size_t
+  getLastLevelCacheSize() const {
+    return _lastLevelCacheSize;
+  }
+
+  size_t
+  getBufferSize() const {
+    return _numberOfEntries * sizeof(double);
+  }
+
+private:
+
+  enum Task {TouchTask, FlushTask};
+
+  // each thread's sum has cache lines of its own
+  struct ThreadSum {
+
+    ThreadSum() :
+      _sum(0) {
+    }
+
+    double _sum;
+    char _padding[64];
+  };
+
+  CacheFlusher() :
+    _lastLevelCacheSize(detectLastLevelCacheSize()),
+    _numberOfProcessors(omp_get_num_procs()),
+    _numberOfThreads(1),
+    _placementGeneration(1),
+    _task(TouchTask),
+    _taskGeneration(0),
+    _numberOfBusyHelpers(0),
+    _stopping(false),
+    _value(0),
+    _numberOfFlushes(0),
+    _sink(0) {
+    // twice the cache, so that nothing of the test's survives the replacement
+    //  policy.  if we can't find out, fall back on 80 MB.
+    const size_t bufferSize = (_lastLevelCacheSize > 0) ?
+      2 * _lastLevelCacheSize : size_t(80) * 1024 * 1024;
+    _numberOfEntries = bufferSize / sizeof(double);
+    // new double[] leaves the memory untouched, so that the first touch
+    //  happens here, spread over every processor.
+    _buffer.reset(new double[_numberOfEntries]);
+    resetThreads();
+    runOnThreads(TouchTask);
+  }
+
+  ~CacheFlusher() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stopping = true;
+    }
+    _wakeCondition.notify_all();
+    for (std::thread & helper : _helpers) {
+      helper.join();
+    }
+  }
+
+  // the task on an even block of the buffer for each of the threads, with
+  //  the calling thread doing the first block
+  void
+  runOnThreads(const Task task) {
+    unsigned int numberOfThreads;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      numberOfThreads = _numberOfThreads;
+      _task = task;
+      _numberOfBusyHelpers = numberOfThreads - 1;
+      ++_taskGeneration;
+    }
+    if (numberOfThreads > 1) {
+      _wakeCondition.notify_all();
+    }
+    runBlock(task, 0, numberOfThreads);
+    std::unique_lock<std::mutex> lock(_mutex);
+    _doneCondition.wait(lock, [this] () {
+        return _numberOfBusyHelpers == 0;
+      });
+  }
+
+  void
+  runBlock(const Task task,
+           const unsigned int threadIndex,
+           const unsigned int numberOfThreads) {
+    double * const buffer = _buffer.get();
+    const size_t beginIndex =
+      _numberOfEntries * threadIndex / numberOfThreads;
+    const size_t endIndex =
+      _numberOfEntries * (threadIndex + 1) / numberOfThreads;
+    if (task == TouchTask) {
+      std::fill(buffer + beginIndex, buffer + endIndex, 0.);
+      return;
+    }
+    const double value = _value;
+    for (size_t entryIndex = beginIndex; entryIndex < endIndex;
+         ++entryIndex) {
+      buffer[entryIndex] = value;
+    }
+    double sum = 0;
+    for (size_t entryIndex = beginIndex; entryIndex < endIndex;
+         ++entryIndex) {
+      sum += buffer[entryIndex];
+    }
+    _sums[threadIndex]._sum = sum;
+  }
+
+  // a helper sleeps until there's a task after the one it was started at
+  //  that needs it, and before running it, moves to its cpu in the
+  //  placement if that changed
+  void
+  runHelper(const unsigned int threadIndex,
+            unsigned int taskGeneration) {
+    unsigned int placementGeneration = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+      _wakeCondition.wait(lock, [&] () {
+          return _stopping == true ||
+            (_taskGeneration != taskGeneration &&
+             threadIndex < _numberOfThreads);
+        });
+      if (_stopping == true) {
+        return;
+      }
+      taskGeneration = _taskGeneration;
+      if (placementGeneration != _placementGeneration) {
+        pinCurrentThread((threadIndex < _placement.size()) ?
+                         _placement[threadIndex] : -1);
+        placementGeneration = _placementGeneration;
+      }
+      const Task task = _task;
+      const unsigned int numberOfThreads = _numberOfThreads;
+      lock.unlock();
+      runBlock(task, threadIndex, numberOfThreads);
+      lock.lock();
+      if (--_numberOfBusyHelpers == 0) {
+        _doneCondition.notify_one();
+      }
+    }
+  }
+
+  // -1 lets the thread run anywhere that the process may
+  static
+  void
+  pinCurrentThread(const int cpu) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if (cpu >= 0) {
+      CPU_SET(cpu, &cpuSet);
+    } else {
+      for (int anyCpu = 0; anyCpu < CPU_SETSIZE; ++anyCpu) {
+        CPU_SET(anyCpu, &cpuSet);
+      }
+    }
+    sched_setaffinity(0, sizeof(cpuSet), &cpuSet);
+  }
+
+  CacheFlusher(const CacheFlusher &);
+  CacheFlusher & operator=(const CacheFlusher &);
+
+  const size_t _lastLevelCacheSize;
+  const unsigned int _numberOfProcessors;
+  size_t _numberOfEntries;
+  std::unique_ptr<double[]> _buffer;
+  // the helpers run every thread's block but the first
+  vector<std::thread> _helpers;
+  std::mutex _mutex;
+  std::condition_variable _wakeCondition;
+  std::condition_variable _doneCondition;
+  // from here to _stopping is guarded by the mutex
+  unsigned int _numberOfThreads;
+  vector<int> _placement;
+  unsigned int _placementGeneration;
+  Task _task;
+  unsigned int _taskGeneration;
+  unsigned int _numberOfBusyHelpers;
+  bool _stopping;
+  // written by the flushing thread before it wakes the helpers
+  double _value;
+  vector<ThreadSum> _sums;
+  double _numberOfFlushes;
+  volatile double _sink;
+};
+
+// flushes on one test's threads for as long as it's around
+class CacheFlushThreads {
+public:
+
+  CacheFlushThreads(const unsigned int numberOfThreads,
+                    const vector<int> & placement) {
+    CacheFlusher::getInstance().setThreads(numberOfThreads, placement);
+  }
+
+  ~CacheFlushThreads() {
+    CacheFlusher::getInstance().resetThreads();
+  }
+
+private:
+  CacheFlushThreads(const CacheFlushThreads &);
+  CacheFlushThreads & operator=(const CacheFlushThreads &);
+};
+
+}
+
+#endif // CACHE_FLUSHER_H
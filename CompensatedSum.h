@@ -0,0 +1,184 @@
+// -*- C++ -*-
+#ifndef COMPENSATED_SUM_H
+#define COMPENSATED_SUM_H
+
+// kahan-neumaier compensated summation, and a kokkos reducer for it.
+//  a plain double sum of n terms picks up O(n) roundoff, which at a billion
+//  terms eats most of the digits; carrying the lost low-order bits in a
+//  second double keeps the error at O(1) without resorting to long double,
+//  which doesn't exist on the gpu anyway.
+
+#include <cmath>
+#include <string>
+
+// header files for kokkos types
+#include <Kokkos_Core.hpp>
+
+namespace Utilities {
+
+struct CompensatedSum {
+
+  KOKKOS_INLINE_FUNCTION
+  CompensatedSum() :
+    _sum(0),
+    _compensation(0) {
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  CompensatedSum &
+  operator+=(const double value) {
+    const double newSum = _sum + value;
+    // neumaier's variant: whichever operand is bigger is the one that kept
+    //  its low bits, so recover the lost bits from the other one.
+    if (fabs(_sum) >= fabs(value)) {
+      _compensation += (_sum - newSum) + value;
+    } else {
+      _compensation += (value - newSum) + _sum;
+    }
+    _sum = newSum;
+    return *this;
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  CompensatedSum &
+  operator+=(const CompensatedSum & other) {
+    *this += other._sum;
+    _compensation += other._compensation;
+    return *this;
+  }
+
+  // kokkos joins reduction values through volatile references
+  KOKKOS_INLINE_FUNCTION
+  void
+  operator+=(const volatile CompensatedSum & other) volatile {
+    const double otherSum = other._sum;
+    const double newSum = _sum + otherSum;
+    if (fabs(_sum) >= fabs(otherSum)) {
+      _compensation += (_sum - newSum) + otherSum;
+    } else {
+      _compensation += (otherSum - newSum) + _sum;
+    }
+    _sum = newSum;
+    _compensation += other._compensation;
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  double
+  getValue() const {
+    return _sum + _compensation;
+  }
+
+  double _sum;
+  double _compensation;
+};
+
+// a kokkos reducer, so that compensated sums can be used with
+//  parallel_reduce on any execution space, functor or lambda alike:
+//
+//   CompensatedSum sum;
+//   Kokkos::parallel_reduce(policy, functor, CompensatedSumReducer<>(sum));
+//
+//  the functor's operator() takes a CompensatedSum & and adds doubles to it.
+//  like kokkos' own reducers, the template argument is the memory space that
+//  the result lives in.
+template <class ResultSpace = Kokkos::HostSpace>
+class CompensatedSumReducer {
+public:
+
+  typedef CompensatedSumReducer reducer;
+  typedef CompensatedSum value_type;
+  typedef Kokkos::View<value_type, ResultSpace,
+                       Kokkos::MemoryUnmanaged> result_view_type;
+
+  KOKKOS_INLINE_FUNCTION
+  CompensatedSumReducer(value_type & result) :
+    _result(&result) {
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  void
+  join(value_type & destination, const value_type & source) const {
+    destination += source;
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  void
+  join(volatile value_type & destination,
+       const volatile value_type & source) const {
+    destination += source;
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  void
+  init(value_type & value) const {
+    value = value_type();
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  value_type &
+  reference() const {
+    return *_result;
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  result_view_type
+  view() const {
+    return result_view_type(_result);
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  bool
+  references_scalar() const {
+    return true;
+  }
+
+private:
+  value_type * _result;
+};
+
+// pick how to reduce a sum of doubles based on the accumulator type: a plain
+//  double goes through kokkos' built-in sum, a compensated sum through its
+//  reducer.  either way you get a double back.
+template <class SumType>
+struct KokkosSumReduction {
+};
+
+template <>
+struct KokkosSumReduction<double> {
+  template <class Policy, class Functor>
+  static
+  double
+  reduce(const Policy & policy, const Functor & functor) {
+    double sum = 0;
+    Kokkos::parallel_reduce(policy, functor, sum);
+    return sum;
+  }
+
+  static
+  string
+  getName() {
+    return string("");
+  }
+};
+
+template <>
+struct KokkosSumReduction<CompensatedSum> {
+  template <class Policy, class Functor>
+  static
+  double
+  reduce(const Policy & policy, const Functor & functor) {
+    CompensatedSum sum;
+    Kokkos::parallel_reduce(policy, functor, CompensatedSumReducer<>(sum));
+    return sum.getValue();
+  }
+
+  static
+  string
+  getName() {
+    return string(" compensated");
+  }
+};
+
+}
+
+#endif // COMPENSATED_SUM_H
@@ -0,0 +1,85 @@
+// -*- C++ -*-
+#ifndef COUNTER_BASED_RANDOM_H
+#define COUNTER_BASED_RANDOM_H
+
+// a counter-based random number generator (philox4x32-10, from Salmon et al.,
+//  "Parallel Random Numbers: As Easy as 1, 2, 3").  unlike std::mt19937,
+//  there is no state to advance: the random bits for a given counter are a
+//  pure function of (counter, key), so any thread or kokkos work item can
+//  jump straight to its own part of the stream without coordination.
+
+#include <cstdint>
+
+// header files for kokkos types
+#include <Kokkos_Core.hpp>
+
+namespace Utilities {
+
+struct PhiloxBlock {
+  uint32_t _values[4];
+};
+
+class CounterBasedRandomNumberGenerator {
+public:
+
+  KOKKOS_INLINE_FUNCTION
+  CounterBasedRandomNumberGenerator(const uint64_t seed) :
+    _key0(uint32_t(seed)),
+    _key1(uint32_t(seed >> 32)) {
+  }
+
+  // scramble one 128-bit counter into 128 random bits.
+  KOKKOS_INLINE_FUNCTION
+  PhiloxBlock
+  generateBlock(const PhiloxBlock & counter) const {
+    PhiloxBlock block = counter;
+    uint32_t key0 = _key0;
+    uint32_t key1 = _key1;
+    for (unsigned int roundIndex = 0; roundIndex < 10; ++roundIndex) {
+      if (roundIndex > 0) {
+        key0 += 0x9E3779B9;
+        key1 += 0xBB67AE85;
+      }
+      const uint64_t product0 = uint64_t(0xD2511F53) * block._values[0];
+      const uint64_t product1 = uint64_t(0xCD9E8D57) * block._values[2];
+      const uint32_t oldValue1 = block._values[1];
+      const uint32_t oldValue3 = block._values[3];
+      block._values[0] = uint32_t(product1 >> 32) ^ oldValue1 ^ key0;
+      block._values[1] = uint32_t(product1);
+      block._values[2] = uint32_t(product0 >> 32) ^ oldValue3 ^ key1;
+      block._values[3] = uint32_t(product0);
+    }
+    return block;
+  }
+
+  // the usual way to address the stream: which element of which
+  //  sub-stream.  each call gives 128 fresh bits.
+  KOKKOS_INLINE_FUNCTION
+  PhiloxBlock
+  generateBlock(const uint64_t elementIndex,
+                const uint64_t streamIndex) const {
+    PhiloxBlock counter;
+    counter._values[0] = uint32_t(elementIndex);
+    counter._values[1] = uint32_t(elementIndex >> 32);
+    counter._values[2] = uint32_t(streamIndex);
+    counter._values[3] = uint32_t(streamIndex >> 32);
+    return generateBlock(counter);
+  }
+
+  // 53 random bits from two words, mapped into the open interval (0, 1)
+  KOKKOS_INLINE_FUNCTION
+  static
+  double
+  convertToUniformDouble(const uint32_t highBits, const uint32_t lowBits) {
+    const uint64_t bits = (uint64_t(highBits) << 21) ^ (lowBits >> 11);
+    return (double(bits) + 0.5) * (1. / 9007199254740992.);
+  }
+
+private:
+  uint32_t _key0;
+  uint32_t _key1;
+};
+
+}
+
+#endif // COUNTER_BASED_RANDOM_H
@@ -0,0 +1,172 @@
+// -*- C++ -*-
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+// which vector instructions the vectorized kernels use.  the build targets
+//  plain x86-64, so that one binary runs on every machine, and each of those
+//  kernels is compiled again for avx2 and for avx-512 inside of it.  those
+//  are the roofline's multiply-add probe and the cpu matrix multiplications'
+//  row loop.  the histograms' scattered increments and the integrations'
+//  calls to std::sin don't vectorize, so they aren't.  the driver picks
+//  the best that the cpu has once at startup, or the one that --isa asks
+//  for, so that the instruction sets can be compared on one machine.
+//
+//   Utilities::dispatchInstructionSet([&] () {
+//   #pragma omp simd reduction(+:sum)
+//       for (...) {
+//         ...
+//       }
+//     });
+//
+//  the function is inlined into a copy of the dispatcher that's compiled for
+//  each instruction set, so it has to be small enough to inline, and
+//  everything that it calls is compiled for that instruction set too, except
+//  for library functions like std::sin.  a loop that calls one of those
+//  stays scalar in every copy, so it gains nothing from being dispatched.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace Utilities {
+
+enum InstructionSet {Sse2InstructionSet,
+                     Avx2InstructionSet,
+                     Avx512InstructionSet,
+                     NumberOfInstructionSets};
+
+// the names used on the command line
+inline
+string
+getInstructionSetName(const InstructionSet instructionSet) {
+  const char * const instructionSetNames[NumberOfInstructionSets] =
+    {"sse2", "avx2", "avx512"};
+  return string(instructionSetNames[instructionSet]);
+}
+
+inline
+bool
+parseInstructionSetName(const string & name,
+                        InstructionSet * instructionSet) {
+  for (unsigned int index = 0; index < NumberOfInstructionSets; ++index) {
+    if (getInstructionSetName(InstructionSet(index)) == name) {
+      *instructionSet = InstructionSet(index);
+      return true;
+    }
+  }
+  return false;
+}
+
+// the best that this cpu has, from cpuid
+inline
+InstructionSet
+detectInstructionSet() {
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")
+      && __builtin_cpu_supports("avx512vl")) {
+    return Avx512InstructionSet;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return Avx2InstructionSet;
+  }
+#endif
+  return Sse2InstructionSet;
+}
+
+class CpuDispatch {
+public:
+
+  static
+  CpuDispatch &
+  getInstance() {
+    static CpuDispatch cpuDispatch;
+    return cpuDispatch;
+  }
+
+  InstructionSet
+  getDetectedInstructionSet() const {
+    return _detectedInstructionSet;
+  }
+
+  InstructionSet
+  getInstructionSet() const {
+    return _instructionSet;
+  }
+
+  // anything past what the cpu has would die on an illegal instruction
+  void
+  setInstructionSet(const InstructionSet instructionSet) {
+    if (instructionSet > _detectedInstructionSet) {
+      fprintf(stderr, "this cpu doesn't have %s, only up to %s\n",
+              getInstructionSetName(instructionSet).c_str(),
+              getInstructionSetName(_detectedInstructionSet).c_str());
+      exit(1);
+    }
+    _instructionSet = instructionSet;
+  }
+
+private:
+
+  CpuDispatch() :
+    _detectedInstructionSet(detectInstructionSet()),
+    _instructionSet(_detectedInstructionSet) {
+  }
+
+  CpuDispatch(const CpuDispatch &);
+  CpuDispatch & operator=(const CpuDispatch &);
+
+  const InstructionSet _detectedInstructionSet;
+  InstructionSet _instructionSet;
+};
+
+// one copy of the function for each instruction set.  flatten inlines
+//  everything that the function calls into the copy, which is what gets it
+//  compiled with the copy's instructions.
+template <class Function>
+__attribute__((flatten))
+void
+runWithSse2(const Function & function) {
+  function();
+}
+
+#if defined(__x86_64__)
+template <class Function>
+__attribute__((target("avx2,fma"), flatten))
+void
+runWithAvx2(const Function & function) {
+  function();
+}
+
+template <class Function>
+__attribute__((target("avx512f,avx512dq,avx512vl,avx2,fma,"
+                      "prefer-vector-width=512"), flatten))
+void
+runWithAvx512(const Function & function) {
+  function();
+}
+#endif
+
+// runs the function compiled for the instruction set that was picked at
+//  startup
+template <class Function>
+void
+dispatchInstructionSet(const Function & function) {
+#if defined(__x86_64__)
+  switch (CpuDispatch::getInstance().getInstructionSet()) {
+  case Avx512InstructionSet:
+    runWithAvx512(function);
+    return;
+  case Avx2InstructionSet:
+    runWithAvx2(function);
+    return;
+  default:
+    break;
+  }
+#endif
+  runWithSse2(function);
+}
+
+}
+
+#endif // CPU_DISPATCH_H
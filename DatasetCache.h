@@ -0,0 +1,284 @@
+// -*- C++ -*-
+#ifndef DATASET_CACHE_H
+#define DATASET_CACHE_H
+
+// inputs that are kept on disk between runs.  a dataset is named by what
+//  made it: the exercise's name for it, the distribution, the seed, the
+//  number of entries and the version of the generators.  the first run with
+//  a cache directory writes each dataset there, behind a header with those
+//  parameters and a checksum of the data, and later runs map the file
+//  instead of generating it again.  the test functors all take vectors, so
+//  the mapping is checksummed and copied into one, which runs at memory
+//  bandwidth and not at the speed of the generator.  both read every page,
+//  so the whole file is faulted in when it's mapped.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// header files for omp
+#include <omp.h>
+
+#include "Utilities.h"
+#include "InputGeneration.h"
+
+namespace Utilities {
+
+struct DatasetCacheOptions {
+
+  // empty for no cache, in which case every dataset is generated
+  string _directory;
+};
+
+struct DatasetDescription {
+
+  DatasetDescription(const string & name,
+                     const string & distribution,
+                     const uint64_t seed,
+                     const LargeIndex numberOfEntries) :
+    _name(name),
+    _distribution(distribution),
+    _seed(seed),
+    _numberOfEntries(numberOfEntries),
+    _generatorVersion(InputGeneratorVersion) {
+  }
+
+  // these two end up in the file name, so no slashes
+  string _name;
+  string _distribution;
+  uint64_t _seed;
+  LargeIndex _numberOfEntries;
+  uint32_t _generatorVersion;
+};
+
+// the data starts a page after the header, so that it's page-aligned
+const size_t DatasetHeaderSize = 4096;
+// the last character is the version of the file's layout
+const char DatasetMagic[8] = {'D', 'A', 'T', 'A', 'S', 'E', 'T', '2'};
+
+struct DatasetFileHeader {
+  char _magic[8];
+  uint32_t _entrySize;
+  uint32_t _generatorVersion;
+  uint32_t _distributionLength;
+  int64_t _numberOfEntries;
+  uint64_t _seed;
+  uint64_t _checksum;
+  char _distribution[64];
+};
+
+// a 64-bit multiply-xor hash of each of a fixed number of chunks, in
+//  parallel, and then of the chunks' hashes in order, so that it's the same
+//  for any number of threads.  it's for catching truncated and overwritten
+//  files, not for security.
+inline
+uint64_t
+computeDatasetChecksum(const char * const bytes,
+                       const size_t numberOfBytes) {
+  const size_t numberOfChunks = 64;
+  // whole words per chunk, so that the words are aligned
+  const size_t chunkSize =
+    ((numberOfBytes / numberOfChunks + 7) / 8) * 8;
+  uint64_t chunkHashes[numberOfChunks];
+#pragma omp parallel for schedule(static)
+  for (size_t chunkIndex = 0; chunkIndex < numberOfChunks; ++chunkIndex) {
+    const size_t chunkBegin = std::min(numberOfBytes, chunkIndex * chunkSize);
+    const size_t chunkEnd =
+      (chunkIndex + 1 == numberOfChunks) ? numberOfBytes :
+      std::min(numberOfBytes, (chunkIndex + 1) * chunkSize);
+    uint64_t hash = 0xCBF29CE484222325ULL ^ chunkIndex;
+    size_t byteIndex = chunkBegin;
+    for (; byteIndex + 8 <= chunkEnd; byteIndex += 8) {
+      uint64_t word;
+      memcpy(&word, bytes + byteIndex, 8);
+      hash = (hash ^ word) * 0x100000001B3ULL;
+      hash ^= hash >> 29;
+    }
+    for (; byteIndex < chunkEnd; ++byteIndex) {
+      hash = (hash ^ (unsigned char)bytes[byteIndex]) * 0x100000001B3ULL;
+    }
+    chunkHashes[chunkIndex] = hash;
+  }
+  uint64_t checksum = numberOfBytes;
+  for (size_t chunkIndex = 0; chunkIndex < numberOfChunks; ++chunkIndex) {
+    checksum = (checksum ^ chunkHashes[chunkIndex]) * 0x100000001B3ULL;
+    checksum ^= checksum >> 29;
+  }
+  return checksum;
+}
+
+inline
+string
+getDatasetFileName(const DatasetCacheOptions & options,
+                   const DatasetDescription & description,
+                   const size_t entrySize) {
+  std::ostringstream fileName;
+  fileName << options._directory << "/" << description._name << "_"
+           << description._distribution << "_n"
+           << description._numberOfEntries << "_seed" << std::hex
+           << description._seed << std::dec << "_" << entrySize << "_v"
+           << description._generatorVersion << ".bin";
+  return fileName.str();
+}
+
+// copies the dataset out of the cache file into the entries, which are
+//  already the right size, and returns false if there is no file or it's
+//  not the dataset it should be.
+inline
+bool
+readCachedDataset(const string & fileName,
+                  const DatasetDescription & description,
+                  const size_t entrySize,
+                  char * const entries) {
+  const int fileDescriptor = open(fileName.c_str(), O_RDONLY);
+  if (fileDescriptor < 0) {
+    return false;
+  }
+  const size_t numberOfBytes = entrySize * description._numberOfEntries;
+  struct stat fileStatus;
+  if (fstat(fileDescriptor, &fileStatus) != 0 ||
+      size_t(fileStatus.st_size) != DatasetHeaderSize + numberOfBytes) {
+    fprintf(stderr, "%s is the wrong size, regenerating it\n",
+            fileName.c_str());
+    close(fileDescriptor);
+    return false;
+  }
+  void * const mapping = mmap(NULL, fileStatus.st_size, PROT_READ,
+                              MAP_PRIVATE | MAP_POPULATE, fileDescriptor, 0);
+  // the mapping keeps the file open
+  close(fileDescriptor);
+  if (mapping == MAP_FAILED) {
+    fprintf(stderr, "cannot map %s (%s), regenerating it\n",
+            fileName.c_str(), strerror(errno));
+    return false;
+  }
+  DatasetFileHeader header;
+  memcpy(&header, mapping, sizeof(header));
+  const char * const data = (const char *)mapping + DatasetHeaderSize;
+  bool isValid =
+    memcmp(header._magic, DatasetMagic, sizeof(DatasetMagic)) == 0 &&
+    header._entrySize == entrySize &&
+    header._generatorVersion == description._generatorVersion &&
+    header._numberOfEntries == description._numberOfEntries &&
+    header._seed == description._seed &&
+    string(header._distribution,
+           std::min(size_t(header._distributionLength),
+                    sizeof(header._distribution))) ==
+    description._distribution;
+  if (isValid == false) {
+    fprintf(stderr, "%s has the wrong header, regenerating it\n",
+            fileName.c_str());
+  } else if (computeDatasetChecksum(data, numberOfBytes) !=
+             header._checksum) {
+    fprintf(stderr, "%s fails its checksum, regenerating it\n",
+            fileName.c_str());
+    isValid = false;
+  } else {
+    const size_t numberOfBlocks = 1024;
+    const size_t blockSize = (numberOfBytes + numberOfBlocks - 1) /
+      numberOfBlocks;
+#pragma omp parallel for schedule(static)
+    for (size_t blockIndex = 0; blockIndex < numberOfBlocks; ++blockIndex) {
+      const size_t blockBegin =
+        std::min(numberOfBytes, blockIndex * blockSize);
+      const size_t blockEnd =
+        std::min(numberOfBytes, (blockIndex + 1) * blockSize);
+      memcpy(entries + blockBegin, data + blockBegin, blockEnd - blockBegin);
+    }
+  }
+  munmap(mapping, fileStatus.st_size);
+  return isValid;
+}
+
+// the file is written under a temporary name and renamed into place, so
+//  that a run that's reading the cache never sees half of it.  not being
+//  able to write the cache isn't fatal; the next run just generates the
+//  dataset again.
+inline
+void
+writeCachedDataset(const string & fileName,
+                   const DatasetDescription & description,
+                   const size_t entrySize,
+                   const char * const entries) {
+  const size_t numberOfBytes = entrySize * description._numberOfEntries;
+  vector<char> headerBlock(DatasetHeaderSize, 0);
+  DatasetFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header._magic, DatasetMagic, sizeof(DatasetMagic));
+  header._entrySize = entrySize;
+  header._generatorVersion = description._generatorVersion;
+  header._distributionLength =
+    std::min(description._distribution.size(), sizeof(header._distribution));
+  header._numberOfEntries = description._numberOfEntries;
+  header._seed = description._seed;
+  header._checksum = computeDatasetChecksum(entries, numberOfBytes);
+  memcpy(header._distribution, description._distribution.data(),
+         header._distributionLength);
+  memcpy(&headerBlock[0], &header, sizeof(header));
+
+  std::ostringstream temporaryFileName;
+  temporaryFileName << fileName << ".tmp" << getpid();
+  FILE * file = fopen(temporaryFileName.str().c_str(), "wb");
+  if (file == NULL) {
+    fprintf(stderr, "cannot write the dataset cache file %s (%s)\n",
+            temporaryFileName.str().c_str(), strerror(errno));
+    return;
+  }
+  const bool wroteEverything =
+    fwrite(&headerBlock[0], 1, DatasetHeaderSize, file) ==
+    DatasetHeaderSize &&
+    fwrite(entries, 1, numberOfBytes, file) == numberOfBytes;
+  if (fclose(file) != 0 || wroteEverything == false ||
+      rename(temporaryFileName.str().c_str(), fileName.c_str()) != 0) {
+    fprintf(stderr, "cannot write the dataset cache file %s\n",
+            fileName.c_str());
+    remove(temporaryFileName.str().c_str());
+  }
+}
+
+// fills the entries with the dataset, from the cache if it's there and
+//  from the generator if not.  the generator is called with a pointer to
+//  description._numberOfEntries entries to fill.  the resize leaves new
+//  entries unwritten, so the first to touch them is the parallel copy or
+//  the generator.
+template <class T, class Generator>
+void
+loadOrCreateDataset(const DatasetCacheOptions & options,
+                    const DatasetDescription & description,
+                    Generator generator,
+                    InputVector<T> * entries) {
+  entries->resize(description._numberOfEntries);
+  if (options._directory.empty() == true) {
+    generator(entries->data());
+    return;
+  }
+  const string fileName =
+    getDatasetFileName(options, description, sizeof(T));
+  const double tic = omp_get_wtime();
+  if (readCachedDataset(fileName, description, sizeof(T),
+                        (char *)entries->data()) == true) {
+    printf("read %s from the dataset cache in %.2e seconds\n",
+           description._name.c_str(), omp_get_wtime() - tic);
+    return;
+  }
+  generator(entries->data());
+  writeCachedDataset(fileName, description, sizeof(T),
+                     (const char *)entries->data());
+  printf("generated %s and wrote it to the dataset cache in %.2e seconds\n",
+         description._name.c_str(), omp_get_wtime() - tic);
+}
+
+}
+
+#endif // DATASET_CACHE_H
@@ -11,6 +11,7 @@
 #include <string>
 #include <algorithm>
 #include <chrono>
+#include <climits>
 
 using std::string;
 using std::vector;
@@ -21,23 +22,25 @@ using std::chrono::duration_cast;
 
 // header file containing some uninteresting ickies
 #include "../Utilities.h"
+#include "../BenchmarkDriver.h"
+#include "../InputGeneration.h"
 
 // header files for various implementations
 #include "Histogram_serial.h"
 #include "Histogram_tbb.h"
 #include "Histogram_omp.h"
+#include "Histogram_stealing.h"
+#ifdef HAVE_STDPAR
+#include "Histogram_stdpar.h"
+#endif
+#ifndef CPU_ONLY
 #include "Histogram_cuda.h"
+#endif
 #include "Histogram_kokkos.h"
 
 // header file for kokkos so that i can specify device types here
 #include <Kokkos_Core.hpp>
 
-// header file so that i can set the number of threads for tbb
-#include <tbb/task_scheduler_init.h>
-
-// header file so that i can set the number of threads for omp
-#include <omp.h>
-
 void
 checkAnswer(const vector<unsigned int> & correctAnswer,
             const vector<unsigned int> & testAnswer,
@@ -59,77 +62,76 @@ checkAnswer(const vector<unsigned int> & correctAnswer,
   }
 }
 
-template <class TestFunctor>
+// a shuffled 0, 1, ..., numberOfElements - 1, so that every bucket gets the
+//  same number of elements.  it's made in parallel and comes out the same
+//  for any number of threads, or read from the dataset cache if it's there.
 void
-runTimingTest(const TestFunctor & testFunctor,
-              const unsigned int numberOfRepeats,
-              const unsigned int numberOfExtraRepeats,
-              vector<unsigned int> * answer,
-              double * elapsedTime) {
-
-  high_resolution_clock::time_point tic;
-
-  double thisTestsTime = 0;
-  for (unsigned int repeatIndex = 0;
-       repeatIndex < numberOfRepeats + numberOfExtraRepeats; ++repeatIndex) {
-
-    // reset the device
-    Utilities::resetProcessorForTiming(TestFunctor::ProcessorType);
-
-    // start timing
-    if (repeatIndex >= numberOfExtraRepeats) {
-      tic = high_resolution_clock::now();
-    }
-
-    // run the test
-    testFunctor.computeAnswer(answer);
-
-    // stop timing
-    if (repeatIndex >= numberOfExtraRepeats) {
-      const high_resolution_clock::time_point toc =
-        high_resolution_clock::now();
-      thisTestsTime += duration_cast<duration<double> >(toc - tic).count();
-    }
+createInput(const Utilities::DatasetCacheOptions & cacheOptions,
+            const Utilities::LargeIndex numberOfElements,
+            Utilities::InputVector<unsigned int> * input) {
+  if (numberOfElements > Utilities::LargeIndex(UINT_MAX) + 1) {
+    fprintf(stderr, "%lld elements don't fit in unsigned ints\n",
+            (long long)numberOfElements);
+    exit(1);
   }
-
-  *elapsedTime = thisTestsTime / numberOfRepeats;
-}
-
-template <class TestFunctor>
-void
-runTimingTestAndCheckAnswer(const TestFunctor & testFunctor,
-                            const unsigned int numberOfRepeats,
-                            const unsigned int numberOfExtraRepeats,
-                            const vector<unsigned int> & correctAnswer,
-                            double * elapsedTime) {
-
-  // compute the answer and measure elapsed time
-  vector<unsigned int> answer;
-  runTimingTest(testFunctor,
-                numberOfRepeats,
-                numberOfExtraRepeats,
-                &answer,
-                elapsedTime);
-
-  // check the answer
-  checkAnswer(correctAnswer, answer, testFunctor.getName());
+  Utilities::loadOrCreateDataset(cacheOptions,
+                                 Utilities::DatasetDescription(
+                                   "histogramInput", "permutation",
+                                   Utilities::DefaultInputSeed,
+                                   numberOfElements),
+                                 [&] (unsigned int * entries) {
+                                   Utilities::createRandomPermutation(
+                                     Utilities::DefaultInputSeed,
+                                     numberOfElements, entries);
+                                 },
+                                 input);
 }
 
-int main() {
+int main(int argc, char * argv[]) {
 
-  // change the numberOfElements to control the amount
-  //  of work done.
-  const unsigned int numberOfElements = 1e7;
+  // the number of elements controls the amount of work done.  it comes
+  //  from the command line, along with the threads and backends to use and
+  //  how many times each test is performed; see --help.
+  Utilities::BenchmarkDriver driver("Histogram", argc, argv, 1e7);
+  const Utilities::LargeIndex numberOfElements = driver.getProblemSize();
   // The number of buckets in our histogram
   const unsigned int numberOfBuckets = 1e3;
-  // some controls for how many times the test is performed
-  const unsigned int numberOfRepeats = 3;
-  const unsigned int numberOfExtraRepeats = 1;
+  if (numberOfElements % numberOfBuckets != 0) {
+    fprintf(stderr, "the number of elements must be a multiple of %u\n",
+            numberOfBuckets);
+    exit(1);
+  }
+
+  Kokkos::initialize();
 
   printf("Creating the input vector \n");
-  vector<unsigned int> input(numberOfElements);
-  std::iota(input.begin(), input.end(), 0);
-  std::random_shuffle(input.begin(), input.end());
+  Utilities::InputVector<unsigned int> input;
+  createInput(driver.getDatasetCacheOptions(), numberOfElements, &input);
+
+  // reading the input and writing the buckets is all the work there is;
+  //  the bucket arithmetic is integer.
+  const Utilities::WorkCounts
+    workCounts(0, sizeof(unsigned int) *
+               double(numberOfElements + numberOfBuckets));
+  Utilities::TestRegistry<vector<unsigned int> >
+    registry(&driver, "", numberOfElements, workCounts, checkAnswer);
+
+  // for weak scaling, the input grows with the number of threads.  the
+  //  number of buckets stays the same, so each one gets more elements.
+  registry.setProblemScaler([&] (const unsigned int workScaleFactor)
+                            -> Utilities::ScaledProblem<vector<unsigned int> > {
+      const Utilities::LargeIndex scaledNumberOfElements =
+        numberOfElements * workScaleFactor;
+      createInput(driver.getDatasetCacheOptions(), scaledNumberOfElements,
+                  &input);
+      return Utilities::ScaledProblem<vector<unsigned int> >
+        (scaledNumberOfElements,
+         Utilities::WorkCounts(0, sizeof(unsigned int) *
+                               double(scaledNumberOfElements +
+                                      numberOfBuckets)),
+         vector<unsigned int>(numberOfBuckets,
+                              scaledNumberOfElements / numberOfBuckets));
+    });
 
   // ===============================================================
   // ********************** < do serial> ***************************
@@ -139,12 +141,8 @@ int main() {
   const SerialTestFunctor serialTestFunctor(input,
                                             numberOfBuckets);
   vector<unsigned int> serialHistogram;
-  double serialElapsedTime;
-  runTimingTest(serialTestFunctor,
-                numberOfRepeats,
-                numberOfExtraRepeats,
-                &serialHistogram,
-                &serialElapsedTime);
+  const Utilities::TimingStatistics serialTimingStatistics =
+    registry.runSerialTest(serialTestFunctor, &serialHistogram);
 
   const unsigned int bucketSize = numberOfElements / numberOfBuckets;
   for (unsigned int bucketIndex = 0;
@@ -156,48 +154,24 @@ int main() {
     }
   }
 
+  registry.runWarmCacheComparison(serialTestFunctor, serialTimingStatistics);
+
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do serial> ***************************
   // ===============================================================
 
-  // we will repeat the computation for each of the numbers of threads
-  vector<unsigned int> numberOfThreadsArray;
-  numberOfThreadsArray.push_back(1);
-  numberOfThreadsArray.push_back(2);
-  numberOfThreadsArray.push_back(4);
-  numberOfThreadsArray.push_back(8);
-  numberOfThreadsArray.push_back(16);
-  numberOfThreadsArray.push_back(24);
+  // each parallel test is run for each of the numbers of threads (or threads
+  //  per block, for cuda) given on the command line
 
   // ===============================================================
   // ********************** < do tbb> ******************************
   // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
-  printf("performing calculations with tbb\n");
-  // for each number of threads
-  for (const unsigned int numberOfThreads :
-         numberOfThreadsArray) {
-
-    // initialize tbb's threading system for this number of threads
-    tbb::task_scheduler_init init(numberOfThreads);
-
-    // perform tbb test
-    const TbbTestFunctor tbbTestFunctor(input,
-                                        numberOfBuckets);
-    double tbbElapsedTime;
-    runTimingTestAndCheckAnswer(tbbTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                serialHistogram,
-                                &tbbElapsedTime);
-
-    // output speedup
-    printf("%3u : time %8.2e speedup %8.2e (%%%5.1f of ideal)\n",
-           numberOfThreads,
-           tbbElapsedTime,
-           serialElapsedTime / tbbElapsedTime,
-           100. * serialElapsedTime / tbbElapsedTime / numberOfThreads);
-  }
+  registry.addTest(Utilities::TbbBackend,
+                   [&] (const unsigned int numberOfThreads) {
+                     return TbbTestFunctor(input, numberOfBuckets,
+                                           numberOfThreads);
+                   });
 
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do tbb> ******************************
@@ -207,127 +181,98 @@ int main() {
   // ********************** < do openmp> ***************************
   // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
-  printf("performing calculations with openmp\n");
-  // for each number of threads
-  for (const unsigned int numberOfThreads :
-         numberOfThreadsArray) {
-
-    // initialize omp's threading system for this number of threads
-    omp_set_num_threads(numberOfThreads);
-
-    // perform tbb test
-    const OmpTestFunctor ompTestFunctor(input,
-                                        numberOfBuckets);
-    double ompElapsedTime;
-    runTimingTestAndCheckAnswer(ompTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                serialHistogram,
-                                &ompElapsedTime);
-
-    // output speedup
-    printf("%3u : time %8.2e speedup %8.2e (%%%5.1f of ideal)\n",
-           numberOfThreads,
-           ompElapsedTime,
-           serialElapsedTime / ompElapsedTime,
-           100. * serialElapsedTime / ompElapsedTime / numberOfThreads);
-  }
+  registry.addTest(Utilities::OmpBackend,
+                   [&] (const unsigned int) {
+                     return OmpTestFunctor(input, numberOfBuckets);
+                   });
 
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do openmp> ***************************
   // ===============================================================
 
+  // ===============================================================
+  // ********************** < do stealing> *************************
+  // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
+
+  registry.addTest(Utilities::StealingBackend,
+                   [&] (const unsigned int) {
+                     return StealingTestFunctor(input, numberOfBuckets);
+                   });
+
+  // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+  // ********************** </do stealing> *************************
+  // ===============================================================
+
+  // ===============================================================
+  // ********************** < do stdpar> ***************************
+  // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
+
+#ifdef HAVE_STDPAR
+  registry.addTest(Utilities::StdParBackend,
+                   [&] (const unsigned int numberOfThreads) {
+                     return StdParTestFunctor(input, numberOfBuckets,
+                                              numberOfThreads);
+                   });
+#endif
+
+  // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+  // ********************** </do stdpar> ***************************
+  // ===============================================================
+
   // ===============================================================
   // ********************** < do cuda> *****************************
   // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
-  // we will repeat the computation for each of the numbers of threads
-  vector<unsigned int> threadsPerBlockArray;
-  threadsPerBlockArray.push_back(4);
-  threadsPerBlockArray.push_back(8);
-  threadsPerBlockArray.push_back(16);
-  threadsPerBlockArray.push_back(32);
-  threadsPerBlockArray.push_back(64);
-  threadsPerBlockArray.push_back(128);
-  threadsPerBlockArray.push_back(256);
-  threadsPerBlockArray.push_back(512);
-
-  printf("performing calculations with cuda\n");
-  // for each number of threads per block
-  for (const unsigned int numberOfThreadsPerBlock :
-         threadsPerBlockArray) {
-
-    // perform cuda test
-    const CudaTestFunctor cudaTestFunctor(input,
-                                          numberOfBuckets,
-                                          numberOfThreadsPerBlock);
-    double cudaElapsedTime;
-    runTimingTestAndCheckAnswer(cudaTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                serialHistogram,
-                                &cudaElapsedTime);
-
-    // output speedup
-    printf("%3u : time %8.2e speedup %8.2e\n",
-           numberOfThreadsPerBlock,
-           cudaElapsedTime,
-           serialElapsedTime / cudaElapsedTime);
-  }
+#ifndef CPU_ONLY
+  registry.addTest(Utilities::CudaBackend,
+                   [&] (const unsigned int numberOfThreadsPerBlock) {
+                     return CudaTestFunctor(input, numberOfBuckets,
+                                            numberOfThreadsPerBlock);
+                   });
+#endif
 
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do cuda> *****************************
   // ===============================================================
 
-  Kokkos::initialize();
-
   // ===============================================================
   // ********************** < do kokkos> ***************************
   // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
-  printf("performing calculations with kokkos omp\n");
-  {
-    // perform kokkos omp test
-    const KokkosTestFunctor<Kokkos::OpenMP> kokkosTestFunctor(input,
+  registry.addTest(Utilities::KokkosOmpBackend,
+                   [&] (const unsigned int) {
+                     return KokkosTestFunctor<Kokkos::OpenMP>(input,
                                                               numberOfBuckets);
-    double kokkosElapsedTime;
-    runTimingTestAndCheckAnswer(kokkosTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                serialHistogram,
-                                &kokkosElapsedTime);
-
-    // output speedup
-    printf("%s time %8.2e speedup %8.2e\n",
-           "kokkos omp",
-           kokkosElapsedTime,
-           serialElapsedTime / kokkosElapsedTime);
-  }
-
-  printf("performing calculations with kokkos cuda\n");
-  {
-    // perform kokkos cuda test
-    const KokkosTestFunctor<Kokkos::Cuda> kokkosTestFunctor(input,
+                   });
+#ifndef CPU_ONLY
+  registry.addTest(Utilities::KokkosCudaBackend,
+                   [&] (const unsigned int) {
+                     return KokkosTestFunctor<Kokkos::Cuda>(input,
                                                             numberOfBuckets);
-    double kokkosElapsedTime;
-    runTimingTestAndCheckAnswer(kokkosTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                serialHistogram,
-                                &kokkosElapsedTime);
-
-    // output speedup
-    printf("%s time %8.2e speedup %8.2e\n",
-           "kokkos cuda",
-           kokkosElapsedTime,
-           serialElapsedTime / kokkosElapsedTime);
-  }
+                   });
+#endif
+#ifdef HAVE_KOKKOS_SERIAL
+  registry.addTest(Utilities::KokkosSerialBackend,
+                   [&] (const unsigned int) {
+                     return KokkosTestFunctor<Kokkos::Serial>(input,
+                                                              numberOfBuckets);
+                   });
+#endif
+#ifdef HAVE_KOKKOS_THREADS
+  registry.addTest(Utilities::KokkosThreadsBackend,
+                   [&] (const unsigned int) {
+                     return KokkosTestFunctor<Kokkos::Threads>(input,
+                                                               numberOfBuckets);
+                   });
+#endif
 
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do kokkos> ***************************
   // ===============================================================
 
+  registry.runTests(serialHistogram, serialTimingStatistics._median);
+
   Kokkos::finalize();
 
-  return 0;
+  return driver.finish();
 }
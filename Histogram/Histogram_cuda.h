@@ -11,7 +11,7 @@ public:
 
   static const CpuOrGpuType ProcessorType = Cpu;
 
-  CudaTestFunctor(const vector<unsigned int> & input,
+  CudaTestFunctor(const Utilities::InputVector<unsigned int> & input,
                   const unsigned int numberOfBuckets,
                   const unsigned int numberOfThreadsPerBlock) :
     _input(input),
@@ -33,7 +33,7 @@ public:
   }
 
 private:
-  const vector<unsigned int> & _input;
+  const Utilities::InputVector<unsigned int> & _input;
   const unsigned int _numberOfBuckets;
   const unsigned int _numberOfThreadsPerBlock;
 };
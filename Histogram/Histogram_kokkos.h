@@ -13,7 +13,7 @@ struct KokkosWorkerFunctor {
   }
 
   KOKKOS_INLINE_FUNCTION
-  void operator()(const unsigned int index) const {
+  void operator()(const Utilities::LargeIndex index) const {
   }
 
 private:
@@ -29,7 +29,7 @@ public:
   static const CpuOrGpuType ProcessorType =
     Utilities::KokkosProcessorTypeConverter<DeviceType>::ProcessorType;
 
-  KokkosTestFunctor(const vector<unsigned int> & input,
+  KokkosTestFunctor(const Utilities::InputVector<unsigned int> & input,
                     const unsigned int numberOfBuckets) :
     _input(input),
     _numberOfBuckets(numberOfBuckets) {
@@ -50,7 +50,7 @@ public:
   }
 
 private:
-  const vector<unsigned int> & _input;
+  const Utilities::InputVector<unsigned int> & _input;
   const unsigned int _numberOfBuckets;
 };
 
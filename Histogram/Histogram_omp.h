@@ -3,6 +3,13 @@
 #define HISTOGRAM_OMP_H
 
 #include "../Utilities.h"
+#include "../Tracer.h"
+#include "../PhaseTimers.h"
+#include "../LoadBalance.h"
+#include "../Workspace.h"
+#include "../PerThreadAccumulator.h"
+
+#include <functional>
 
 // header files for omp
 #include <omp.h>
@@ -12,7 +19,7 @@ public:
 
   static const CpuOrGpuType ProcessorType = Cpu;
 
-  OmpTestFunctor(const vector<unsigned int> & input,
+  OmpTestFunctor(const Utilities::InputVector<unsigned int> & input,
                  const unsigned int numberOfBuckets) :
     _input(input),
     _numberOfBuckets(numberOfBuckets) {
@@ -23,6 +30,49 @@ public:
   computeAnswer(vector<unsigned int> * answer) const {
 
     vector<unsigned int> & histogram = *answer;
+    histogram.resize(_numberOfBuckets);
+
+    // each thread counts into a histogram of its own
+    typedef Utilities::PerThreadAccumulator<unsigned int> ThreadHistograms;
+    const unsigned int numberOfThreads = omp_get_max_threads();
+    const unsigned int numberOfBuckets = _numberOfBuckets;
+    ThreadHistograms & threadHistograms =
+      Utilities::Workspace::getInstance().getObject<ThreadHistograms>(
+        "thread histograms", [=] () {
+          return ThreadHistograms(numberOfThreads, numberOfBuckets, 0);
+        });
+    threadHistograms.reset();
+
+    {
+      const Utilities::ScopedPhase phase("count");
+      const Utilities::LargeIndex numberOfElements = _input.size();
+      const unsigned int bucketSize = numberOfElements / _numberOfBuckets;
+      const unsigned int * const input = &_input[0];
+      // a chunk's worth of elements per iteration, so that marking the
+      //  chunks doesn't cost more than counting them
+      const Utilities::LargeIndex elementsPerChunk = 1 << 16;
+      const Utilities::LargeIndex numberOfChunks =
+        (numberOfElements + elementsPerChunk - 1) / elementsPerChunk;
+      Utilities::setOmpSchedule(omp_sched_static);
+#pragma omp parallel for schedule(runtime)
+      for (Utilities::LargeIndex chunkIndex = 0;
+           chunkIndex < numberOfChunks; ++chunkIndex) {
+        const Utilities::TraceSpan span("count chunk");
+        const Utilities::BusyChunk chunk;
+        unsigned int * const threadHistogram =
+          threadHistograms.getRow(Utilities::getOmpThreadIndex());
+        const Utilities::LargeIndex endIndex =
+          std::min(numberOfElements, (chunkIndex + 1) * elementsPerChunk);
+        for (Utilities::LargeIndex index = chunkIndex * elementsPerChunk;
+             index < endIndex; ++index) {
+          const unsigned int bucketNumber = input[index] / bucketSize;
+          ++threadHistogram[bucketNumber];
+        }
+      }
+    }
+
+    const Utilities::ScopedPhase phase("merge");
+    threadHistograms.combine(&histogram[0], std::plus<unsigned int>());
 
   }
 
@@ -32,7 +82,7 @@ public:
   }
 
 private:
-  const vector<unsigned int> & _input;
+  const Utilities::InputVector<unsigned int> & _input;
   const unsigned int _numberOfBuckets;
 };
 
@@ -3,13 +3,14 @@
 #define HISTOGRAM_SERIAL_H
 
 #include "../Utilities.h"
+#include "../PhaseTimers.h"
 
 class SerialTestFunctor {
 public:
 
   static const CpuOrGpuType ProcessorType = Cpu;
 
-  SerialTestFunctor(const vector<unsigned int> & input,
+  SerialTestFunctor(const Utilities::InputVector<unsigned int> & input,
                     const unsigned int numberOfBuckets) :
     _input(input),
     _numberOfBuckets(numberOfBuckets) {
@@ -20,16 +21,26 @@ public:
   computeAnswer(vector<unsigned int> * answer) const {
 
     vector<unsigned int> & histogram = *answer;
-    histogram.resize(_numberOfBuckets);
-    std::fill(histogram.begin(), histogram.end(), 0);
+    {
+      const Utilities::ScopedPhase phase("clear buckets");
+      histogram.resize(_numberOfBuckets);
+      std::fill(histogram.begin(), histogram.end(), 0);
+    }
 
-    const unsigned int numberOfElements = _input.size();
+    const Utilities::ScopedPhase phase("count");
+    const Utilities::LargeIndex numberOfElements = _input.size();
     const unsigned int bucketSize = numberOfElements / _numberOfBuckets;
-    for (unsigned int index = 0; index < numberOfElements; ++index) {
-      const unsigned int value = _input[index];
-      const unsigned int bucketNumber = value / bucketSize;
-      ++histogram[bucketNumber];
-    }
+    const unsigned int * const input = &_input[0];
+    Utilities::forEachChunk(0, numberOfElements,
+                            [&] (const Utilities::LargeIndex chunkBeginIndex,
+                                 const unsigned int chunkSize) {
+      const unsigned int * const chunk = input + chunkBeginIndex;
+      for (unsigned int index = 0; index < chunkSize; ++index) {
+        const unsigned int value = chunk[index];
+        const unsigned int bucketNumber = value / bucketSize;
+        ++histogram[bucketNumber];
+      }
+    });
 
   }
 
@@ -39,7 +50,7 @@ public:
   }
 
 private:
-  const vector<unsigned int> & _input;
+  const Utilities::InputVector<unsigned int> & _input;
   const unsigned int _numberOfBuckets;
 };
 
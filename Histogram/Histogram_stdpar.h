@@ -0,0 +1,95 @@
+// -*- C++ -*-
+#ifndef HISTOGRAM_STDPAR_H
+#define HISTOGRAM_STDPAR_H
+
+#include "../Utilities.h"
+#include "../Tracer.h"
+#include "../PhaseTimers.h"
+#include "../Workspace.h"
+#include "../StandardParallel.h"
+
+#include <algorithm>
+#include <execution>
+
+class StdParTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  StdParTestFunctor(const Utilities::InputVector<unsigned int> & input,
+                    const unsigned int numberOfBuckets,
+                    const unsigned int numberOfThreads) :
+    _input(input),
+    _numberOfBuckets(numberOfBuckets),
+    _numberOfThreads(numberOfThreads) {
+
+  }
+
+  void
+  computeAnswer(vector<unsigned int> * answer) const {
+
+    vector<unsigned int> & histogram = *answer;
+    histogram.resize(_numberOfBuckets);
+
+    // the algorithms can't tell us which thread runs an iteration, so the
+    //  input is cut into a few chunks per thread, each of which counts into
+    //  a histogram of its own
+    const unsigned int numberOfChunks = 4 * _numberOfThreads;
+    const unsigned int numberOfBuckets = _numberOfBuckets;
+    const Utilities::PerThreadBuffer<unsigned int> chunkHistograms =
+      Utilities::Workspace::getInstance().getPerThreadBuffer<unsigned int>(
+        "chunk histograms", numberOfChunks, numberOfBuckets);
+
+    {
+      const Utilities::ScopedPhase phase("count");
+      const Utilities::LargeIndex numberOfElements = _input.size();
+      const unsigned int bucketSize = numberOfElements / numberOfBuckets;
+      const unsigned int * const input = &_input[0];
+      // par and not par_unseq, because the span can take the tracer's lock
+      std::for_each(std::execution::par,
+                    Utilities::IndexIterator<unsigned int>(0),
+                    Utilities::IndexIterator<unsigned int>(numberOfChunks),
+                    [=] (const unsigned int chunkIndex) {
+        const Utilities::TraceSpan span("count chunk");
+        unsigned int * const chunkHistogram = chunkHistograms[chunkIndex];
+        std::fill(chunkHistogram, chunkHistogram + numberOfBuckets, 0);
+        const Utilities::LargeIndex beginIndex =
+          numberOfElements * chunkIndex / numberOfChunks;
+        const Utilities::LargeIndex endIndex =
+          numberOfElements * (chunkIndex + 1) / numberOfChunks;
+        for (Utilities::LargeIndex index = beginIndex;
+             index < endIndex; ++index) {
+          const unsigned int bucketNumber = input[index] / bucketSize;
+          ++chunkHistogram[bucketNumber];
+        }
+      });
+    }
+
+    const Utilities::ScopedPhase phase("merge");
+    unsigned int * const mergedHistogram = &histogram[0];
+    std::for_each(std::execution::par_unseq,
+                  Utilities::IndexIterator<unsigned int>(0),
+                  Utilities::IndexIterator<unsigned int>(numberOfBuckets),
+                  [=] (const unsigned int bucketNumber) {
+      unsigned int count = 0;
+      for (unsigned int chunkIndex = 0;
+           chunkIndex < numberOfChunks; ++chunkIndex) {
+        count += chunkHistograms[chunkIndex][bucketNumber];
+      }
+      mergedHistogram[bucketNumber] = count;
+    });
+
+  }
+
+  string
+  getName() const {
+    return string("stdpar");
+  }
+
+private:
+  const Utilities::InputVector<unsigned int> & _input;
+  const unsigned int _numberOfBuckets;
+  const unsigned int _numberOfThreads;
+};
+
+#endif // HISTOGRAM_STDPAR_H
@@ -0,0 +1,83 @@
+// -*- C++ -*-
+#ifndef HISTOGRAM_STEALING_H
+#define HISTOGRAM_STEALING_H
+
+#include "../Utilities.h"
+#include "../Tracer.h"
+#include "../PhaseTimers.h"
+#include "../Workspace.h"
+#include "../PerThreadAccumulator.h"
+#include "../WorkStealingPool.h"
+
+#include <functional>
+
+class StealingTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  StealingTestFunctor(const Utilities::InputVector<unsigned int> & input,
+                      const unsigned int numberOfBuckets) :
+    _input(input),
+    _numberOfBuckets(numberOfBuckets) {
+
+  }
+
+  void
+  computeAnswer(vector<unsigned int> * answer) const {
+
+    vector<unsigned int> & histogram = *answer;
+    histogram.resize(_numberOfBuckets);
+
+    // each worker counts into a histogram of its own
+    typedef Utilities::PerThreadAccumulator<unsigned int> ThreadHistograms;
+    const unsigned int numberOfWorkers =
+      Utilities::WorkStealingPool::getInstance().getNumberOfThreads();
+    const unsigned int numberOfBuckets = _numberOfBuckets;
+    ThreadHistograms & threadHistograms =
+      Utilities::Workspace::getInstance().getObject<ThreadHistograms>(
+        "thread histograms", [=] () {
+          return ThreadHistograms(numberOfWorkers, numberOfBuckets, 0);
+        });
+    threadHistograms.reset();
+
+    {
+      const Utilities::ScopedPhase phase("count");
+      const Utilities::LargeIndex numberOfElements = _input.size();
+      const unsigned int bucketSize = numberOfElements / _numberOfBuckets;
+      const unsigned int * const input = &_input[0];
+      Utilities::stealingParallelFor(Utilities::LargeIndex(0),
+                                     numberOfElements,
+                                     Utilities::LargeIndex(1 << 16),
+                                     [&] (const Utilities::LargeIndex
+                                          beginIndex,
+                                          const Utilities::LargeIndex
+                                          endIndex) {
+        const Utilities::TraceSpan span("count chunk");
+        unsigned int * const threadHistogram =
+          threadHistograms.getRow(Utilities::WorkStealingPool::
+                                  getCurrentWorkerIndex());
+        for (Utilities::LargeIndex index = beginIndex;
+             index < endIndex; ++index) {
+          const unsigned int bucketNumber = input[index] / bucketSize;
+          ++threadHistogram[bucketNumber];
+        }
+      });
+    }
+
+    const Utilities::ScopedPhase phase("merge");
+    threadHistograms.combine(&histogram[0], std::plus<unsigned int>());
+
+  }
+
+  string
+  getName() const {
+    return string("stealing");
+  }
+
+private:
+  const Utilities::InputVector<unsigned int> & _input;
+  const unsigned int _numberOfBuckets;
+};
+
+#endif // HISTOGRAM_STEALING_H
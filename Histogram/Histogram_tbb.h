@@ -3,6 +3,13 @@
 #define HISTOGRAM_TBB_H
 
 #include "../Utilities.h"
+#include "../Tracer.h"
+#include "../PhaseTimers.h"
+#include "../LoadBalance.h"
+#include "../Workspace.h"
+#include "../PerThreadAccumulator.h"
+
+#include <functional>
 
 // header files for tbb
 #include <tbb/blocked_range.h>
@@ -14,10 +21,14 @@ public:
 
   static const CpuOrGpuType ProcessorType = Cpu;
 
-  TbbTestFunctor(const vector<unsigned int> & input,
-                 const unsigned int numberOfBuckets) :
+  // the number of threads that tbb was initialized with, which bounds the
+  //  thread indices
+  TbbTestFunctor(const Utilities::InputVector<unsigned int> & input,
+                 const unsigned int numberOfBuckets,
+                 const unsigned int numberOfThreads) :
     _input(input),
-    _numberOfBuckets(numberOfBuckets) {
+    _numberOfBuckets(numberOfBuckets),
+    _numberOfThreads(numberOfThreads) {
 
   }
 
@@ -25,6 +36,41 @@ public:
   computeAnswer(vector<unsigned int> * answer) const {
 
     vector<unsigned int> & histogram = *answer;
+    histogram.resize(_numberOfBuckets);
+
+    // each thread counts into a histogram of its own
+    typedef Utilities::PerThreadAccumulator<unsigned int> ThreadHistograms;
+    const unsigned int numberOfThreads = _numberOfThreads;
+    const unsigned int numberOfBuckets = _numberOfBuckets;
+    ThreadHistograms & threadHistograms =
+      Utilities::Workspace::getInstance().getObject<ThreadHistograms>(
+        "thread histograms", [=] () {
+          return ThreadHistograms(numberOfThreads, numberOfBuckets, 0);
+        });
+    threadHistograms.reset();
+
+    {
+      const Utilities::ScopedPhase phase("count");
+      const Utilities::LargeIndex numberOfElements = _input.size();
+      const unsigned int bucketSize = numberOfElements / _numberOfBuckets;
+      const unsigned int * const input = &_input[0];
+      Utilities::tbbParallelFor(Utilities::LargeIndex(0), numberOfElements,
+                                [&] (const tbb::blocked_range<
+                                       Utilities::LargeIndex> & range) {
+        const Utilities::TraceSpan span("count chunk");
+        const Utilities::BusyChunk chunk;
+        unsigned int * const threadHistogram =
+          threadHistograms.getRow(Utilities::getTbbThreadIndex());
+        for (Utilities::LargeIndex index = range.begin();
+             index != range.end(); ++index) {
+          const unsigned int bucketNumber = input[index] / bucketSize;
+          ++threadHistogram[bucketNumber];
+        }
+      });
+    }
+
+    const Utilities::ScopedPhase phase("merge");
+    threadHistograms.combine(&histogram[0], std::plus<unsigned int>());
 
   }
 
@@ -34,8 +80,9 @@ public:
   }
 
 private:
-  const vector<unsigned int> & _input;
+  const Utilities::InputVector<unsigned int> & _input;
   const unsigned int _numberOfBuckets;
+  const unsigned int _numberOfThreads;
 };
 
 #endif // HISTOGRAM_TBB_H
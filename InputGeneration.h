@@ -0,0 +1,160 @@
+// -*- C++ -*-
+#ifndef INPUT_GENERATION_H
+#define INPUT_GENERATION_H
+
+// the exercises' inputs, made in parallel.  every random number comes from
+//  the counter-based generator with the element's index as its counter, and
+//  the work is split into a fixed number of chunks rather than one per
+//  thread, so the data comes out bit-for-bit the same on any number of omp
+//  threads, and the same from one run to the next.
+//
+//  it only runs on omp, and not on tbb or kokkos as well.  the inputs are
+//  made once, before any backend's tests, and are the same whichever
+//  backend made them, so a version per backend would only be more to
+//  keep bit-for-bit alike.  omp is in every build, and its pool is the one
+//  that --affinity pins at startup, which kokkos's openmp space runs on
+//  too, so the first touch puts the pages near the threads that read them.
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+// header files for omp
+#include <omp.h>
+
+#include "Utilities.h"
+#include "CounterBasedRandom.h"
+
+namespace Utilities {
+
+// what every exercise seeds its input with, unless it has a reason not to
+const uint64_t DefaultInputSeed = 0x5EED5EED;
+
+// goes into every cached dataset's name and header, so that a cache made
+//  by an older generator isn't read back as this one's.  bump it whenever
+//  a change here or in CounterBasedRandom.h changes what comes out.
+const uint32_t InputGeneratorVersion = 1;
+
+// uniform doubles in (lowerBound, upperBound).  different streams of the
+//  same seed are independent, so two arrays filled with streams 0 and 1 are
+//  not copies of each other.
+inline
+void
+fillUniformRandom(const uint64_t seed,
+                  const uint64_t streamIndex,
+                  const double lowerBound,
+                  const double upperBound,
+                  const LargeIndex numberOfEntries,
+                  double * const entries) {
+  const CounterBasedRandomNumberGenerator generator(seed);
+  const double width = upperBound - lowerBound;
+  // each block of 128 bits makes two entries
+#pragma omp parallel for schedule(static)
+  for (LargeIndex pairIndex = 0; pairIndex < (numberOfEntries + 1) / 2;
+       ++pairIndex) {
+    const PhiloxBlock block = generator.generateBlock(pairIndex, streamIndex);
+    const LargeIndex entryIndex = 2 * pairIndex;
+    entries[entryIndex] = lowerBound + width *
+      CounterBasedRandomNumberGenerator::convertToUniformDouble(
+        block._values[0], block._values[1]);
+    if (entryIndex + 1 < numberOfEntries) {
+      entries[entryIndex + 1] = lowerBound + width *
+        CounterBasedRandomNumberGenerator::convertToUniformDouble(
+          block._values[2], block._values[3]);
+    }
+  }
+}
+
+// a uniformly random permutation of 0, 1, ..., numberOfEntries - 1, done as
+//  a scatter into buckets followed by a shuffle of each bucket.  every
+//  element picks a bucket at random, the elements are laid out bucket by
+//  bucket, and then each bucket gets its own fisher-yates shuffle, which is
+//  small enough to stay in cache.  if the buckets are uniform and each
+//  shuffle is, then so is the whole thing.
+template <class Index>
+void
+createRandomPermutation(const uint64_t seed,
+                        const LargeIndex numberOfEntries,
+                        Index * const permutation) {
+  if (numberOfEntries == 0) {
+    return;
+  }
+  const CounterBasedRandomNumberGenerator generator(seed);
+  // these are fixed, and not the number of threads, so that the
+  //  permutation doesn't depend on it
+  const LargeIndex numberOfChunks = 64;
+  const LargeIndex targetBucketSize = 4096;
+  const LargeIndex numberOfBuckets =
+    std::min(LargeIndex(4096),
+             (numberOfEntries + targetBucketSize - 1) / targetBucketSize);
+  const LargeIndex chunkSize =
+    (numberOfEntries + numberOfChunks - 1) / numberOfChunks;
+  // stream 0 picks the buckets and stream 1 + bucket shuffles bucket
+  const auto pickBucket = [&] (const LargeIndex entryIndex) {
+    const uint32_t bits = generator.generateBlock(entryIndex, 0)._values[0];
+    return LargeIndex((uint64_t(bits) * numberOfBuckets) >> 32);
+  };
+
+  // how many of each chunk's elements go to each bucket
+  vector<LargeIndex> offsets(numberOfChunks * numberOfBuckets, 0);
+#pragma omp parallel for schedule(static)
+  for (LargeIndex chunkIndex = 0; chunkIndex < numberOfChunks; ++chunkIndex) {
+    LargeIndex * const chunkCounts = &offsets[chunkIndex * numberOfBuckets];
+    const LargeIndex chunkEnd =
+      std::min(numberOfEntries, (chunkIndex + 1) * chunkSize);
+    for (LargeIndex entryIndex = chunkIndex * chunkSize;
+         entryIndex < chunkEnd; ++entryIndex) {
+      ++chunkCounts[pickBucket(entryIndex)];
+    }
+  }
+
+  // turn the counts into where each chunk starts writing in each bucket,
+  //  with the buckets in order and each bucket's chunks in order
+  vector<LargeIndex> bucketStarts(numberOfBuckets + 1, 0);
+  LargeIndex runningTotal = 0;
+  for (LargeIndex bucketIndex = 0; bucketIndex < numberOfBuckets;
+       ++bucketIndex) {
+    bucketStarts[bucketIndex] = runningTotal;
+    for (LargeIndex chunkIndex = 0; chunkIndex < numberOfChunks;
+         ++chunkIndex) {
+      LargeIndex & offset = offsets[chunkIndex * numberOfBuckets + bucketIndex];
+      const LargeIndex count = offset;
+      offset = runningTotal;
+      runningTotal += count;
+    }
+  }
+  bucketStarts[numberOfBuckets] = runningTotal;
+
+#pragma omp parallel for schedule(static)
+  for (LargeIndex chunkIndex = 0; chunkIndex < numberOfChunks; ++chunkIndex) {
+    LargeIndex * const chunkOffsets = &offsets[chunkIndex * numberOfBuckets];
+    const LargeIndex chunkEnd =
+      std::min(numberOfEntries, (chunkIndex + 1) * chunkSize);
+    for (LargeIndex entryIndex = chunkIndex * chunkSize;
+         entryIndex < chunkEnd; ++entryIndex) {
+      permutation[chunkOffsets[pickBucket(entryIndex)]++] = Index(entryIndex);
+    }
+  }
+
+  // the buckets are about the same size, but not exactly
+#pragma omp parallel for schedule(dynamic)
+  for (LargeIndex bucketIndex = 0; bucketIndex < numberOfBuckets;
+       ++bucketIndex) {
+    Index * const bucket = permutation + bucketStarts[bucketIndex];
+    const LargeIndex bucketSize =
+      bucketStarts[bucketIndex + 1] - bucketStarts[bucketIndex];
+    for (LargeIndex swapIndex = bucketSize - 1; swapIndex > 0; --swapIndex) {
+      // a bucket is far smaller than 2^32, so taking the high bits of the
+      //  product has no bias worth worrying about
+      const uint32_t bits =
+        generator.generateBlock(swapIndex, 1 + bucketIndex)._values[0];
+      const LargeIndex otherIndex =
+        LargeIndex((uint64_t(bits) * (swapIndex + 1)) >> 32);
+      std::swap(bucket[swapIndex], bucket[otherIndex]);
+    }
+  }
+}
+
+}
+
+#endif // INPUT_GENERATION_H
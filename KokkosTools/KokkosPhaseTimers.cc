@@ -0,0 +1,190 @@
+// -*- C++ -*-
+// KokkosPhaseTimers.cc
+// a kokkos profiling tool that times every kernel and deep copy into the
+//  benchmarks' phase timers, so that they show up in each test's breakdown
+//  and on the trace's timeline without the functors having to time them.
+//  kokkos has to be built with profiling, and is pointed at the tool with
+//    KOKKOS_PROFILE_LIBRARY=../KokkosTools/libKokkosPhaseTimers.so ./Histogram
+//  or KOKKOS_TOOLS_LIBS for newer versions.  the benchmarks are linked with
+//  --export-dynamic so that the tool records into their timers and not its
+//  own; a program that's linked without it gets no kokkos phases at all.
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+using std::string;
+using std::vector;
+
+#include "../PhaseTimers.h"
+#include "../Tracer.h"
+
+// header files for omp
+#include <omp.h>
+
+namespace {
+
+struct RunningKernel {
+  string _phaseName;
+  double _startTime;
+  // null when not tracing
+  const char * _traceName;
+};
+
+// kernels can be launched from more than one thread, so they're matched up
+//  by the ids that we hand out
+std::mutex kernelMutex;
+std::map<uint64_t, RunningKernel> runningKernels;
+uint64_t nextKernelId = 0;
+
+// deep copies don't get ids, but they can't overlap on one thread
+thread_local vector<RunningKernel> runningDeepCopies;
+
+const char *
+beginTraceSpan(const string & name) {
+  Utilities::Tracer & tracer = Utilities::Tracer::getInstance();
+  if (tracer.isEnabled() == false) {
+    return NULL;
+  }
+  const char * const traceName = tracer.internName(name);
+  tracer.append(traceName, 'B');
+  return traceName;
+}
+
+void
+endTraceSpan(const char * const traceName) {
+  if (traceName != NULL) {
+    Utilities::Tracer::getInstance().append(traceName, 'E');
+  }
+}
+
+void
+beginKernel(const string & kernelType,
+            const char * const name,
+            uint64_t * const kernelId) {
+  RunningKernel kernel;
+  kernel._phaseName = string("kokkos ") + kernelType + string(" ") + name;
+  kernel._traceName = beginTraceSpan(kernel._phaseName);
+  kernel._startTime = omp_get_wtime();
+  std::lock_guard<std::mutex> lock(kernelMutex);
+  *kernelId = nextKernelId++;
+  runningKernels[*kernelId] = kernel;
+}
+
+void
+endKernel(const uint64_t kernelId) {
+  const double endTime = omp_get_wtime();
+  RunningKernel kernel;
+  {
+    std::lock_guard<std::mutex> lock(kernelMutex);
+    const std::map<uint64_t, RunningKernel>::iterator runningKernel =
+      runningKernels.find(kernelId);
+    if (runningKernel == runningKernels.end()) {
+      return;
+    }
+    kernel = runningKernel->second;
+    runningKernels.erase(runningKernel);
+  }
+  Utilities::PhaseTimers::getInstance().record(kernel._phaseName,
+                                               endTime - kernel._startTime);
+  endTraceSpan(kernel._traceName);
+}
+
+}
+
+// which memory space a deep copy is from or to
+struct KokkosSpaceHandle {
+  char name[64];
+};
+
+extern "C"
+void
+kokkosp_init_library(const int /* loadSequence */,
+                     const uint64_t interfaceVersion,
+                     const uint32_t /* numberOfDevices */,
+                     void * /* deviceInfo */) {
+  printf("kokkos phase timers loaded (interface version %llu)\n",
+         (unsigned long long)interfaceVersion);
+}
+
+extern "C"
+void
+kokkosp_finalize_library() {
+}
+
+extern "C"
+void
+kokkosp_begin_parallel_for(const char * name,
+                           const uint32_t /* deviceId */,
+                           uint64_t * kernelId) {
+  beginKernel("parallel_for", name, kernelId);
+}
+
+extern "C"
+void
+kokkosp_end_parallel_for(const uint64_t kernelId) {
+  endKernel(kernelId);
+}
+
+extern "C"
+void
+kokkosp_begin_parallel_reduce(const char * name,
+                              const uint32_t /* deviceId */,
+                              uint64_t * kernelId) {
+  beginKernel("parallel_reduce", name, kernelId);
+}
+
+extern "C"
+void
+kokkosp_end_parallel_reduce(const uint64_t kernelId) {
+  endKernel(kernelId);
+}
+
+extern "C"
+void
+kokkosp_begin_parallel_scan(const char * name,
+                            const uint32_t /* deviceId */,
+                            uint64_t * kernelId) {
+  beginKernel("parallel_scan", name, kernelId);
+}
+
+extern "C"
+void
+kokkosp_end_parallel_scan(const uint64_t kernelId) {
+  endKernel(kernelId);
+}
+
+extern "C"
+void
+kokkosp_begin_deep_copy(const KokkosSpaceHandle destinationHandle,
+                        const char * destinationName,
+                        const void * /* destinationPointer */,
+                        const KokkosSpaceHandle sourceHandle,
+                        const char * /* sourceName */,
+                        const void * /* sourcePointer */,
+                        const uint64_t /* numberOfBytes */) {
+  RunningKernel deepCopy;
+  deepCopy._phaseName = string("kokkos deep_copy ") + destinationName +
+    string(" (") + sourceHandle.name + string(" to ") +
+    destinationHandle.name + string(")");
+  deepCopy._traceName = beginTraceSpan(deepCopy._phaseName);
+  deepCopy._startTime = omp_get_wtime();
+  runningDeepCopies.push_back(deepCopy);
+}
+
+extern "C"
+void
+kokkosp_end_deep_copy() {
+  const double endTime = omp_get_wtime();
+  if (runningDeepCopies.empty() == true) {
+    return;
+  }
+  const RunningKernel deepCopy = runningDeepCopies.back();
+  runningDeepCopies.pop_back();
+  Utilities::PhaseTimers::getInstance().record(deepCopy._phaseName,
+                                               endTime - deepCopy._startTime);
+  endTraceSpan(deepCopy._traceName);
+}
@@ -0,0 +1,406 @@
+// -*- C++ -*-
+#ifndef LOAD_BALANCE_H
+#define LOAD_BALANCE_H
+
+// how evenly a parallel test's work is spread over its threads, and the
+//  knobs that change that.  a functor wraps each chunk or task of its work
+//  in a BusyChunk, which adds the chunk's time to the busy time of the
+//  thread that runs it, and the harness reports every thread's busy time and
+//  number of chunks per repeat, along with the imbalance factor: the busiest
+//  thread's time over the mean.  1 is perfect, and with 4 threads, 4 means
+//  that one thread did all of the work while the others sat idle.
+//
+//   Utilities::setOmpSchedule(omp_sched_dynamic);
+//   #pragma omp parallel for schedule(runtime)
+//   for (...) {
+//     const Utilities::BusyChunk chunk;
+//     ...
+//   }
+//
+//  the omp loops take their schedule at run time and the tbb loops go
+//  through tbbParallelFor and tbbParallelReduce, so that --schedule,
+//  --partitioner and --grain-size apply to all of them.  a chunk costs two
+//  clock reads, so it goes around a whole chunk and not around each element.
+//  chunks can nest, like tbb's nested loops; all of them are counted, but
+//  only the outermost one on a thread counts towards its busy time.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <algorithm>
+#include <utility>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// header files for omp
+#include <omp.h>
+
+// header files for tbb
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
+
+namespace Utilities {
+
+enum TbbPartitionerType {AutoPartitioner,
+                         SimplePartitioner,
+                         AffinityPartitioner};
+
+// these come from the command line, see BenchmarkDriver.h
+struct SchedulingOptions {
+
+  SchedulingOptions() :
+    _overrideOmpSchedule(false),
+    _ompSchedule(omp_sched_static),
+    _tbbPartitioner(AutoPartitioner),
+    _grainSize(0) {
+  }
+
+  // if not, each omp loop keeps the schedule it was written with
+  bool _overrideOmpSchedule;
+  omp_sched_t _ompSchedule;
+  TbbPartitionerType _tbbPartitioner;
+  // in iterations of whichever loop it's applied to: the chunk size for omp
+  //  and the kokkos range policies and the smallest range for tbb.  0 leaves
+  //  each loop's own.
+  unsigned int _grainSize;
+};
+
+// the names used on the command line and in tuning files
+inline
+string
+getOmpScheduleName(const omp_sched_t ompSchedule) {
+  if (ompSchedule == omp_sched_dynamic) {
+    return string("dynamic");
+  } else if (ompSchedule == omp_sched_guided) {
+    return string("guided");
+  }
+  return string("static");
+}
+
+// returns false if it's not the name of a schedule
+inline
+bool
+parseOmpScheduleName(const string & name,
+                     omp_sched_t * ompSchedule) {
+  const omp_sched_t ompSchedules[] =
+    {omp_sched_static, omp_sched_dynamic, omp_sched_guided};
+  for (const omp_sched_t candidate : ompSchedules) {
+    if (getOmpScheduleName(candidate) == name) {
+      *ompSchedule = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+inline
+string
+getTbbPartitionerName(const TbbPartitionerType tbbPartitioner) {
+  const char * const partitionerNames[] = {"auto", "simple", "affinity"};
+  return string(partitionerNames[tbbPartitioner]);
+}
+
+inline
+bool
+parseTbbPartitionerName(const string & name,
+                        TbbPartitionerType * tbbPartitioner) {
+  const TbbPartitionerType tbbPartitioners[] =
+    {AutoPartitioner, SimplePartitioner, AffinityPartitioner};
+  for (const TbbPartitionerType candidate : tbbPartitioners) {
+    if (getTbbPartitionerName(candidate) == name) {
+      *tbbPartitioner = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+inline
+string
+describeSchedulingOptions(const SchedulingOptions & options) {
+  std::ostringstream description;
+  description << "omp ";
+  if (options._overrideOmpSchedule == false) {
+    description << "as written";
+  } else {
+    description << getOmpScheduleName(options._ompSchedule);
+  }
+  description << ", tbb " << getTbbPartitionerName(options._tbbPartitioner)
+              << " partitioner, grain size ";
+  if (options._grainSize == 0) {
+    description << "default";
+  } else {
+    description << options._grainSize;
+  }
+  return description.str();
+}
+
+struct ThreadActivity {
+
+  ThreadActivity(const long threadId) :
+    _threadId(threadId),
+    _busyTime(0),
+    _numberOfChunks(0) {
+  }
+
+  // -1 for a thread of the test that never ran a chunk
+  long _threadId;
+  double _busyTime;
+  double _numberOfChunks;
+};
+
+// the busiest thread's time over the mean, or 0 if nobody did anything
+inline
+double
+computeImbalanceFactor(const vector<ThreadActivity> & threadActivities) {
+  double totalBusyTime = 0;
+  double maximumBusyTime = 0;
+  for (const ThreadActivity & threadActivity : threadActivities) {
+    totalBusyTime += threadActivity._busyTime;
+    maximumBusyTime = std::max(maximumBusyTime, threadActivity._busyTime);
+  }
+  if (totalBusyTime == 0) {
+    return 0;
+  }
+  return maximumBusyTime / (totalBusyTime / threadActivities.size());
+}
+
+// a test's threads that never ran a chunk don't show up on their own, but
+//  they were there and idle, which is what the imbalance is about
+inline
+void
+addIdleThreads(const unsigned int numberOfThreads,
+               vector<ThreadActivity> * threadActivities) {
+  if (threadActivities->empty() == true) {
+    return;
+  }
+  while (threadActivities->size() < numberOfThreads) {
+    threadActivities->push_back(ThreadActivity(-1));
+  }
+}
+
+class LoadBalance {
+public:
+
+  static
+  LoadBalance &
+  getInstance() {
+    static LoadBalance loadBalance;
+    return loadBalance;
+  }
+
+  void
+  setSchedulingOptions(const SchedulingOptions & options) {
+    _schedulingOptions = options;
+  }
+
+  const SchedulingOptions &
+  getSchedulingOptions() const {
+    return _schedulingOptions;
+  }
+
+  // each thread's activity has cache lines of its own, so that counting
+  //  chunks doesn't have the threads fighting over them
+  struct ThreadSlot {
+
+    ThreadSlot(const long threadId) :
+      _activity(threadId),
+      _depth(0) {
+    }
+
+    ThreadActivity _activity;
+    // how many chunks this thread is inside of
+    unsigned int _depth;
+    char _padding[64];
+  };
+
+  ThreadSlot &
+  getThreadSlot() {
+    // a slot from before the last reset is gone
+    static thread_local ThreadSlot * slot = nullptr;
+    static thread_local unsigned int slotGeneration = 0;
+    if (slot == nullptr || slotGeneration != _generation) {
+      slot = addThreadSlot();
+      slotGeneration = _generation;
+    }
+    return *slot;
+  }
+
+  // forgets every thread.  only call this when nothing is running chunks.
+  void
+  reset() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _slots.clear();
+    ++_generation;
+  }
+
+  // in the order that the threads ran their first chunk
+  vector<ThreadActivity>
+  getThreadActivities() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    vector<ThreadActivity> threadActivities;
+    for (const std::unique_ptr<ThreadSlot> & slot : _slots) {
+      threadActivities.push_back(slot->_activity);
+    }
+    return threadActivities;
+  }
+
+private:
+
+  LoadBalance() :
+    _generation(1) {
+  }
+
+  LoadBalance(const LoadBalance &);
+  LoadBalance & operator=(const LoadBalance &);
+
+  ThreadSlot *
+  addThreadSlot() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _slots.push_back(std::unique_ptr<ThreadSlot>(
+                       new ThreadSlot(syscall(SYS_gettid))));
+    return _slots.back().get();
+  }
+
+  SchedulingOptions _schedulingOptions;
+  unsigned int _generation;
+  mutable std::mutex _mutex;
+  vector<std::unique_ptr<ThreadSlot> > _slots;
+};
+
+class BusyChunk {
+public:
+
+  BusyChunk() :
+    _slot(LoadBalance::getInstance().getThreadSlot()),
+    _startTime(omp_get_wtime()) {
+    ++_slot._depth;
+  }
+
+  ~BusyChunk() {
+    --_slot._depth;
+    ++_slot._activity._numberOfChunks;
+    if (_slot._depth == 0) {
+      _slot._activity._busyTime += omp_get_wtime() - _startTime;
+    }
+  }
+
+private:
+  BusyChunk(const BusyChunk &);
+  BusyChunk & operator=(const BusyChunk &);
+
+  LoadBalance::ThreadSlot & _slot;
+  const double _startTime;
+};
+
+// a kokkos functor whose every call is a chunk.  its call operator is host
+//  code, so it's only for the host spaces, and it's only for functors whose
+//  calls are whole blocks of work, like a monte carlo chunk or a team.
+template <class Functor>
+struct KokkosBusyFunctor : public Functor {
+
+  explicit
+  KokkosBusyFunctor(const Functor & functor) :
+    Functor(functor) {
+  }
+
+  template <class... Arguments>
+  void
+  operator()(Arguments &&... arguments) const {
+    const BusyChunk chunk;
+    Functor::operator()(std::forward<Arguments>(arguments)...);
+  }
+};
+
+// the functor to hand to kokkos: marked on the host spaces, and as it is
+//  on the device, where there's no BusyChunk to be had
+template <bool IsOnHost, class Functor>
+struct KokkosChunkedFunctor {
+  typedef Functor Type;
+};
+
+template <class Functor>
+struct KokkosChunkedFunctor<true, Functor> {
+  typedef KokkosBusyFunctor<Functor> Type;
+};
+
+// for the omp loops with schedule(runtime) that this thread starts next:
+//  the schedule from the command line if there is one, or else the one that
+//  the loop was written for.  the chunk size is the grain size if one was
+//  given, or else the schedule's default.
+inline
+void
+setOmpSchedule(const omp_sched_t defaultSchedule) {
+  const SchedulingOptions & options =
+    LoadBalance::getInstance().getSchedulingOptions();
+  omp_set_schedule((options._overrideOmpSchedule == true) ?
+                   options._ompSchedule : defaultSchedule,
+                   options._grainSize);
+}
+
+// the chunk size for the kokkos loops that start next, to hand to
+//  LargeRangePolicy::create.  0 leaves kokkos's own.
+inline
+unsigned int
+getKokkosChunkSize() {
+  return LoadBalance::getInstance().getSchedulingOptions()._grainSize;
+}
+
+// tbb::parallel_for over [beginIndex, endIndex) with the partitioner and
+//  grain size from the command line.  an affinity partitioner remembers
+//  where the ranges ran last time, so each loop has its own, and a loop
+//  that can run on several threads at once, like the inner loop of nested
+//  parallelism, should call tbb directly instead.  a grain size of 0 leaves
+//  the range at tbb's default of 1.
+template <class Index, class Body>
+void
+tbbParallelFor(const Index beginIndex,
+               const Index endIndex,
+               const Body & body) {
+  const SchedulingOptions & options =
+    LoadBalance::getInstance().getSchedulingOptions();
+  const tbb::blocked_range<Index> range(beginIndex, endIndex,
+                                        std::max(1u, options._grainSize));
+  if (options._tbbPartitioner == SimplePartitioner) {
+    tbb::parallel_for(range, body, tbb::simple_partitioner());
+  } else if (options._tbbPartitioner == AffinityPartitioner) {
+    static tbb::affinity_partitioner affinityPartitioner;
+    tbb::parallel_for(range, body, affinityPartitioner);
+  } else {
+    tbb::parallel_for(range, body, tbb::auto_partitioner());
+  }
+}
+
+// the same for tbb::parallel_reduce
+template <class Index, class Value, class Body, class Join>
+Value
+tbbParallelReduce(const Index beginIndex,
+                  const Index endIndex,
+                  const Value & identity,
+                  const Body & body,
+                  const Join & join) {
+  const SchedulingOptions & options =
+    LoadBalance::getInstance().getSchedulingOptions();
+  const tbb::blocked_range<Index> range(beginIndex, endIndex,
+                                        std::max(1u, options._grainSize));
+  if (options._tbbPartitioner == SimplePartitioner) {
+    return tbb::parallel_reduce(range, identity, body, join,
+                                tbb::simple_partitioner());
+  } else if (options._tbbPartitioner == AffinityPartitioner) {
+    static tbb::affinity_partitioner affinityPartitioner;
+    return tbb::parallel_reduce(range, identity, body, join,
+                                affinityPartitioner);
+  }
+  return tbb::parallel_reduce(range, identity, body, join,
+                              tbb::auto_partitioner());
+}
+
+}
+
+#endif // LOAD_BALANCE_H
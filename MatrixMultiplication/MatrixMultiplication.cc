@@ -6,6 +6,7 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <climits>
 #include <vector>
 #include <array>
 #include <string>
@@ -21,23 +22,25 @@ using std::chrono::duration_cast;
 
 // header file containing some uninteresting ickies
 #include "../Utilities.h"
+#include "../BenchmarkDriver.h"
+#include "../InputGeneration.h"
 
 // header files for various implementations
 #include "MatrixMultiplication_serial.h"
 #include "MatrixMultiplication_tbb.h"
 #include "MatrixMultiplication_omp.h"
+#include "MatrixMultiplication_stealing.h"
+#ifdef HAVE_STDPAR
+#include "MatrixMultiplication_stdpar.h"
+#endif
+#ifndef CPU_ONLY
 #include "MatrixMultiplication_cuda.h"
+#endif
 #include "MatrixMultiplication_kokkos.h"
 
 // header file for kokkos so that i can specify device types here
 #include <Kokkos_Core.hpp>
 
-// header file so that i can set the number of threads for tbb
-#include <tbb/task_scheduler_init.h>
-
-// header file so that i can set the number of threads for omp
-#include <omp.h>
-
 // NOTE: all matrices in this program are a vector<double> and are assumed
 //  to be in row-major order, though i guess it doesn't actually matter as long
 //  as you're consistent
@@ -53,11 +56,11 @@ checkAnswer(const vector<double> & correctAnswer,
     exit(1);
   }
 
-  for (unsigned int entryIndex = 0;
+  for (size_t entryIndex = 0;
        entryIndex < correctAnswer.size(); ++entryIndex) {
     if (std::abs(correctAnswer[entryIndex] -
                  testAnswer[entryIndex]) > 1e-4) {
-      fprintf(stderr, "%s answer[%u] is wrong: %lf instead of %lf\n",
+      fprintf(stderr, "%s answer[%zu] is wrong: %lf instead of %lf\n",
               testName.c_str(), entryIndex,
               testAnswer[entryIndex], correctAnswer[entryIndex]);
       exit(1);
@@ -65,85 +68,95 @@ checkAnswer(const vector<double> & correctAnswer,
   }
 }
 
-template <class TestFunctor>
+// fill both matrices with uniform random numbers, the same ones every time
+//  for the same size, whatever the number of threads that makes them.  they
+//  come from the dataset cache if they're there.
 void
-runTimingTest(const TestFunctor & testFunctor,
-              const unsigned int numberOfRepeats,
-              const unsigned int numberOfExtraRepeats,
-              vector<double> * rowMajorAnswer,
-              double * elapsedTime) {
-
-  high_resolution_clock::time_point tic;
-
-  double thisTestsTime = 0;
-  for (unsigned int repeatIndex = 0;
-       repeatIndex < numberOfRepeats + numberOfExtraRepeats; ++repeatIndex) {
-
-    // reset the device
-    Utilities::resetProcessorForTiming(TestFunctor::ProcessorType);
-
-    // start timing
-    if (repeatIndex >= numberOfExtraRepeats) {
-      tic = high_resolution_clock::now();
-    }
-
-    // run the test
-    testFunctor.computeAnswer(rowMajorAnswer);
-
-    // stop timing
-    if (repeatIndex >= numberOfExtraRepeats) {
-      const high_resolution_clock::time_point toc =
-        high_resolution_clock::now();
-      thisTestsTime += duration_cast<duration<double> >(toc - tic).count();
-    }
+createMatrices(const Utilities::DatasetCacheOptions & cacheOptions,
+               const unsigned int matrixSize,
+               Utilities::InputVector<double> * leftMatrix,
+               Utilities::InputVector<double> * rightMatrix) {
+  const Utilities::LargeIndex numberOfEntries =
+    Utilities::LargeIndex(matrixSize) * matrixSize;
+  // the left matrix is stream 0 of the seed and the right is stream 1
+  const char * const matrixNames[2] = {"leftMatrix", "rightMatrix"};
+  Utilities::InputVector<double> * const matrices[2] =
+    {leftMatrix, rightMatrix};
+  for (unsigned int streamIndex = 0; streamIndex < 2; ++streamIndex) {
+    Utilities::loadOrCreateDataset(cacheOptions,
+                                   Utilities::DatasetDescription(
+                                     matrixNames[streamIndex], "uniform01",
+                                     Utilities::DefaultInputSeed,
+                                     numberOfEntries),
+                                   [&] (double * entries) {
+                                     Utilities::fillUniformRandom(
+                                       Utilities::DefaultInputSeed,
+                                       streamIndex, 0, 1,
+                                       numberOfEntries, entries);
+                                   },
+                                   matrices[streamIndex]);
   }
-
-  *elapsedTime = thisTestsTime / numberOfRepeats;
 }
 
-template <class TestFunctor>
-void
-runTimingTestAndCheckAnswer(const TestFunctor & testFunctor,
-                            const unsigned int numberOfRepeats,
-                            const unsigned int numberOfExtraRepeats,
-                            const vector<double> & correctAnswer,
-                            double * elapsedTime) {
-
-  // compute the answer and measure elapsed time
-  vector<double> rowMajorAnswer;
-  runTimingTest(testFunctor,
-                numberOfRepeats,
-                numberOfExtraRepeats,
-                &rowMajorAnswer,
-                elapsedTime);
-
-  // check the answer
-  checkAnswer(correctAnswer, rowMajorAnswer, testFunctor.getName());
+// a multiply and an add for each of n^3 terms, and at the least reading
+//  both inputs and writing the output once
+Utilities::WorkCounts
+computeWorkCounts(const unsigned int matrixSize) {
+  return Utilities::WorkCounts(2. * matrixSize * matrixSize * matrixSize,
+                               3. * sizeof(double) * matrixSize * matrixSize);
 }
 
-int main() {
-
-  // change the matrixSize to control the amount
-  //  of work done.
-  const unsigned int matrixSize = 512 * 3;
-  // some controls for how many times the test is performed
-  const unsigned int numberOfRepeats = 3;
-  const unsigned int numberOfExtraRepeats = 1;
-
-  // create a c++11 random number generator
-  std::mt19937 randomNumberEngine;
-  std::uniform_real_distribution<double> randomNumberGenerator(0, 1);
-
-  vector<double> leftMatrix(matrixSize * matrixSize);
-  vector<double> rightMatrix(matrixSize * matrixSize);
-  for (unsigned int row = 0; row < matrixSize; ++row) {
-    for (unsigned int col = 0; col < matrixSize; ++col) {
-      leftMatrix[row * matrixSize + col] =
-        randomNumberGenerator(randomNumberEngine);
-      rightMatrix[row * matrixSize + col] =
-        randomNumberGenerator(randomNumberEngine);
-    }
+int main(int argc, char * argv[]) {
+
+  // the matrix size controls the amount of work done.  it comes from the
+  //  command line, along with the threads and backends to use and how many
+  //  times each test is performed; see --help.
+  Utilities::BenchmarkDriver driver("MatrixMultiplication", argc, argv,
+                                    512 * 3);
+  if (driver.getProblemSize() > Utilities::LargeIndex(UINT_MAX)) {
+    fprintf(stderr, "a matrix size of %lld doesn't fit in an unsigned int\n",
+            (long long)driver.getProblemSize());
+    exit(1);
   }
+  const unsigned int baseMatrixSize = driver.getProblemSize();
+  // not const, because weak scaling grows it
+  unsigned int matrixSize = baseMatrixSize;
+
+  Kokkos::initialize();
+
+  const Utilities::LargeIndex numberOfEntries =
+    Utilities::LargeIndex(matrixSize) * matrixSize;
+  Utilities::InputVector<double> leftMatrix;
+  Utilities::InputVector<double> rightMatrix;
+  createMatrices(driver.getDatasetCacheOptions(), matrixSize,
+                 &leftMatrix, &rightMatrix);
+
+  Utilities::TestRegistry<vector<double> >
+    registry(&driver, "", matrixSize, computeWorkCounts(matrixSize),
+             checkAnswer);
+
+  // for weak scaling, the matrices grow so that the n^3 work goes up with
+  //  the number of threads.  the only thing to check the bigger products
+  //  against is the serial version, which is run, untimed, once per size.
+  registry.setProblemScaler([&] (const unsigned int workScaleFactor)
+                            -> Utilities::ScaledProblem<vector<double> > {
+      const double scaledMatrixSize =
+        std::round(baseMatrixSize * std::cbrt(double(workScaleFactor)));
+      if (scaledMatrixSize > UINT_MAX) {
+        fprintf(stderr, "%u times the work needs a matrix size of %.0f, "
+                "which doesn't fit in an unsigned int\n",
+                workScaleFactor, scaledMatrixSize);
+        exit(1);
+      }
+      matrixSize = scaledMatrixSize;
+      createMatrices(driver.getDatasetCacheOptions(), matrixSize,
+                     &leftMatrix, &rightMatrix);
+      vector<double> scaledResultMatrix;
+      SerialTestFunctor(leftMatrix, rightMatrix, matrixSize)
+        .computeAnswer(&scaledResultMatrix);
+      return Utilities::ScaledProblem<vector<double> >
+        (matrixSize, computeWorkCounts(matrixSize), scaledResultMatrix);
+    });
 
   // ===============================================================
   // ********************** < do serial> ***************************
@@ -153,52 +166,29 @@ int main() {
   const SerialTestFunctor serialTestFunctor(leftMatrix,
                                             rightMatrix,
                                             matrixSize);
-  vector<double> serialResultMatrix(matrixSize * matrixSize);
-  double serialElapsedTime;
-  runTimingTest(serialTestFunctor,
-                numberOfRepeats,
-                numberOfExtraRepeats,
-                &serialResultMatrix,
-                &serialElapsedTime);
+  vector<double> serialResultMatrix(numberOfEntries);
+  const Utilities::TimingStatistics serialTimingStatistics =
+    registry.runSerialTest(serialTestFunctor, &serialResultMatrix);
+
+  registry.runWarmCacheComparison(serialTestFunctor, serialTimingStatistics);
 
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do serial> ***************************
   // ===============================================================
 
-  // we will repeat the computation for each of the numbers of threads
-  vector<unsigned int> numberOfThreadsArray;
-  numberOfThreadsArray.push_back(sysconf(_SC_NPROCESSORS_ONLN));
+  // each parallel test is run for each of the numbers of threads (or threads
+  //  per block, for cuda) given on the command line
 
   // ===============================================================
   // ********************** < do tbb> ******************************
   // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
-  printf("performing calculations with tbb\n");
-  // for each number of threads
-  for (const unsigned int numberOfThreads :
-         numberOfThreadsArray) {
-
-    // initialize tbb's threading system for this number of threads
-    tbb::task_scheduler_init init(numberOfThreads);
-
-    // perform tbb test
-    const TbbTestFunctor tbbTestFunctor(leftMatrix,
-                                        rightMatrix,
-                                        matrixSize);
-    double tbbElapsedTime;
-    runTimingTestAndCheckAnswer(tbbTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                serialResultMatrix,
-                                &tbbElapsedTime);
-
-    // output speedup
-    printf("%3u : time %8.2e speedup %8.2e (%%%5.1f of ideal)\n",
-           numberOfThreads,
-           tbbElapsedTime,
-           serialElapsedTime / tbbElapsedTime,
-           100. * serialElapsedTime / tbbElapsedTime / numberOfThreads);
-  }
+  registry.addTest(Utilities::TbbBackend,
+                   [&] (const unsigned int) {
+                     return TbbTestFunctor(leftMatrix,
+                                           rightMatrix,
+                                           matrixSize);
+                   });
 
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do tbb> ******************************
@@ -208,124 +198,109 @@ int main() {
   // ********************** < do openmp> ***************************
   // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
-  printf("performing calculations with openmp\n");
-  // for each number of threads
-  for (const unsigned int numberOfThreads :
-         numberOfThreadsArray) {
-
-    // initialize omp's threading system for this number of threads
-    omp_set_num_threads(numberOfThreads);
-
-    // perform tbb test
-    const OmpTestFunctor ompTestFunctor(leftMatrix,
-                                        rightMatrix,
-                                        matrixSize);
-    double ompElapsedTime;
-    runTimingTestAndCheckAnswer(ompTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                serialResultMatrix,
-                                &ompElapsedTime);
-
-    // output speedup
-    printf("%3u : time %8.2e speedup %8.2e (%%%5.1f of ideal)\n",
-           numberOfThreads,
-           ompElapsedTime,
-           serialElapsedTime / ompElapsedTime,
-           100. * serialElapsedTime / ompElapsedTime / numberOfThreads);
-  }
+  registry.addTest(Utilities::OmpBackend,
+                   [&] (const unsigned int) {
+                     return OmpTestFunctor(leftMatrix,
+                                           rightMatrix,
+                                           matrixSize);
+                   });
 
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do openmp> ***************************
   // ===============================================================
 
+  // ===============================================================
+  // ********************** < do stealing> *************************
+  // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
+
+  registry.addTest(Utilities::StealingBackend,
+                   [&] (const unsigned int) {
+                     return StealingTestFunctor(leftMatrix,
+                                                rightMatrix,
+                                                matrixSize);
+                   });
+
+  // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+  // ********************** </do stealing> *************************
+  // ===============================================================
+
+  // ===============================================================
+  // ********************** < do stdpar> ***************************
+  // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
+
+#ifdef HAVE_STDPAR
+  registry.addTest(Utilities::StdParBackend,
+                   [&] (const unsigned int) {
+                     return StdParTestFunctor(leftMatrix,
+                                              rightMatrix,
+                                              matrixSize);
+                   });
+#endif
+
+  // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+  // ********************** </do stdpar> ***************************
+  // ===============================================================
+
   // ===============================================================
   // ********************** < do cuda> *****************************
   // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
-  // we will repeat the computation for each of the numbers of threads
-  vector<unsigned int> threadsPerBlockArray;
-  threadsPerBlockArray.push_back(256);
-
-  printf("performing calculations with cuda\n");
-  // for each number of threads per block
-  for (const unsigned int numberOfThreadsPerBlock :
-         threadsPerBlockArray) {
-
-    // perform cuda test
-    const CudaTestFunctor cudaTestFunctor(leftMatrix,
-                                          rightMatrix,
-                                          matrixSize,
-                                          numberOfThreadsPerBlock);
-    double cudaElapsedTime;
-    runTimingTestAndCheckAnswer(cudaTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                serialResultMatrix,
-                                &cudaElapsedTime);
-
-    // output speedup
-    printf("%3u : time %8.2e speedup %8.2e\n",
-           numberOfThreadsPerBlock,
-           cudaElapsedTime,
-           serialElapsedTime / cudaElapsedTime);
-  }
+#ifndef CPU_ONLY
+  registry.addTest(Utilities::CudaBackend,
+                   [&] (const unsigned int numberOfThreadsPerBlock) {
+                     return CudaTestFunctor(leftMatrix,
+                                            rightMatrix,
+                                            matrixSize,
+                                            numberOfThreadsPerBlock);
+                   });
+#endif
 
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do cuda> *****************************
   // ===============================================================
 
-  Kokkos::initialize();
-
   // ===============================================================
   // ********************** < do kokkos> ***************************
   // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
-  printf("performing calculations with kokkos omp\n");
-  {
-    // perform kokkos omp test
-    const KokkosTestFunctor<Kokkos::OpenMP> kokkosTestFunctor(leftMatrix,
+  registry.addTest(Utilities::KokkosOmpBackend,
+                   [&] (const unsigned int) {
+                     return KokkosTestFunctor<Kokkos::OpenMP>(leftMatrix,
                                                               rightMatrix,
                                                               matrixSize);
-    double kokkosElapsedTime;
-    runTimingTestAndCheckAnswer(kokkosTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                serialResultMatrix,
-                                &kokkosElapsedTime);
-
-    // output speedup
-    printf("%s time %8.2e speedup %8.2e\n",
-           "kokkos omp",
-           kokkosElapsedTime,
-           serialElapsedTime / kokkosElapsedTime);
-  }
-
-  printf("performing calculations with kokkos cuda\n");
-  {
-    // perform kokkos cuda test
-    const KokkosTestFunctor<Kokkos::Cuda> kokkosTestFunctor(leftMatrix,
+                   });
+#ifndef CPU_ONLY
+  registry.addTest(Utilities::KokkosCudaBackend,
+                   [&] (const unsigned int) {
+                     return KokkosTestFunctor<Kokkos::Cuda>(leftMatrix,
                                                             rightMatrix,
                                                             matrixSize);
-    double kokkosElapsedTime;
-    runTimingTestAndCheckAnswer(kokkosTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                serialResultMatrix,
-                                &kokkosElapsedTime);
-
-    // output speedup
-    printf("%s time %8.2e speedup %8.2e\n",
-           "kokkos cuda",
-           kokkosElapsedTime,
-           serialElapsedTime / kokkosElapsedTime);
-  }
+                   });
+#endif
+#ifdef HAVE_KOKKOS_SERIAL
+  registry.addTest(Utilities::KokkosSerialBackend,
+                   [&] (const unsigned int) {
+                     return KokkosTestFunctor<Kokkos::Serial>(leftMatrix,
+                                                              rightMatrix,
+                                                              matrixSize);
+                   });
+#endif
+#ifdef HAVE_KOKKOS_THREADS
+  registry.addTest(Utilities::KokkosThreadsBackend,
+                   [&] (const unsigned int) {
+                     return KokkosTestFunctor<Kokkos::Threads>(leftMatrix,
+                                                               rightMatrix,
+                                                               matrixSize);
+                   });
+#endif
 
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do kokkos> ***************************
   // ===============================================================
 
+  registry.runTests(serialResultMatrix, serialTimingStatistics._median);
+
   Kokkos::finalize();
 
-  return 0;
+  return driver.finish();
 }
@@ -9,8 +9,8 @@ public:
 
   static const CpuOrGpuType ProcessorType = Cpu;
 
-  CudaTestFunctor(const vector<double> & leftMatrix,
-                  const vector<double> & rightMatrix,
+  CudaTestFunctor(const Utilities::InputVector<double> & leftMatrix,
+                  const Utilities::InputVector<double> & rightMatrix,
                   const unsigned int matrixSize,
                   const unsigned int numberOfThreadsPerBlock) :
     _leftMatrix(leftMatrix),
@@ -33,8 +33,8 @@ public:
   }
 
 private:
-  const vector<double> & _leftMatrix;
-  const vector<double> & _rightMatrix;
+  const Utilities::InputVector<double> & _leftMatrix;
+  const Utilities::InputVector<double> & _rightMatrix;
   const unsigned int _matrixSize;
   const unsigned int _numberOfThreadsPerBlock;
 };
@@ -13,7 +13,7 @@ struct KokkosWorkerFunctor {
   }
 
   KOKKOS_INLINE_FUNCTION
-  void operator()(const unsigned int index) const {
+  void operator()(const Utilities::LargeIndex index) const {
   }
 
 private:
@@ -29,8 +29,8 @@ public:
   static const CpuOrGpuType ProcessorType =
     Utilities::KokkosProcessorTypeConverter<DeviceType>::ProcessorType;
 
-  KokkosTestFunctor(const vector<double> & leftMatrix,
-                    const vector<double> & rightMatrix,
+  KokkosTestFunctor(const Utilities::InputVector<double> & leftMatrix,
+                    const Utilities::InputVector<double> & rightMatrix,
                     const unsigned int matrixSize) :
     _leftMatrix(leftMatrix),
     _rightMatrix(rightMatrix),
@@ -52,8 +52,8 @@ public:
   }
 
 private:
-  const vector<double> & _leftMatrix;
-  const vector<double> & _rightMatrix;
+  const Utilities::InputVector<double> & _leftMatrix;
+  const Utilities::InputVector<double> & _rightMatrix;
   const unsigned int _matrixSize;
 };
 
@@ -3,6 +3,9 @@
 #define MATRIXMULTIPLICATION_OMP_H
 
 #include "../Utilities.h"
+#include "../Tracer.h"
+#include "../LoadBalance.h"
+#include "MatrixMultiplication_row.h"
 
 // header files for omp
 #include <omp.h>
@@ -12,8 +15,8 @@ public:
 
   static const CpuOrGpuType ProcessorType = Cpu;
 
-  OmpTestFunctor(const vector<double> & leftMatrix,
-                 const vector<double> & rightMatrix,
+  OmpTestFunctor(const Utilities::InputVector<double> & leftMatrix,
+                 const Utilities::InputVector<double> & rightMatrix,
                  const unsigned int matrixSize) :
     _leftMatrix(leftMatrix),
     _rightMatrix(rightMatrix),
@@ -25,7 +28,20 @@ public:
   computeAnswer(vector<double> * answer) const {
 
     vector<double> & resultMatrix = *answer;
-
+    const int matrixSize = _matrixSize;
+    resultMatrix.resize(Utilities::LargeIndex(matrixSize) * matrixSize);
+
+    // a row is already matrixSize^2 multiply-adds, so each one is a chunk
+    Utilities::setOmpSchedule(omp_sched_static);
+#pragma omp parallel for schedule(runtime)
+    for (int row = 0; row < matrixSize; ++row) {
+      const Utilities::TraceSpan span("row");
+      const Utilities::BusyChunk chunk;
+      const double * const leftRow =
+        &_leftMatrix[Utilities::LargeIndex(row) * matrixSize];
+      multiplyRow(leftRow, &_rightMatrix[0], matrixSize,
+                  &resultMatrix[Utilities::LargeIndex(row) * matrixSize]);
+    }
   }
 
   string
@@ -34,8 +50,8 @@ public:
   }
 
 private:
-  const vector<double> & _leftMatrix;
-  const vector<double> & _rightMatrix;
+  const Utilities::InputVector<double> & _leftMatrix;
+  const Utilities::InputVector<double> & _rightMatrix;
   const unsigned int _matrixSize;
 };
 
@@ -0,0 +1,36 @@
+// -*- C++ -*-
+#ifndef MATRIXMULTIPLICATION_ROW_H
+#define MATRIXMULTIPLICATION_ROW_H
+
+#include "../Utilities.h"
+#include "../CpuDispatch.h"
+
+// one row of the result, which is what the cpu versions hand to each thread.
+//  it walks down the right matrix a row at a time and adds a multiple of it
+//  into the result row, so that the inner loop reads contiguous memory and
+//  vectorizes, which the dot product down a column doesn't.  each entry
+//  still adds up its terms in the same order as the dot product.  it's
+//  compiled for each instruction set, so --isa changes what it runs.
+inline
+void
+multiplyRow(const double * const leftRow,
+            const double * const rightMatrix,
+            const unsigned int matrixSize,
+            double * const resultRow) {
+  Utilities::dispatchInstructionSet([=] () {
+      for (unsigned int col = 0; col < matrixSize; ++col) {
+        resultRow[col] = 0;
+      }
+      for (unsigned int dummy = 0; dummy < matrixSize; ++dummy) {
+        const double left = leftRow[dummy];
+        const double * const rightRow =
+          rightMatrix + Utilities::LargeIndex(dummy) * matrixSize;
+#pragma omp simd
+        for (unsigned int col = 0; col < matrixSize; ++col) {
+          resultRow[col] += left * rightRow[col];
+        }
+      }
+    });
+}
+
+#endif // MATRIXMULTIPLICATION_ROW_H
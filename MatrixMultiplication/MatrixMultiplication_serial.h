@@ -3,14 +3,15 @@
 #define MATRIXMULTIPLICATION_SERIAL_H
 
 #include "../Utilities.h"
+#include "MatrixMultiplication_row.h"
 
 class SerialTestFunctor {
 public:
 
   static const CpuOrGpuType ProcessorType = Cpu;
 
-  SerialTestFunctor(const vector<double> & leftMatrix,
-                    const vector<double> & rightMatrix,
+  SerialTestFunctor(const Utilities::InputVector<double> & leftMatrix,
+                    const Utilities::InputVector<double> & rightMatrix,
                     const unsigned int matrixSize) :
     _leftMatrix(leftMatrix),
     _rightMatrix(rightMatrix),
@@ -23,18 +24,15 @@ public:
 
     vector<double> & resultMatrix = *answer;
     const unsigned int matrixSize = _matrixSize;
-    resultMatrix.resize(matrixSize * matrixSize);
+    resultMatrix.resize(Utilities::LargeIndex(matrixSize) * matrixSize);
 
+    // the loop counters fit in 32 bits, but the flattened indices don't
+    //  once the matrices get big, so the row offsets are 64-bit.
     for (unsigned int row = 0; row < matrixSize; ++row) {
-      for (unsigned int col = 0; col < matrixSize; ++col) {
-        double result = 0;
-        for (unsigned int dummy = 0; dummy < matrixSize; ++dummy) {
-          result +=
-            _leftMatrix[row * matrixSize + dummy] *
-            _rightMatrix[dummy * matrixSize + col];
-        }
-        resultMatrix[row * matrixSize + col] = result;
-      }
+      const double * const leftRow =
+        &_leftMatrix[Utilities::LargeIndex(row) * matrixSize];
+      multiplyRow(leftRow, &_rightMatrix[0], matrixSize,
+                  &resultMatrix[Utilities::LargeIndex(row) * matrixSize]);
     }
   }
 
@@ -44,8 +42,8 @@ public:
   }
 
 private:
-  const vector<double> & _leftMatrix;
-  const vector<double> & _rightMatrix;
+  const Utilities::InputVector<double> & _leftMatrix;
+  const Utilities::InputVector<double> & _rightMatrix;
   const unsigned int _matrixSize;
 };
 
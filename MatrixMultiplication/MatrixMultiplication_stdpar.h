@@ -0,0 +1,62 @@
+// -*- C++ -*-
+#ifndef MATRIXMULTIPLICATION_STDPAR_H
+#define MATRIXMULTIPLICATION_STDPAR_H
+
+#include "../Utilities.h"
+#include "../Tracer.h"
+#include "../StandardParallel.h"
+#include "MatrixMultiplication_row.h"
+
+#include <algorithm>
+#include <execution>
+
+class StdParTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  StdParTestFunctor(const Utilities::InputVector<double> & leftMatrix,
+                    const Utilities::InputVector<double> & rightMatrix,
+                    const unsigned int matrixSize) :
+    _leftMatrix(leftMatrix),
+    _rightMatrix(rightMatrix),
+    _matrixSize(matrixSize) {
+
+  }
+
+  void
+  computeAnswer(vector<double> * answer) const {
+
+    vector<double> & resultMatrix = *answer;
+    const unsigned int matrixSize = _matrixSize;
+    resultMatrix.resize(Utilities::LargeIndex(matrixSize) * matrixSize);
+
+    // each row of the result is written by one iteration.  it's par and
+    //  not par_unseq, because the span can take the tracer's lock.
+    const double * const leftMatrix = &_leftMatrix[0];
+    const double * const rightMatrix = &_rightMatrix[0];
+    double * const result = &resultMatrix[0];
+    std::for_each(std::execution::par,
+                  Utilities::IndexIterator<unsigned int>(0),
+                  Utilities::IndexIterator<unsigned int>(matrixSize),
+                  [=] (const unsigned int row) {
+      const Utilities::TraceSpan span("row");
+      const double * const leftRow =
+        leftMatrix + Utilities::LargeIndex(row) * matrixSize;
+      multiplyRow(leftRow, rightMatrix, matrixSize,
+                  result + Utilities::LargeIndex(row) * matrixSize);
+    });
+  }
+
+  string
+  getName() const {
+    return string("stdpar");
+  }
+
+private:
+  const Utilities::InputVector<double> & _leftMatrix;
+  const Utilities::InputVector<double> & _rightMatrix;
+  const unsigned int _matrixSize;
+};
+
+#endif // MATRIXMULTIPLICATION_STDPAR_H
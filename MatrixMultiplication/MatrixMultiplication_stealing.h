@@ -0,0 +1,57 @@
+// -*- C++ -*-
+#ifndef MATRIXMULTIPLICATION_STEALING_H
+#define MATRIXMULTIPLICATION_STEALING_H
+
+#include "../Utilities.h"
+#include "../Tracer.h"
+#include "../WorkStealingPool.h"
+#include "MatrixMultiplication_row.h"
+
+class StealingTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  StealingTestFunctor(const Utilities::InputVector<double> & leftMatrix,
+                      const Utilities::InputVector<double> & rightMatrix,
+                      const unsigned int matrixSize) :
+    _leftMatrix(leftMatrix),
+    _rightMatrix(rightMatrix),
+    _matrixSize(matrixSize) {
+
+  }
+
+  void
+  computeAnswer(vector<double> * answer) const {
+
+    vector<double> & resultMatrix = *answer;
+    const unsigned int matrixSize = _matrixSize;
+    resultMatrix.resize(Utilities::LargeIndex(matrixSize) * matrixSize);
+
+    // a row is already matrixSize^2 multiply-adds, so each task gets as
+    //  few rows as it takes to keep every worker busy
+    Utilities::stealingParallelFor(0u, matrixSize, 1u,
+                                   [&] (const unsigned int beginRow,
+                                        const unsigned int endRow) {
+      const Utilities::TraceSpan span("rows");
+      for (unsigned int row = beginRow; row < endRow; ++row) {
+        const double * const leftRow =
+          &_leftMatrix[Utilities::LargeIndex(row) * matrixSize];
+        multiplyRow(leftRow, &_rightMatrix[0], matrixSize,
+                    &resultMatrix[Utilities::LargeIndex(row) * matrixSize]);
+      }
+    });
+  }
+
+  string
+  getName() const {
+    return string("stealing");
+  }
+
+private:
+  const Utilities::InputVector<double> & _leftMatrix;
+  const Utilities::InputVector<double> & _rightMatrix;
+  const unsigned int _matrixSize;
+};
+
+#endif // MATRIXMULTIPLICATION_STEALING_H
@@ -3,6 +3,9 @@
 #define MATRIXMULTIPLICATION_TBB_H
 
 #include "../Utilities.h"
+#include "../Tracer.h"
+#include "../LoadBalance.h"
+#include "MatrixMultiplication_row.h"
 
 // header files for tbb
 #include <tbb/blocked_range.h>
@@ -14,8 +17,8 @@ public:
 
   static const CpuOrGpuType ProcessorType = Cpu;
 
-  TbbTestFunctor(const vector<double> & leftMatrix,
-                    const vector<double> & rightMatrix,
+  TbbTestFunctor(const Utilities::InputVector<double> & leftMatrix,
+                    const Utilities::InputVector<double> & rightMatrix,
                     const unsigned int matrixSize) :
     _leftMatrix(leftMatrix),
     _rightMatrix(rightMatrix),
@@ -27,7 +30,21 @@ public:
   computeAnswer(vector<double> * answer) const {
 
     vector<double> & resultMatrix = *answer;
-
+    const unsigned int matrixSize = _matrixSize;
+    resultMatrix.resize(Utilities::LargeIndex(matrixSize) * matrixSize);
+
+    Utilities::tbbParallelFor(0u, matrixSize,
+                              [&] (const tbb::blocked_range<unsigned int> &
+                                   range) {
+      const Utilities::TraceSpan span("rows");
+      const Utilities::BusyChunk chunk;
+      for (unsigned int row = range.begin(); row != range.end(); ++row) {
+        const double * const leftRow =
+          &_leftMatrix[Utilities::LargeIndex(row) * matrixSize];
+        multiplyRow(leftRow, &_rightMatrix[0], matrixSize,
+                    &resultMatrix[Utilities::LargeIndex(row) * matrixSize]);
+      }
+    });
   }
 
   string
@@ -36,8 +53,8 @@ public:
   }
 
 private:
-  const vector<double> & _leftMatrix;
-  const vector<double> & _rightMatrix;
+  const Utilities::InputVector<double> & _leftMatrix;
+  const Utilities::InputVector<double> & _rightMatrix;
   const unsigned int _matrixSize;
 };
 
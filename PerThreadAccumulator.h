@@ -0,0 +1,237 @@
+// -*- C++ -*-
+#ifndef PER_THREAD_ACCUMULATOR_H
+#define PER_THREAD_ACCUMULATOR_H
+
+// per-thread partials for the reductions that are written by hand, like a
+//  partial sum or a partial histogram: a row of entries for each thread,
+//  which only that thread writes, and a combine at the end.  each row is an
+//  allocation of its own, padded out to whole cache lines so that no two
+//  threads write to the same one, and it's made and first touched by the
+//  thread that owns it, so that its pages are on that thread's numa node.
+//  a reset puts every row back to the identity the next time that its owner
+//  asks for it, so one can be kept in the workspace between repeats.
+//
+//   Utilities::PerThreadAccumulator<double> partialSums(
+//     omp_get_max_threads(), 1, 0.);
+//   #pragma omp parallel
+//   {
+//     double * const partialSum =
+//       partialSums.getRow(Utilities::getOmpThreadIndex());
+//     ...
+//   }
+//   double sum;
+//   partialSums.combine(&sum, std::plus<double>());
+//
+//  a thread index has to be unique among the threads that are running at
+//  once, so it comes from whichever runtime the threads belong to: omp, tbb,
+//  kokkos or the work-stealing pool.  the rows are combined in the order of
+//  their thread indices, so the result doesn't depend on which thread
+//  finished first.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <memory>
+#include <new>
+#include <algorithm>
+#include <type_traits>
+
+// header files for omp
+#include <omp.h>
+
+#include "Workspace.h"
+#include "TbbVersion.h"
+
+namespace Utilities {
+
+inline
+unsigned int
+getOmpThreadIndex() {
+  return omp_get_thread_num();
+}
+
+// the calling thread's rank in kokkos's pool, which is below
+//  getKokkosNumberOfThreadIndices.  the hardware thread id isn't: it can be
+//  the number of the core that the thread is bound to.
+template <class ExecutionSpace>
+unsigned int
+getKokkosThreadIndex() {
+  return ExecutionSpace::thread_pool_rank();
+}
+
+// how many rows an accumulator needs for getKokkosThreadIndex: the size of
+//  kokkos's pool, which is however many threads kokkos was initialized with,
+//  and which is what concurrency() returns in the kokkoses that have it.
+//  it's neither the number of hardware threads nor the number of threads
+//  that the omp tests are using.
+template <class ExecutionSpace>
+unsigned int
+getKokkosNumberOfThreadIndices() {
+  return ExecutionSpace::thread_pool_size();
+}
+
+template <class T>
+class PerThreadAccumulator {
+public:
+
+  static_assert(std::is_trivially_destructible<T>::value,
+                "per-thread accumulators hold plain values");
+
+  PerThreadAccumulator(const unsigned int numberOfThreads,
+                       const size_t numberOfEntries,
+                       const T & identity) :
+    _numberOfEntries(numberOfEntries),
+    _identity(identity),
+    _generation(1),
+    _numberOfThreads(numberOfThreads),
+    _rows(allocateRows(numberOfThreads)) {
+  }
+
+  // so that the workspace can keep one
+  PerThreadAccumulator(PerThreadAccumulator && other) :
+    _numberOfEntries(other._numberOfEntries),
+    _identity(other._identity),
+    _generation(other._generation),
+    _numberOfThreads(other._numberOfThreads),
+    _rows(other._rows) {
+    other._numberOfThreads = 0;
+    other._rows = nullptr;
+  }
+
+  ~PerThreadAccumulator() {
+    for (unsigned int threadIndex = 0; threadIndex < _numberOfThreads;
+         ++threadIndex) {
+      free(_rows[threadIndex]._entries);
+    }
+    free(_rows);
+  }
+
+  unsigned int
+  getNumberOfThreads() const {
+    return _numberOfThreads;
+  }
+
+  size_t
+  getNumberOfEntries() const {
+    return _numberOfEntries;
+  }
+
+  // every row starts over from the identity.  only call this when nothing
+  //  is using the rows.
+  void
+  reset() {
+    ++_generation;
+  }
+
+  // only the thread with this index calls this, and it's the only one that
+  //  touches the row until the combine
+  T *
+  getRow(const unsigned int threadIndex) {
+    if (threadIndex >= _numberOfThreads) {
+      fprintf(stderr, "thread index %u is past the %u threads of a "
+              "per-thread accumulator\n", threadIndex, _numberOfThreads);
+      exit(1);
+    }
+    Row & row = _rows[threadIndex];
+    if (row._entries == nullptr) {
+      const size_t numberOfBytes =
+        ((_numberOfEntries * sizeof(T) + WorkspaceAlignment - 1) /
+         WorkspaceAlignment) * WorkspaceAlignment;
+      void * memory = NULL;
+      if (posix_memalign(&memory, WorkspaceAlignment,
+                         std::max(numberOfBytes, WorkspaceAlignment)) != 0) {
+        fprintf(stderr, "cannot allocate %zu bytes for thread %u of a "
+                "per-thread accumulator\n", numberOfBytes, threadIndex);
+        exit(1);
+      }
+      row._entries = static_cast<T *>(memory);
+    }
+    if (row._generation != _generation) {
+      std::uninitialized_fill_n(row._entries, _numberOfEntries, _identity);
+      row._generation = _generation;
+    }
+    return row._entries;
+  }
+
+  // result[entryIndex] = join(...join(identity, row0[entryIndex])...,
+  //  rowN[entryIndex]) over the rows that were used since the last reset.
+  //  it's serial, so that it doesn't wake up some other runtime's threads
+  //  in the middle of a test; a caller with rows big enough to be worth it
+  //  can split them up with combineEntries on its own threads.
+  template <class Join>
+  void
+  combine(T * const result,
+          const Join & join) const {
+    combineEntries(0, _numberOfEntries, result, join);
+  }
+
+  // the same for the entries in [beginEntry, endEntry), which go in the
+  //  same places in result
+  template <class Join>
+  void
+  combineEntries(const size_t beginEntry,
+                 const size_t endEntry,
+                 T * const result,
+                 const Join & join) const {
+    for (size_t entryIndex = beginEntry; entryIndex < endEntry;
+         ++entryIndex) {
+      T combined = _identity;
+      for (unsigned int threadIndex = 0; threadIndex < _numberOfThreads;
+           ++threadIndex) {
+        const Row & row = _rows[threadIndex];
+        if (row._generation == _generation) {
+          combined = join(combined, row._entries[entryIndex]);
+        }
+      }
+      result[entryIndex] = combined;
+    }
+  }
+
+private:
+
+  // the rows' own memory is padded, and so are the rows, because their
+  //  owners write the generation.  new and vector don't have to honor an
+  //  alignment this big before c++17, so the rows are allocated by hand.
+  struct alignas(WorkspaceAlignment) Row {
+
+    Row() :
+      _entries(nullptr),
+      _generation(0) {
+    }
+
+    T * _entries;
+    // the accumulator's generation when the entries were last reset
+    unsigned int _generation;
+  };
+
+  PerThreadAccumulator(const PerThreadAccumulator &);
+  PerThreadAccumulator & operator=(const PerThreadAccumulator &);
+
+  static
+  Row *
+  allocateRows(const unsigned int numberOfThreads) {
+    void * memory = NULL;
+    if (posix_memalign(&memory, WorkspaceAlignment,
+                       std::max(1u, numberOfThreads) * sizeof(Row)) != 0) {
+      fprintf(stderr, "cannot allocate the rows of a per-thread accumulator "
+              "for %u threads\n", numberOfThreads);
+      exit(1);
+    }
+    Row * const rows = static_cast<Row *>(memory);
+    for (unsigned int threadIndex = 0; threadIndex < numberOfThreads;
+         ++threadIndex) {
+      new (&rows[threadIndex]) Row();
+    }
+    return rows;
+  }
+
+  const size_t _numberOfEntries;
+  const T _identity;
+  unsigned int _generation;
+  unsigned int _numberOfThreads;
+  Row * _rows;
+};
+
+}
+
+#endif // PER_THREAD_ACCUMULATOR_H
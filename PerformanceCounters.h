@@ -0,0 +1,259 @@
+// -*- C++ -*-
+#ifndef PERFORMANCE_COUNTERS_H
+#define PERFORMANCE_COUNTERS_H
+
+// hardware counters around each timed repeat, read with linux's
+//  perf_event_open.  a counter only counts the one thread it was opened on,
+//  and the thread pools of tbb, omp and kokkos are already running by the
+//  time we start, so we open one set of counters per thread of the process
+//  and add them up.
+//
+//  that's every thread of the process, and not only the ones running the
+//  test.  a thread's counters only count while it's on a cpu, so threads
+//  that are blocked, like the cache flusher's parked helpers or a tbb
+//  scheduler's sleeping workers, add nothing.  threads that spin while they
+//  wait for work do add cycles and instructions: the test's own idle
+//  threads at its barriers, which is part of what the test costs, and
+//  another runtime's threads that are still spinning after its last test,
+//  which isn't.  omp's threads spin for a while after each parallel region
+//  unless OMP_WAIT_POLICY=passive, so set that when comparing counts across
+//  runtimes.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+namespace Utilities {
+
+enum CounterType {CycleCounter,
+                  InstructionCounter,
+                  LastLevelCacheMissCounter,
+                  BranchMissCounter,
+                  DataTlbMissCounter,
+                  NumberOfCounterTypes};
+
+inline
+string
+getCounterName(const CounterType counterType) {
+  const char * const counterNames[NumberOfCounterTypes] =
+    {"cycles", "instructions", "llcMisses", "branchMisses", "dtlbMisses"};
+  return string(counterNames[counterType]);
+}
+
+struct CounterValues {
+
+  CounterValues() :
+    _collected(false) {
+    for (unsigned int counterIndex = 0;
+         counterIndex < NumberOfCounterTypes; ++counterIndex) {
+      _values[counterIndex] = 0;
+      _available[counterIndex] = false;
+    }
+  }
+
+  // false if counters weren't asked for
+  bool _collected;
+  // a counter the kernel or the hardware wouldn't give us stays unavailable
+  bool _available[NumberOfCounterTypes];
+  // summed over all threads.  these are doubles because the kernel scales
+  //  them up when it had to multiplex the hardware between counters.
+  double _values[NumberOfCounterTypes];
+};
+
+class PerformanceCounters {
+public:
+
+  // there's one set of counters for the whole process
+  static
+  PerformanceCounters &
+  getInstance() {
+    static PerformanceCounters performanceCounters;
+    return performanceCounters;
+  }
+
+  ~PerformanceCounters() {
+    for (const std::pair<const pid_t, ThreadCounters> & thread : _threads) {
+      closeThreadCounters(thread.second);
+    }
+  }
+
+  // zero and enable the counters of every thread in the process, opening
+  //  counters on any thread that has appeared since the last time.
+  void
+  start() {
+    updateThreads();
+    for (const std::pair<const pid_t, ThreadCounters> & thread : _threads) {
+      for (const int fileDescriptor : thread.second._fileDescriptors) {
+        if (fileDescriptor >= 0) {
+          ioctl(fileDescriptor, PERF_EVENT_IOC_RESET, 0);
+          ioctl(fileDescriptor, PERF_EVENT_IOC_ENABLE, 0);
+        }
+      }
+    }
+  }
+
+  CounterValues
+  stop() {
+    CounterValues counterValues;
+    counterValues._collected = true;
+    for (const std::pair<const pid_t, ThreadCounters> & thread : _threads) {
+      for (unsigned int counterIndex = 0;
+           counterIndex < NumberOfCounterTypes; ++counterIndex) {
+        const int fileDescriptor =
+          thread.second._fileDescriptors[counterIndex];
+        if (fileDescriptor < 0) {
+          continue;
+        }
+        ioctl(fileDescriptor, PERF_EVENT_IOC_DISABLE, 0);
+        // the count, and how long the counter was enabled and how long it
+        //  actually had the hardware
+        uint64_t readings[3];
+        if (read(fileDescriptor, readings, sizeof(readings)) !=
+            ssize_t(sizeof(readings))) {
+          continue;
+        }
+        counterValues._available[counterIndex] = true;
+        if (readings[2] > 0) {
+          counterValues._values[counterIndex] +=
+            double(readings[0]) * double(readings[1]) / double(readings[2]);
+        }
+      }
+    }
+    return counterValues;
+  }
+
+private:
+
+  struct ThreadCounters {
+    // -1 for counters that couldn't be opened
+    int _fileDescriptors[NumberOfCounterTypes];
+  };
+
+  PerformanceCounters() :
+    _warnedAboutUnavailableCounters(false) {
+  }
+
+  PerformanceCounters(const PerformanceCounters &);
+  PerformanceCounters & operator=(const PerformanceCounters &);
+
+  static
+  int
+  openCounter(const pid_t threadId, const CounterType counterType) {
+    perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    switch (counterType) {
+    case CycleCounter:
+      attributes.type = PERF_TYPE_HARDWARE;
+      attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case InstructionCounter:
+      attributes.type = PERF_TYPE_HARDWARE;
+      attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case LastLevelCacheMissCounter:
+      attributes.type = PERF_TYPE_HW_CACHE;
+      attributes.config = PERF_COUNT_HW_CACHE_LL |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case BranchMissCounter:
+      attributes.type = PERF_TYPE_HARDWARE;
+      attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    case DataTlbMissCounter:
+      attributes.type = PERF_TYPE_HW_CACHE;
+      attributes.config = PERF_COUNT_HW_CACHE_DTLB |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    default:
+      return -1;
+    }
+    attributes.disabled = 1;
+    // user space only, which is all that an unprivileged user gets anyway
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(__NR_perf_event_open, &attributes, threadId, -1, -1, 0);
+  }
+
+  static
+  void
+  closeThreadCounters(const ThreadCounters & threadCounters) {
+    for (const int fileDescriptor : threadCounters._fileDescriptors) {
+      if (fileDescriptor >= 0) {
+        close(fileDescriptor);
+      }
+    }
+  }
+
+  // open counters on new threads and close the ones on threads that have
+  //  exited, like the workers of a tbb scheduler that has been torn down.
+  void
+  updateThreads() {
+    std::set<pid_t> threadIds;
+    DIR * directory = opendir("/proc/self/task");
+    if (directory == NULL) {
+      return;
+    }
+    while (const struct dirent * entry = readdir(directory)) {
+      if (entry->d_name[0] != '.') {
+        threadIds.insert(atoi(entry->d_name));
+      }
+    }
+    closedir(directory);
+
+    for (std::map<pid_t, ThreadCounters>::iterator thread = _threads.begin();
+         thread != _threads.end(); ) {
+      if (threadIds.count(thread->first) == 0) {
+        closeThreadCounters(thread->second);
+        thread = _threads.erase(thread);
+      } else {
+        ++thread;
+      }
+    }
+
+    for (const pid_t threadId : threadIds) {
+      if (_threads.count(threadId) > 0) {
+        continue;
+      }
+      ThreadCounters threadCounters;
+      for (unsigned int counterIndex = 0;
+           counterIndex < NumberOfCounterTypes; ++counterIndex) {
+        threadCounters._fileDescriptors[counterIndex] =
+          openCounter(threadId, CounterType(counterIndex));
+        if (threadCounters._fileDescriptors[counterIndex] < 0 &&
+            _warnedAboutUnavailableCounters == false) {
+          fprintf(stderr, "cannot open the %s counter (%s), it will be "
+                  "reported as unavailable; see "
+                  "/proc/sys/kernel/perf_event_paranoid\n",
+                  getCounterName(CounterType(counterIndex)).c_str(),
+                  strerror(errno));
+          _warnedAboutUnavailableCounters = true;
+        }
+      }
+      _threads[threadId] = threadCounters;
+    }
+  }
+
+  std::map<pid_t, ThreadCounters> _threads;
+  bool _warnedAboutUnavailableCounters;
+};
+
+}
+
+#endif // PERFORMANCE_COUNTERS_H
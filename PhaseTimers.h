@@ -0,0 +1,136 @@
+// -*- C++ -*-
+#ifndef PHASE_TIMERS_H
+#define PHASE_TIMERS_H
+
+// where the time inside one call to computeAnswer goes.  a functor wraps
+//  each phase of its work in a ScopedPhase, and the harness adds the phases
+//  up over the timed repeats and reports them next to the test's total, so
+//  that allocating, copying, the kernel itself and the final merge can be
+//  told apart.  kokkos's kernels and deep copies are timed without any of
+//  that by the profiling tool in KokkosTools, which reports into the same
+//  place.
+//
+//   {
+//     const Utilities::ScopedPhase phase("merge");
+//     ...
+//   }
+//
+//  each phase costs two clock reads and a lock, so they go around whole
+//  phases and not inside loops.  phases can nest; a phase's time includes
+//  that of the phases inside it.  when tracing, phases are also spans on
+//  the timeline.
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+// header files for omp
+#include <omp.h>
+
+#include "Tracer.h"
+
+namespace Utilities {
+
+struct PhaseTime {
+
+  PhaseTime(const string & name) :
+    _name(name),
+    _time(0),
+    _numberOfCalls(0) {
+  }
+
+  string _name;
+  double _time;
+  double _numberOfCalls;
+};
+
+class PhaseTimers {
+public:
+
+  // there's one set for the whole process, which the kokkos profiling tool
+  //  finds too, because the linker makes the function-local static unique
+  static
+  PhaseTimers &
+  getInstance() {
+    static PhaseTimers phaseTimers;
+    return phaseTimers;
+  }
+
+  // phases can end on any thread, such as the ones that kokkos's tool
+  //  callbacks come in on
+  void
+  record(const string & name,
+         const double elapsedTime) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const std::map<string, size_t>::const_iterator phaseIndex =
+      _phaseIndices.find(name);
+    if (phaseIndex == _phaseIndices.end()) {
+      _phaseIndices[name] = _phaseTimes.size();
+      _phaseTimes.push_back(PhaseTime(name));
+    }
+    PhaseTime & phaseTime = _phaseTimes[_phaseIndices[name]];
+    phaseTime._time += elapsedTime;
+    ++phaseTime._numberOfCalls;
+  }
+
+  void
+  reset() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _phaseIndices.clear();
+    _phaseTimes.clear();
+  }
+
+  // in the order that they first happened
+  vector<PhaseTime>
+  getPhaseTimes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _phaseTimes;
+  }
+
+private:
+
+  PhaseTimers() {
+  }
+
+  PhaseTimers(const PhaseTimers &);
+  PhaseTimers & operator=(const PhaseTimers &);
+
+  mutable std::mutex _mutex;
+  std::map<string, size_t> _phaseIndices;
+  vector<PhaseTime> _phaseTimes;
+};
+
+class ScopedPhase {
+public:
+
+  ScopedPhase(const string & name) :
+    _name(name),
+    _traceName(Tracer::getInstance().isEnabled() ?
+               Tracer::getInstance().internName(name) : nullptr),
+    _startTime(omp_get_wtime()) {
+    if (_traceName != nullptr) {
+      Tracer::getInstance().append(_traceName, 'B');
+    }
+  }
+
+  ~ScopedPhase() {
+    PhaseTimers::getInstance().record(_name, omp_get_wtime() - _startTime);
+    if (_traceName != nullptr) {
+      Tracer::getInstance().append(_traceName, 'E');
+    }
+  }
+
+private:
+  ScopedPhase(const ScopedPhase &);
+  ScopedPhase & operator=(const ScopedPhase &);
+
+  const string _name;
+  // null when not tracing
+  const char * const _traceName;
+  const double _startTime;
+};
+
+}
+
+#endif // PHASE_TIMERS_H
@@ -0,0 +1,262 @@
+// -*- C++ -*-
+#ifndef ROOFLINE_H
+#define ROOFLINE_H
+
+// where a test sits on this machine's roofline.  every test declares how
+//  many flops it does and how many bytes it has to move per run, and at
+//  startup we measure the two roofs: memory bandwidth with a stream triad
+//  and flop throughput with independent chains of multiply-adds.  the
+//  attainable time is then the longer of the two, and a test is reported
+//  as a percentage of that rather than only as a speedup over serial, which
+//  flatters a slow serial version.
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <memory>
+
+// header files for omp
+#include <omp.h>
+
+#include "Utilities.h"
+#include "CpuDispatch.h"
+
+namespace Utilities {
+
+// libm's sin is range reduction and a polynomial, which is about this many
+//  flops.  the integration exercises count their sins with it.
+const double FlopsPerSin = 20;
+
+// the work of one run of a test
+struct WorkCounts {
+
+  WorkCounts(const double flops,
+             const double bytes) :
+    _flops(flops),
+    _bytes(bytes) {
+  }
+
+  double _flops;
+  // to and from memory, counting each input and output once
+  double _bytes;
+};
+
+struct MachinePeaks {
+
+  MachinePeaks() :
+    _bandwidth(0),
+    _flopRate(0) {
+  }
+
+  // bytes per second
+  double _bandwidth;
+  // flops per second
+  double _flopRate;
+};
+
+// the best of a few stream triads, a[i] = b[i] + s * c[i], on every core,
+//  over arrays that are each four times the last-level cache, as far as
+//  that fits.  like stream, this counts three arrays' worth of bytes per
+//  triad and ignores the write-allocate.
+inline
+double
+measureTriadBandwidth() {
+  const size_t lastLevelCacheSize =
+    CacheFlusher::getInstance().getLastLevelCacheSize();
+  // at least 64 MB each, and at most 256 MB for all three together so that
+  //  small nodes don't swap
+  const size_t arraySize =
+    std::min(std::max(4 * lastLevelCacheSize, size_t(64) << 20),
+             (size_t(256) << 20) / 3);
+  const long numberOfEntries = arraySize / sizeof(double);
+  std::unique_ptr<double[]> aArray(new double[numberOfEntries]);
+  std::unique_ptr<double[]> bArray(new double[numberOfEntries]);
+  std::unique_ptr<double[]> cArray(new double[numberOfEntries]);
+  double * const a = aArray.get();
+  double * const b = bArray.get();
+  double * const c = cArray.get();
+  // first touch with the same schedule as the triad
+#pragma omp parallel for schedule(static)
+  for (long index = 0; index < numberOfEntries; ++index) {
+    a[index] = 0;
+    b[index] = 1;
+    c[index] = 2;
+  }
+
+  const double scalar = 3;
+  double bestTime = INFINITY;
+  for (unsigned int repeatIndex = 0; repeatIndex < 5; ++repeatIndex) {
+    const double tic = omp_get_wtime();
+#pragma omp parallel for schedule(static)
+    for (long index = 0; index < numberOfEntries; ++index) {
+      a[index] = b[index] + scalar * c[index];
+    }
+    const double toc = omp_get_wtime();
+    bestTime = std::min(bestTime, toc - tic);
+  }
+  // so that the optimizer can't decide the triads are pointless
+  volatile double deOptimizer = a[numberOfEntries / 2];
+  ignoreUnusedVariables(deOptimizer);
+  return 3. * numberOfEntries * sizeof(double) / bestTime;
+}
+
+// numberOfIterations multiply-adds on each of the accumulators, which are
+//  locals so that they stay in registers in each instruction set's copy.
+//  returns their sum, so that the optimizer can't drop them.
+template <unsigned int NumberOfAccumulators>
+inline
+__attribute__((always_inline))
+double
+runFmaKernel(const unsigned int numberOfIterations,
+             const double seed) {
+  double accumulators[NumberOfAccumulators];
+  for (unsigned int accumulatorIndex = 0;
+       accumulatorIndex < NumberOfAccumulators; ++accumulatorIndex) {
+    accumulators[accumulatorIndex] = accumulatorIndex + seed;
+  }
+  const double multiplier = 0.999999;
+  const double addend = 1e-7;
+  for (unsigned int iteration = 0;
+       iteration < numberOfIterations; ++iteration) {
+#pragma omp simd
+    for (unsigned int accumulatorIndex = 0;
+         accumulatorIndex < NumberOfAccumulators; ++accumulatorIndex) {
+      accumulators[accumulatorIndex] =
+        accumulators[accumulatorIndex] * multiplier + addend;
+    }
+  }
+  double sum = 0;
+  for (unsigned int accumulatorIndex = 0;
+       accumulatorIndex < NumberOfAccumulators; ++accumulatorIndex) {
+    sum += accumulators[accumulatorIndex];
+  }
+  return sum;
+}
+
+// every thread updates enough independent accumulators to keep its
+//  multiply-add units busy through their latency: twelve vector registers'
+//  worth, which covers two units with a latency of up to six cycles and
+//  still fits in sse2's and avx2's sixteen registers.  this measures the
+//  peak of the instruction set that the kernels are dispatched to, so the
+//  multiply and the add are only fused from avx2 up.
+inline
+double
+measureFmaRate() {
+  const InstructionSet instructionSet =
+    CpuDispatch::getInstance().getInstructionSet();
+  const unsigned int numberOfAccumulators =
+    (instructionSet == Avx512InstructionSet) ? 12 * 8 :
+    (instructionSet == Avx2InstructionSet) ? 12 * 4 : 12 * 2;
+  const unsigned int numberOfIterations = 1 << 22;
+  double bestTime = INFINITY;
+  unsigned int numberOfThreads = 1;
+  double sink = 0;
+  for (unsigned int repeatIndex = 0; repeatIndex < 3; ++repeatIndex) {
+    const double tic = omp_get_wtime();
+#pragma omp parallel reduction(+:sink)
+    {
+      const double seed = omp_get_thread_num();
+      double threadSum = 0;
+      dispatchInstructionSet([&] () {
+          if (numberOfAccumulators == 12 * 8) {
+            threadSum = runFmaKernel<12 * 8>(numberOfIterations, seed);
+          } else if (numberOfAccumulators == 12 * 4) {
+            threadSum = runFmaKernel<12 * 4>(numberOfIterations, seed);
+          } else {
+            threadSum = runFmaKernel<12 * 2>(numberOfIterations, seed);
+          }
+        });
+      sink += threadSum;
+#pragma omp single
+      numberOfThreads = omp_get_num_threads();
+    }
+    const double toc = omp_get_wtime();
+    bestTime = std::min(bestTime, toc - tic);
+  }
+  volatile double deOptimizer = sink;
+  ignoreUnusedVariables(deOptimizer);
+  return 2. * numberOfAccumulators * double(numberOfIterations) *
+    numberOfThreads / bestTime;
+}
+
+inline
+MachinePeaks
+measureMachinePeaks() {
+  MachinePeaks peaks;
+  peaks._bandwidth = measureTriadBandwidth();
+  peaks._flopRate = measureFmaRate();
+  printf("machine peaks on %d threads with %s: triad bandwidth %6.1f GB/s, "
+         "multiply-add %7.1f GFLOP/s, ridge at %5.2f flop/byte\n",
+         omp_get_max_threads(),
+         getInstructionSetName(
+           CpuDispatch::getInstance().getInstructionSet()).c_str(),
+         peaks._bandwidth / 1e9,
+         peaks._flopRate / 1e9,
+         peaks._flopRate / peaks._bandwidth);
+  return peaks;
+}
+
+struct RooflinePoint {
+
+  RooflinePoint() :
+    _valid(false),
+    _flopRate(0),
+    _bandwidth(0),
+    _arithmeticIntensity(0),
+    _fractionOfBound(0),
+    _memoryBound(false) {
+  }
+
+  // false if the peaks weren't measured
+  bool _valid;
+  double _flopRate;
+  double _bandwidth;
+  // flops per byte, infinite for tests that don't touch memory
+  double _arithmeticIntensity;
+  // attainable time over the actual time
+  double _fractionOfBound;
+  // whether the bandwidth roof is the lower one at this intensity
+  bool _memoryBound;
+};
+
+// the peaks are for the whole machine, so a run on fewer threads than that
+//  can't get near 100%.
+inline
+RooflinePoint
+computeRooflinePoint(const WorkCounts & workCounts,
+                     const double elapsedTime,
+                     const MachinePeaks & peaks) {
+  RooflinePoint point;
+  if (peaks._bandwidth <= 0 || peaks._flopRate <= 0 || elapsedTime <= 0) {
+    return point;
+  }
+  point._valid = true;
+  point._flopRate = workCounts._flops / elapsedTime;
+  point._bandwidth = workCounts._bytes / elapsedTime;
+  point._arithmeticIntensity = (workCounts._bytes > 0) ?
+    workCounts._flops / workCounts._bytes : INFINITY;
+  const double memoryTime = workCounts._bytes / peaks._bandwidth;
+  const double computeTime = workCounts._flops / peaks._flopRate;
+  point._memoryBound = memoryTime > computeTime;
+  point._fractionOfBound = std::max(memoryTime, computeTime) / elapsedTime;
+  return point;
+}
+
+inline
+void
+printRooflinePoint(const RooflinePoint & point) {
+  if (point._valid == false) {
+    return;
+  }
+  printf("      %8.2f GFLOP/s %8.2f GB/s at %6.2f flop/byte, "
+         "%%%5.1f of the %s roof\n",
+         point._flopRate / 1e9,
+         point._bandwidth / 1e9,
+         point._arithmeticIntensity,
+         100. * point._fractionOfBound,
+         (point._memoryBound == true) ? "bandwidth" : "compute");
+}
+
+}
+
+#endif // ROOFLINE_H
@@ -12,6 +12,8 @@
 #include <string>
 #include <algorithm>
 #include <chrono>
+#include <random>
+#include <limits>
 
 using std::string;
 using std::vector;
@@ -22,107 +24,238 @@ using std::chrono::duration_cast;
 
 // header file containing some uninteresting ickies
 #include "../Utilities.h"
+#include "../BenchmarkDriver.h"
 
 // header files for various implementations
 #include "ScalarIntegration_serial.h"
 #include "ScalarIntegration_tbb.h"
 #include "ScalarIntegration_omp.h"
+#include "ScalarIntegration_stealing.h"
+#ifdef HAVE_STDPAR
+#include "ScalarIntegration_stdpar.h"
+#endif
+#ifndef CPU_ONLY
 #include "ScalarIntegration_cuda.h"
+#endif
 #include "ScalarIntegration_kokkos.h"
 
 // header file for kokkos so that i can specify device types here
 #include <Kokkos_Core.hpp>
 
-// header file so that i can set the number of threads for tbb
-#include <tbb/task_scheduler_init.h>
-
-// header file so that i can set the number of threads for omp
-#include <omp.h>
-
 void
-checkAnswer(const double correctAnswer,
-            const double testAnswer,
+checkAnswer(const double & correctAnswer,
+            const double & testAnswer,
             const string & testName) {
   const double relativeError =
     std::abs(correctAnswer - testAnswer) / std::abs(correctAnswer);
-  if (relativeError > 1e-3) {
+  // written this way around so that a nan or an inf fails too
+  if (!(relativeError <= 1e-3)) {
     fprintf(stderr, "%s answer is too far off: %15.8e instead of %15.8e\n",
             testName.c_str(), testAnswer, correctAnswer);
     exit(1);
   }
 }
 
-template <class TestFunctor>
 void
-runTimingTest(const TestFunctor & testFunctor,
-              const unsigned int numberOfRepeats,
-              const unsigned int numberOfExtraRepeats,
-              double * answer,
-              double * elapsedTime) {
-
-  high_resolution_clock::time_point tic;
-
-  double thisTestsTime = 0;
-  for (unsigned int repeatIndex = 0;
-       repeatIndex < numberOfRepeats + numberOfExtraRepeats; ++repeatIndex) {
-
-    // reset the device
-    Utilities::resetProcessorForTiming(TestFunctor::ProcessorType);
-
-    // start timing
-    if (repeatIndex >= numberOfExtraRepeats) {
-      tic = high_resolution_clock::now();
-    }
-
-    // run the test
-    testFunctor.computeAnswer(answer);
-
-    // stop timing
-    if (repeatIndex >= numberOfExtraRepeats) {
-      const high_resolution_clock::time_point toc =
-        high_resolution_clock::now();
-      thisTestsTime += duration_cast<duration<double> >(toc - tic).count();
-    }
+checkAnswer(const vector<double> & correctAnswer,
+            const vector<double> & testAnswer,
+            const string & testName) {
+  if (correctAnswer.size() != testAnswer.size()) {
+    fprintf(stderr, "%s answer has the wrong size: %zu instead of %zu\n",
+            testName.c_str(), testAnswer.size(), correctAnswer.size());
+    exit(1);
   }
 
-  *elapsedTime = thisTestsTime / numberOfRepeats;
+  for (unsigned int integralIndex = 0;
+       integralIndex < correctAnswer.size(); ++integralIndex) {
+    checkAnswer(correctAnswer[integralIndex], testAnswer[integralIndex],
+                testName);
+  }
+}
+
+// time one kind of sample sequence on every backend.  the parallel backends
+//  split the samples into the same chunks as the serial one, so they should
+//  all agree with it to roundoff.
+template <class SequenceType>
+void
+runMonteCarloTimingTests(const SequenceType & sequence,
+                         const SinProductIntegrand & integrand,
+                         const uint64_t numberOfSamples,
+                         Utilities::BenchmarkDriver * driver) {
+
+  // a sin, the scaling into the box and a product in every dimension; the
+  //  sequences themselves are integer arithmetic
+  const Utilities::WorkCounts
+    workCounts(double(numberOfSamples) * integrand.getNumberOfDimensions() *
+               (Utilities::FlopsPerSin + 3), 0);
+  Utilities::TestRegistry<double>
+    registry(driver, SequenceType::getName() + string(" "),
+             numberOfSamples, workCounts, checkAnswer);
+
+  const SerialMonteCarloTestFunctor<SequenceType>
+    serialTestFunctor(sequence, integrand, numberOfSamples);
+  double serialAnswer;
+  const Utilities::TimingStatistics serialTimingStatistics =
+    registry.runSerialTest(serialTestFunctor, &serialAnswer);
+  printf("serial error %8.2e\n",
+         std::abs(serialAnswer - integrand.computeExactIntegral()));
+
+  registry.addTest(Utilities::TbbBackend,
+                   [&] (const unsigned int) {
+                     return TbbMonteCarloTestFunctor<SequenceType>
+                       (sequence, integrand, numberOfSamples);
+                   });
+  registry.addTest(Utilities::OmpBackend,
+                   [&] (const unsigned int) {
+                     return OmpMonteCarloTestFunctor<SequenceType>
+                       (sequence, integrand, numberOfSamples);
+                   });
+  registry.addTest(Utilities::StealingBackend,
+                   [&] (const unsigned int) {
+                     return StealingMonteCarloTestFunctor<SequenceType>
+                       (sequence, integrand, numberOfSamples);
+                   });
+#ifdef HAVE_STDPAR
+  registry.addTest(Utilities::StdParBackend,
+                   [&] (const unsigned int) {
+                     return StdParMonteCarloTestFunctor<SequenceType>
+                       (sequence, integrand, numberOfSamples);
+                   });
+#endif
+  registry.addTest(Utilities::KokkosOmpBackend,
+                   [&] (const unsigned int) {
+                     return KokkosMonteCarloTestFunctor<Kokkos::OpenMP,
+                                                        SequenceType>
+                       (sequence, integrand, numberOfSamples);
+                   });
+#ifndef CPU_ONLY
+  registry.addTest(Utilities::KokkosCudaBackend,
+                   [&] (const unsigned int) {
+                     return KokkosMonteCarloTestFunctor<Kokkos::Cuda,
+                                                        SequenceType>
+                       (sequence, integrand, numberOfSamples);
+                   });
+#endif
+#ifdef HAVE_KOKKOS_SERIAL
+  registry.addTest(Utilities::KokkosSerialBackend,
+                   [&] (const unsigned int) {
+                     return KokkosMonteCarloTestFunctor<Kokkos::Serial,
+                                                        SequenceType>
+                       (sequence, integrand, numberOfSamples);
+                   });
+#endif
+#ifdef HAVE_KOKKOS_THREADS
+  registry.addTest(Utilities::KokkosThreadsBackend,
+                   [&] (const unsigned int) {
+                     return KokkosMonteCarloTestFunctor<Kokkos::Threads,
+                                                        SequenceType>
+                       (sequence, integrand, numberOfSamples);
+                   });
+#endif
+
+  registry.runTests(serialAnswer, serialTimingStatistics._median);
 }
 
-template <class TestFunctor>
+// the plain kokkos sum against a compensated one, for the cost and the
+//  benefit.
+template <class DeviceType>
 void
-runTimingTestAndCheckAnswer(const TestFunctor & testFunctor,
-                            const unsigned int numberOfRepeats,
-                            const unsigned int numberOfExtraRepeats,
-                            const double & correctAnswer,
-                            double * elapsedTime) {
-
-  // compute the answer and measure elapsed time
-  double answer;
-  runTimingTest(testFunctor,
-                numberOfRepeats,
-                numberOfExtraRepeats,
-                &answer,
-                elapsedTime);
-
-  // check the answer
-  checkAnswer(correctAnswer, answer, testFunctor.getName());
+runCompensatedSumComparison(const array<double, 2> & integrationBounds,
+                            const Utilities::LargeIndex numberOfIntervals,
+                            const double libraryAnswer,
+                            Utilities::BenchmarkDriver * driver) {
+
+  const string deviceName =
+    Utilities::KokkosDeviceNameConverter<DeviceType>::getName();
+  printf("performing compensated calculations with kokkos %s\n",
+         deviceName.c_str());
+
+  // the plain sum again, to compare against
+  const KokkosTestFunctor<DeviceType>
+    kokkosTestFunctor(integrationBounds, numberOfIntervals);
+  double kokkosAnswer;
+  Utilities::TimingStatistics kokkosTimingStatistics;
+  Utilities::runTimingTest(kokkosTestFunctor,
+                           driver->getRepeatPolicy(),
+                           &kokkosAnswer,
+                           &kokkosTimingStatistics);
+  const double kokkosElapsedTime = kokkosTimingStatistics._median;
+
+  // perform kokkos test with a compensated sum
+  const KokkosTestFunctor<DeviceType, Utilities::CompensatedSum>
+    kokkosCompensatedTestFunctor(integrationBounds, numberOfIntervals);
+  double kokkosCompensatedAnswer;
+  Utilities::TimingStatistics kokkosCompensatedTimingStatistics;
+  Utilities::runTimingTest(kokkosCompensatedTestFunctor,
+                           driver->getRepeatPolicy(),
+                           &kokkosCompensatedAnswer,
+                           &kokkosCompensatedTimingStatistics);
+  const double kokkosCompensatedElapsedTime =
+    kokkosCompensatedTimingStatistics._median;
+  checkAnswer(libraryAnswer, kokkosCompensatedAnswer,
+              kokkosCompensatedTestFunctor.getName());
+
+  // output the cost and the benefit
+  printf("%s plain time %8.2e error %8.2e, compensated time %8.2e "
+         "error %8.2e (%%%5.1f of plain throughput)\n",
+         ("kokkos " + deviceName).c_str(),
+         kokkosElapsedTime,
+         std::abs(kokkosAnswer - libraryAnswer),
+         kokkosCompensatedElapsedTime,
+         std::abs(kokkosCompensatedAnswer - libraryAnswer),
+         100. * kokkosElapsedTime / kokkosCompensatedElapsedTime);
+  Utilities::printTimingStatistics(kokkosTimingStatistics);
+  Utilities::printTimingStatistics(kokkosCompensatedTimingStatistics);
+  driver->addRecord(kokkosCompensatedTestFunctor.getName(),
+                    0,
+                    numberOfIntervals,
+                    kokkosCompensatedTimingStatistics);
 }
 
-int main() {
+int main(int argc, char * argv[]) {
 
-  // change the numberOfIntervals to control the amount
-  //  of work done.
-  const unsigned long numberOfIntervals = 1e8;
+  // the number of intervals controls the amount of work done.  it comes
+  //  from the command line, along with the threads and backends to use and
+  //  how many times each test is performed; see --help.
+  Utilities::BenchmarkDriver driver("ScalarIntegration", argc, argv, 1e8);
+  const Utilities::LargeIndex baseNumberOfIntervals = driver.getProblemSize();
+  // not const, because weak scaling grows it
+  Utilities::LargeIndex numberOfIntervals = baseNumberOfIntervals;
   // the arbitrary integration bounds
   const array<double, 2> integrationBounds = {{0, 1.314}};
-  // some controls for how many times the test is performed
-  const unsigned int numberOfRepeats = 3;
-  const unsigned int numberOfExtraRepeats = 1;
+
+  Kokkos::initialize();
 
   // calculate analytic solution
   const double libraryAnswer =
     std::cos(integrationBounds[0]) - std::cos(integrationBounds[1]);
 
+  // a sin, the evaluation point and the sum for every interval, and
+  //  nothing to read from memory
+  const Utilities::WorkCounts
+    workCounts(double(numberOfIntervals) * (Utilities::FlopsPerSin + 3), 0);
+  Utilities::TestRegistry<double>
+    registry(&driver, "", numberOfIntervals, workCounts, checkAnswer);
+
+  // for weak scaling, there are more intervals over the same bounds, so the
+  //  answer stays the same
+  registry.setProblemScaler([&] (const unsigned int workScaleFactor)
+                            -> Utilities::ScaledProblem<double> {
+      if (baseNumberOfIntervals >
+          std::numeric_limits<Utilities::LargeIndex>::max() /
+          workScaleFactor) {
+        fprintf(stderr, "%u times the work needs more than 2^63 "
+                "intervals\n", workScaleFactor);
+        exit(1);
+      }
+      numberOfIntervals = baseNumberOfIntervals * workScaleFactor;
+      return Utilities::ScaledProblem<double>
+        (numberOfIntervals,
+         Utilities::WorkCounts(double(numberOfIntervals) *
+                               (Utilities::FlopsPerSin + 3), 0),
+         libraryAnswer);
+    });
+
   // ===============================================================
   // ********************** < do serial> ***************************
   // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
@@ -130,55 +263,29 @@ int main() {
   // perform serial test
   const SerialTestFunctor serialTestFunctor(integrationBounds,
                                             numberOfIntervals);
-  double serialElapsedTime;
-  runTimingTestAndCheckAnswer(serialTestFunctor,
-                              numberOfRepeats,
-                              numberOfExtraRepeats,
-                              libraryAnswer,
-                              &serialElapsedTime);
+  double serialAnswer;
+  const Utilities::TimingStatistics serialTimingStatistics =
+    registry.runSerialTest(serialTestFunctor, &serialAnswer);
+  checkAnswer(libraryAnswer, serialAnswer, serialTestFunctor.getName());
+
+  registry.runWarmCacheComparison(serialTestFunctor, serialTimingStatistics);
 
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do serial> ***************************
   // ===============================================================
 
-  // we will repeat the computation for each of the numbers of threads
-  vector<unsigned int> numberOfThreadsArray;
-  numberOfThreadsArray.push_back(1);
-  numberOfThreadsArray.push_back(2);
-  numberOfThreadsArray.push_back(4);
-  numberOfThreadsArray.push_back(8);
-  numberOfThreadsArray.push_back(16);
-  numberOfThreadsArray.push_back(24);
+  // each parallel test is run for each of the numbers of threads (or threads
+  //  per block, for cuda) given on the command line
 
   // ===============================================================
   // ********************** < do tbb> ******************************
   // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
-  printf("performing calculations with tbb\n");
-  // for each number of threads
-  for (const unsigned int numberOfThreads :
-         numberOfThreadsArray) {
-
-    // initialize tbb's threading system for this number of threads
-    tbb::task_scheduler_init init(numberOfThreads);
-
-    // perform tbb test
-    const TbbTestFunctor tbbTestFunctor(integrationBounds,
-                                        numberOfIntervals);
-    double tbbElapsedTime;
-    runTimingTestAndCheckAnswer(tbbTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                libraryAnswer,
-                                &tbbElapsedTime);
-
-    // output speedup
-    printf("%3u : time %8.2e speedup %8.2e (%%%5.1f of ideal)\n",
-           numberOfThreads,
-           tbbElapsedTime,
-           serialElapsedTime / tbbElapsedTime,
-           100. * serialElapsedTime / tbbElapsedTime / numberOfThreads);
-  }
+  registry.addTest(Utilities::TbbBackend,
+                   [&] (const unsigned int) {
+                     return TbbTestFunctor(integrationBounds,
+                                           numberOfIntervals);
+                   });
 
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do tbb> ******************************
@@ -188,127 +295,407 @@ int main() {
   // ********************** < do openmp> ***************************
   // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
-  printf("performing calculations with openmp\n");
-  // for each number of threads
-  for (const unsigned int numberOfThreads :
-         numberOfThreadsArray) {
-
-    // initialize omp's threading system for this number of threads
-    omp_set_num_threads(numberOfThreads);
-
-    // perform tbb test
-    const OmpTestFunctor ompTestFunctor(integrationBounds,
-                                        numberOfIntervals);
-    double ompElapsedTime;
-    runTimingTestAndCheckAnswer(ompTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                libraryAnswer,
-                                &ompElapsedTime);
-
-    // output speedup
-    printf("%3u : time %8.2e speedup %8.2e (%%%5.1f of ideal)\n",
-           numberOfThreads,
-           ompElapsedTime,
-           serialElapsedTime / ompElapsedTime,
-           100. * serialElapsedTime / ompElapsedTime / numberOfThreads);
-  }
+  registry.addTest(Utilities::OmpBackend,
+                   [&] (const unsigned int) {
+                     return OmpTestFunctor(integrationBounds,
+                                           numberOfIntervals);
+                   });
 
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do openmp> ***************************
   // ===============================================================
 
+  // ===============================================================
+  // ********************** < do stealing> *************************
+  // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
+
+  registry.addTest(Utilities::StealingBackend,
+                   [&] (const unsigned int) {
+                     return StealingTestFunctor(integrationBounds,
+                                                numberOfIntervals);
+                   });
+
+  // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+  // ********************** </do stealing> *************************
+  // ===============================================================
+
+  // ===============================================================
+  // ********************** < do stdpar> ***************************
+  // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
+
+#ifdef HAVE_STDPAR
+  registry.addTest(Utilities::StdParBackend,
+                   [&] (const unsigned int) {
+                     return StdParTestFunctor(integrationBounds,
+                                              numberOfIntervals);
+                   });
+#endif
+
+  // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+  // ********************** </do stdpar> ***************************
+  // ===============================================================
+
   // ===============================================================
   // ********************** < do cuda> *****************************
   // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
-  // we will repeat the computation for each of the numbers of threads
-  vector<unsigned int> threadsPerBlockArray;
-  threadsPerBlockArray.push_back(4);
-  threadsPerBlockArray.push_back(8);
-  threadsPerBlockArray.push_back(16);
-  threadsPerBlockArray.push_back(32);
-  threadsPerBlockArray.push_back(64);
-  threadsPerBlockArray.push_back(128);
-  threadsPerBlockArray.push_back(256);
-  threadsPerBlockArray.push_back(512);
-
-  printf("performing calculations with cuda\n");
-  // for each number of threads per block
-  for (const unsigned int numberOfThreadsPerBlock :
-         threadsPerBlockArray) {
-
-    // perform cuda test
-    const CudaTestFunctor cudaTestFunctor(integrationBounds,
-                                          numberOfIntervals,
-                                          numberOfThreadsPerBlock);
-    double cudaElapsedTime;
-    runTimingTestAndCheckAnswer(cudaTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                libraryAnswer,
-                                &cudaElapsedTime);
-
-    // output speedup
-    printf("%3u : time %8.2e speedup %8.2e\n",
-           numberOfThreadsPerBlock,
-           cudaElapsedTime,
-           serialElapsedTime / cudaElapsedTime);
-  }
+#ifndef CPU_ONLY
+  registry.addTest(Utilities::CudaBackend,
+                   [&] (const unsigned int numberOfThreadsPerBlock) {
+                     return CudaTestFunctor(integrationBounds,
+                                            numberOfIntervals,
+                                            numberOfThreadsPerBlock);
+                   });
+#endif
 
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // ********************** </do cuda> *****************************
   // ===============================================================
 
-  Kokkos::initialize();
-
   // ===============================================================
   // ********************** < do kokkos> ***************************
   // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
-  printf("performing calculations with kokkos omp\n");
-  {
-    // perform kokkos omp test
-    const KokkosTestFunctor<Kokkos::OpenMP> kokkosTestFunctor(integrationBounds,
-                                                              numberOfIntervals);
-    double kokkosElapsedTime;
-    runTimingTestAndCheckAnswer(kokkosTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                libraryAnswer,
-                                &kokkosElapsedTime);
-
-    // output speedup
-    printf("%s time %8.2e speedup %8.2e\n",
-           "kokkos omp",
-           kokkosElapsedTime,
-           serialElapsedTime / kokkosElapsedTime);
+  registry.addTest(Utilities::KokkosOmpBackend,
+                   [&] (const unsigned int) {
+                     return KokkosTestFunctor<Kokkos::OpenMP>
+                       (integrationBounds, numberOfIntervals);
+                   });
+#ifndef CPU_ONLY
+  registry.addTest(Utilities::KokkosCudaBackend,
+                   [&] (const unsigned int) {
+                     return KokkosTestFunctor<Kokkos::Cuda>
+                       (integrationBounds, numberOfIntervals);
+                   });
+#endif
+#ifdef HAVE_KOKKOS_SERIAL
+  registry.addTest(Utilities::KokkosSerialBackend,
+                   [&] (const unsigned int) {
+                     return KokkosTestFunctor<Kokkos::Serial>
+                       (integrationBounds, numberOfIntervals);
+                   });
+#endif
+#ifdef HAVE_KOKKOS_THREADS
+  registry.addTest(Utilities::KokkosThreadsBackend,
+                   [&] (const unsigned int) {
+                     return KokkosTestFunctor<Kokkos::Threads>
+                       (integrationBounds, numberOfIntervals);
+                   });
+#endif
+
+  // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+  // ********************** </do kokkos> ***************************
+  // ===============================================================
+
+  registry.runTests(libraryAnswer, serialTimingStatistics._median);
+
+  if (driver.isBackendEnabled(Utilities::KokkosOmpBackend) == true) {
+    runCompensatedSumComparison<Kokkos::OpenMP>(integrationBounds,
+                                                numberOfIntervals,
+                                                libraryAnswer,
+                                                &driver);
   }
+#ifndef CPU_ONLY
+  if (driver.isBackendEnabled(Utilities::KokkosCudaBackend) == true) {
+    runCompensatedSumComparison<Kokkos::Cuda>(integrationBounds,
+                                              numberOfIntervals,
+                                              libraryAnswer,
+                                              &driver);
+  }
+#endif
+
+  // ===============================================================
+  // ********************** < do romberg> **************************
+  // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
-  printf("performing calculations with kokkos cuda\n");
-  {
-    // perform kokkos cuda test
-    const KokkosTestFunctor<Kokkos::Cuda> kokkosTestFunctor(integrationBounds,
-                                                            numberOfIntervals);
-    double kokkosElapsedTime;
-    runTimingTestAndCheckAnswer(kokkosTestFunctor,
-                                numberOfRepeats,
-                                numberOfExtraRepeats,
-                                libraryAnswer,
-                                &kokkosElapsedTime);
-
-    // output speedup
-    printf("%s time %8.2e speedup %8.2e\n",
-           "kokkos cuda",
-           kokkosElapsedTime,
-           serialElapsedTime / kokkosElapsedTime);
+  // romberg gets to the same accuracy as the midpoint rule with far fewer
+  //  evaluations, so first see how few it needs.
+  printf("romberg evaluations versus %.1e for the midpoint rule\n",
+         double(numberOfIntervals));
+  printf("%6s %12s %10s %12s\n", "levels", "evaluations", "error", "saved");
+  for (unsigned int numberOfLevels = 2;
+       numberOfLevels <= 8; ++numberOfLevels) {
+    const SerialRombergTestFunctor
+      rombergTestFunctor(integrationBounds, 1, numberOfLevels);
+    double rombergAnswer;
+    rombergTestFunctor.computeAnswer(&rombergAnswer);
+    printf("%6u %12ld %10.2e %12ld\n",
+           numberOfLevels,
+           long(rombergTestFunctor.getNumberOfEvaluations()),
+           std::abs(rombergAnswer - libraryAnswer) / std::abs(libraryAnswer),
+           long(numberOfIntervals -
+                rombergTestFunctor.getNumberOfEvaluations()));
   }
 
+  // then, for timing, spend as many evaluations as the midpoint rule did,
+  //  but never less than one coarsest interval
+  const unsigned int numberOfRombergLevels = 5;
+  const Utilities::LargeIndex numberOfCoarsestRombergIntervals =
+    std::max(numberOfIntervals >> (numberOfRombergLevels - 1),
+             Utilities::LargeIndex(1));
+
+  const SerialRombergTestFunctor
+    serialRombergTestFunctor(integrationBounds,
+                             numberOfCoarsestRombergIntervals,
+                             numberOfRombergLevels);
+
+  // a sin, the evaluation point and the sum for every point of the finest
+  //  grid; the extrapolation at the end is negligible
+  const Utilities::WorkCounts
+    rombergWorkCounts(double(serialRombergTestFunctor.
+                             getNumberOfEvaluations()) *
+                      (Utilities::FlopsPerSin + 3), 0);
+  Utilities::TestRegistry<double>
+    rombergRegistry(&driver, "romberg ", numberOfIntervals,
+                    rombergWorkCounts, checkAnswer);
+  double serialRombergAnswer;
+  const Utilities::TimingStatistics serialRombergTimingStatistics =
+    rombergRegistry.runSerialTest(serialRombergTestFunctor,
+                                  &serialRombergAnswer);
+  checkAnswer(libraryAnswer, serialRombergAnswer,
+              serialRombergTestFunctor.getName());
+
+  rombergRegistry.addTest(Utilities::TbbBackend,
+                          [&] (const unsigned int) {
+                            return TbbRombergTestFunctor
+                              (integrationBounds,
+                               numberOfCoarsestRombergIntervals,
+                               numberOfRombergLevels);
+                          });
+  rombergRegistry.addTest(Utilities::OmpBackend,
+                          [&] (const unsigned int) {
+                            return OmpRombergTestFunctor
+                              (integrationBounds,
+                               numberOfCoarsestRombergIntervals,
+                               numberOfRombergLevels);
+                          });
+  rombergRegistry.addTest(Utilities::StealingBackend,
+                          [&] (const unsigned int) {
+                            return StealingRombergTestFunctor
+                              (integrationBounds,
+                               numberOfCoarsestRombergIntervals,
+                               numberOfRombergLevels);
+                          });
+#ifdef HAVE_STDPAR
+  rombergRegistry.addTest(Utilities::StdParBackend,
+                          [&] (const unsigned int) {
+                            return StdParRombergTestFunctor
+                              (integrationBounds,
+                               numberOfCoarsestRombergIntervals,
+                               numberOfRombergLevels);
+                          });
+#endif
+  rombergRegistry.addTest(Utilities::KokkosOmpBackend,
+                          [&] (const unsigned int) {
+                            return KokkosRombergTestFunctor<Kokkos::OpenMP>
+                              (integrationBounds,
+                               numberOfCoarsestRombergIntervals,
+                               numberOfRombergLevels);
+                          });
+#ifndef CPU_ONLY
+  rombergRegistry.addTest(Utilities::KokkosCudaBackend,
+                          [&] (const unsigned int) {
+                            return KokkosRombergTestFunctor<Kokkos::Cuda>
+                              (integrationBounds,
+                               numberOfCoarsestRombergIntervals,
+                               numberOfRombergLevels);
+                          });
+#endif
+#ifdef HAVE_KOKKOS_SERIAL
+  rombergRegistry.addTest(Utilities::KokkosSerialBackend,
+                          [&] (const unsigned int) {
+                            return KokkosRombergTestFunctor<Kokkos::Serial>
+                              (integrationBounds,
+                               numberOfCoarsestRombergIntervals,
+                               numberOfRombergLevels);
+                          });
+#endif
+#ifdef HAVE_KOKKOS_THREADS
+  rombergRegistry.addTest(Utilities::KokkosThreadsBackend,
+                          [&] (const unsigned int) {
+                            return KokkosRombergTestFunctor<Kokkos::Threads>
+                              (integrationBounds,
+                               numberOfCoarsestRombergIntervals,
+                               numberOfRombergLevels);
+                          });
+#endif
+
+  rombergRegistry.runTests(libraryAnswer,
+                           serialRombergTimingStatistics._median);
+
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
-  // ********************** </do kokkos> ***************************
+  // ********************** </do romberg> **************************
+  // ===============================================================
+
+  // ===============================================================
+  // ****************** < do multidimensional> *********************
+  // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
+
+  // grids explode in high dimensions, so here we integrate the product of
+  //  sin over a box with sample sequences instead.
+  const unsigned int numberOfDimensions = 6;
+  const vector<array<double, 2> >
+    multiDimensionalIntegrationBounds(numberOfDimensions, integrationBounds);
+  const SinProductIntegrand integrand(multiDimensionalIntegrationBounds);
+  const double exactMultiDimensionalAnswer = integrand.computeExactIntegral();
+
+  const SobolSequence sobolSequence(numberOfDimensions);
+  const HaltonSequence haltonSequence(numberOfDimensions);
+  const PseudoRandomSequence pseudoRandomSequence(numberOfDimensions);
+
+  // how the error falls off with the number of samples
+  printf("error versus number of samples in %u dimensions\n",
+         numberOfDimensions);
+  printf("%12s %10s %10s %10s\n", "samples", "sobol", "halton", "random");
+  for (uint64_t numberOfSamples = 1 << 10; numberOfSamples <= 1 << 22;
+       numberOfSamples *= 4) {
+    double sobolAnswer;
+    SerialMonteCarloTestFunctor<SobolSequence>
+      (sobolSequence, integrand, numberOfSamples).computeAnswer(&sobolAnswer);
+    double haltonAnswer;
+    SerialMonteCarloTestFunctor<HaltonSequence>
+      (haltonSequence, integrand, numberOfSamples).computeAnswer(&haltonAnswer);
+    double pseudoRandomAnswer;
+    SerialMonteCarloTestFunctor<PseudoRandomSequence>
+      (pseudoRandomSequence, integrand,
+       numberOfSamples).computeAnswer(&pseudoRandomAnswer);
+    printf("%12lu %10.2e %10.2e %10.2e\n",
+           (unsigned long)numberOfSamples,
+           std::abs(sobolAnswer - exactMultiDimensionalAnswer),
+           std::abs(haltonAnswer - exactMultiDimensionalAnswer),
+           std::abs(pseudoRandomAnswer - exactMultiDimensionalAnswer));
+  }
+
+  const uint64_t numberOfSamples = 1 << 22;
+  runMonteCarloTimingTests(sobolSequence, integrand, numberOfSamples,
+                           &driver);
+  runMonteCarloTimingTests(haltonSequence, integrand, numberOfSamples,
+                           &driver);
+  runMonteCarloTimingTests(pseudoRandomSequence, integrand, numberOfSamples,
+                           &driver);
+
+  // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+  // ****************** </do multidimensional> *********************
+  // ===============================================================
+
+  // ===============================================================
+  // ********************** < do batched> **************************
+  // vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
+
+  // lots of small integrals with different bounds and resolutions, where
+  //  launching each one separately would cost more than the work itself.
+  const unsigned int numberOfIntegrals = 4096;
+  std::mt19937 randomNumberEngine;
+  std::uniform_real_distribution<double> boundsGenerator(0, M_PI);
+  std::uniform_int_distribution<unsigned int> intervalsGenerator(1e3, 1e5);
+  vector<array<double, 2> > batchedIntegrationBounds(numberOfIntegrals);
+  vector<unsigned int> batchedNumbersOfIntervals(numberOfIntegrals);
+  vector<double> batchedLibraryAnswers(numberOfIntegrals);
+  for (unsigned int integralIndex = 0;
+       integralIndex < numberOfIntegrals; ++integralIndex) {
+    const double lowerBound = boundsGenerator(randomNumberEngine);
+    const double upperBound = boundsGenerator(randomNumberEngine);
+    batchedIntegrationBounds[integralIndex] =
+      {{std::min(lowerBound, upperBound), std::max(lowerBound, upperBound)}};
+    batchedNumbersOfIntervals[integralIndex] =
+      intervalsGenerator(randomNumberEngine);
+    batchedLibraryAnswers[integralIndex] =
+      std::cos(batchedIntegrationBounds[integralIndex][0]) -
+      std::cos(batchedIntegrationBounds[integralIndex][1]);
+  }
+
+  double totalNumberOfBatchedIntervals = 0;
+  for (const unsigned int numberOfIntervals : batchedNumbersOfIntervals) {
+    totalNumberOfBatchedIntervals += numberOfIntervals;
+  }
+  // the bounds and interval count in, the integral out
+  const Utilities::WorkCounts
+    batchedWorkCounts(totalNumberOfBatchedIntervals *
+                      (Utilities::FlopsPerSin + 3),
+                      double(numberOfIntegrals) *
+                      (sizeof(array<double, 2>) + sizeof(unsigned int) +
+                       sizeof(double)));
+  Utilities::TestRegistry<vector<double> >
+    batchedRegistry(&driver, "batched ", numberOfIntegrals,
+                    batchedWorkCounts, checkAnswer);
+
+  const SerialBatchedTestFunctor
+    serialBatchedTestFunctor(batchedIntegrationBounds,
+                             batchedNumbersOfIntervals);
+  vector<double> serialBatchedAnswers;
+  const Utilities::TimingStatistics serialBatchedTimingStatistics =
+    batchedRegistry.runSerialTest(serialBatchedTestFunctor,
+                                  &serialBatchedAnswers);
+  checkAnswer(batchedLibraryAnswers, serialBatchedAnswers,
+              serialBatchedTestFunctor.getName());
+
+  batchedRegistry.addTest(Utilities::TbbBackend,
+                          [&] (const unsigned int) {
+                            return TbbBatchedTestFunctor
+                              (batchedIntegrationBounds,
+                               batchedNumbersOfIntervals);
+                          });
+  batchedRegistry.addTest(Utilities::OmpBackend,
+                          [&] (const unsigned int) {
+                            return OmpBatchedTestFunctor
+                              (batchedIntegrationBounds,
+                               batchedNumbersOfIntervals);
+                          });
+  batchedRegistry.addTest(Utilities::StealingBackend,
+                          [&] (const unsigned int) {
+                            return StealingBatchedTestFunctor
+                              (batchedIntegrationBounds,
+                               batchedNumbersOfIntervals);
+                          });
+#ifdef HAVE_STDPAR
+  batchedRegistry.addTest(Utilities::StdParBackend,
+                          [&] (const unsigned int) {
+                            return StdParBatchedTestFunctor
+                              (batchedIntegrationBounds,
+                               batchedNumbersOfIntervals);
+                          });
+#endif
+  // vector lanes don't buy us anything on the host backend
+  batchedRegistry.addTest(Utilities::KokkosOmpBackend,
+                          [&] (const unsigned int) {
+                            return KokkosBatchedTestFunctor<Kokkos::OpenMP>
+                              (batchedIntegrationBounds,
+                               batchedNumbersOfIntervals, 1);
+                          });
+#ifndef CPU_ONLY
+  // one warp of vector lanes per integral
+  batchedRegistry.addTest(Utilities::KokkosCudaBackend,
+                          [&] (const unsigned int) {
+                            return KokkosBatchedTestFunctor<Kokkos::Cuda>
+                              (batchedIntegrationBounds,
+                               batchedNumbersOfIntervals, 32);
+                          });
+#endif
+#ifdef HAVE_KOKKOS_SERIAL
+  batchedRegistry.addTest(Utilities::KokkosSerialBackend,
+                          [&] (const unsigned int) {
+                            return KokkosBatchedTestFunctor<Kokkos::Serial>
+                              (batchedIntegrationBounds,
+                               batchedNumbersOfIntervals, 1);
+                          });
+#endif
+#ifdef HAVE_KOKKOS_THREADS
+  batchedRegistry.addTest(Utilities::KokkosThreadsBackend,
+                          [&] (const unsigned int) {
+                            return KokkosBatchedTestFunctor<Kokkos::Threads>
+                              (batchedIntegrationBounds,
+                               batchedNumbersOfIntervals, 1);
+                          });
+#endif
+
+  batchedRegistry.runTests(batchedLibraryAnswers,
+                           serialBatchedTimingStatistics._median);
+
+  // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+  // ********************** </do batched> **************************
   // ===============================================================
 
   Kokkos::finalize();
 
-  return 0;
+  return driver.finish();
 }
@@ -12,7 +12,7 @@ public:
   static const CpuOrGpuType ProcessorType = Gpu;
 
   CudaTestFunctor(const array<double, 2> & integrationBounds,
-                  const unsigned int numberOfIntervals,
+                  const Utilities::LargeIndex numberOfIntervals,
                   const unsigned int numberOfThreadsPerBlock) :
     _integrationBounds(integrationBounds),
     _numberOfIntervals(numberOfIntervals),
@@ -35,7 +35,7 @@ public:
 
 private:
   const array<double, 2> _integrationBounds;
-  const unsigned int _numberOfIntervals;
+  const Utilities::LargeIndex _numberOfIntervals;
   const unsigned int _numberOfThreadsPerBlock;
 };
 
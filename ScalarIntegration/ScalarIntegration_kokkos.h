@@ -3,30 +3,88 @@
 #define SCALARINTEGRATOR_KOKKOS_H
 
 #include "../Utilities.h"
+#include "ScalarIntegration_sequences.h"
+#include "ScalarIntegration_romberg.h"
+#include "../CompensatedSum.h"
+#include "../Workspace.h"
+#include "../PhaseTimers.h"
+#include "../LoadBalance.h"
+#include "../PerThreadAccumulator.h"
+
+#include <type_traits>
 
 // header files for kokkos
 #include <Kokkos_Core.hpp>
 
-template <class DeviceType>
+// SumType is the accumulator: a plain double, or a Utilities::CompensatedSum
+//  which stays accurate over billions of intervals.
+template <class DeviceType, class SumType>
 struct KokkosWorkerFunctor {
 
   typedef DeviceType device_type;
+  typedef SumType value_type;
 
-  KokkosWorkerFunctor(const array<double, 2> & integrationBounds) :
-    _integrationBounds(integrationBounds) {
+  KokkosWorkerFunctor(const array<double, 2> & integrationBounds,
+                      const Utilities::LargeIndex numberOfIntervals) :
+    _integrationBounds0(integrationBounds[0]),
+    _dx((integrationBounds[1] - integrationBounds[0]) / numberOfIntervals) {
   }
 
   KOKKOS_INLINE_FUNCTION
-  void operator()(const unsigned int intervalIndex) const {
+  void operator()(const Utilities::LargeIndex intervalIndex,
+                  SumType & sum) const {
+    const double evaluationPoint =
+      _integrationBounds0 + (double(intervalIndex) + 0.5) * _dx;
+    sum += sin(evaluationPoint);
   }
 
 private:
   KokkosWorkerFunctor();
-  const array<double, 2> _integrationBounds;
+  const double _integrationBounds0;
+  const double _dx;
 
 };
 
-template <class DeviceType>
+// the host spaces take a block of intervals per call, so that marking the
+//  chunks doesn't cost more than the sins, like the omp version
+const Utilities::LargeIndex KokkosIntervalsPerBlock = 1 << 14;
+
+template <class DeviceType, class SumType>
+struct KokkosHostWorkerFunctor {
+
+  typedef DeviceType device_type;
+  typedef SumType value_type;
+
+  KokkosHostWorkerFunctor(const array<double, 2> & integrationBounds,
+                          const Utilities::LargeIndex numberOfIntervals) :
+    _integrationBounds0(integrationBounds[0]),
+    _dx((integrationBounds[1] - integrationBounds[0]) / numberOfIntervals),
+    _numberOfIntervals(numberOfIntervals) {
+  }
+
+  void operator()(const Utilities::LargeIndex blockIndex,
+                  SumType & sum) const {
+    const Utilities::BusyChunk chunk;
+    const Utilities::LargeIndex blockBeginIndex =
+      blockIndex * KokkosIntervalsPerBlock;
+    const unsigned int blockSize =
+      std::min(KokkosIntervalsPerBlock, _numberOfIntervals - blockBeginIndex);
+    for (unsigned int offset = 0; offset < blockSize; ++offset) {
+      const double evaluationPoint =
+        _integrationBounds0 + (double(blockBeginIndex + offset) + 0.5) * _dx;
+      sum += sin(evaluationPoint);
+    }
+  }
+
+private:
+  KokkosHostWorkerFunctor();
+  const double _integrationBounds0;
+  const double _dx;
+  const Utilities::LargeIndex _numberOfIntervals;
+
+};
+
+template <class DeviceType, class SumType = double>
 class KokkosTestFunctor {
 public:
 
@@ -35,7 +93,7 @@ public:
     Utilities::KokkosProcessorTypeConverter<DeviceType>::ProcessorType;
 
   KokkosTestFunctor(const array<double, 2> & integrationBounds,
-                    const unsigned int numberOfIntervals) :
+                    const Utilities::LargeIndex numberOfIntervals) :
     _integrationBounds(integrationBounds),
     _numberOfIntervals(numberOfIntervals) {
 
@@ -44,7 +102,115 @@ public:
   void
   computeAnswer(double * answer) const {
 
+    double totalIntegral =
+      sumIntervals(std::integral_constant<bool, ProcessorType == Cpu>());
+    totalIntegral *=
+      (_integrationBounds[1] - _integrationBounds[0]) / _numberOfIntervals;
+
+    *answer = totalIntegral;
+  }
+
+  string
+  getName() const {
+    return string("kokkos ") +
+      Utilities::KokkosDeviceNameConverter<DeviceType>().getName() +
+      Utilities::KokkosSumReduction<SumType>::getName();
+  }
+
+private:
+
+  // the device does an interval per index
+  double
+  sumIntervals(std::false_type) const {
+    const KokkosWorkerFunctor<DeviceType, SumType>
+      worker(_integrationBounds, _numberOfIntervals);
+    return Utilities::KokkosSumReduction<SumType>::reduce(
+      Utilities::LargeRangePolicy<DeviceType>::create(
+        0, _numberOfIntervals, Utilities::getKokkosChunkSize()),
+      worker);
+  }
+
+  // and the host a block
+  double
+  sumIntervals(std::true_type) const {
+    const KokkosHostWorkerFunctor<DeviceType, SumType>
+      worker(_integrationBounds, _numberOfIntervals);
+    const Utilities::LargeIndex numberOfBlocks =
+      (_numberOfIntervals + KokkosIntervalsPerBlock - 1) /
+      KokkosIntervalsPerBlock;
+    return Utilities::KokkosSumReduction<SumType>::reduce(
+      Utilities::LargeRangePolicy<DeviceType>::create(
+        0, numberOfBlocks, Utilities::getKokkosChunkSize()),
+      worker);
+  }
+
+  const array<double, 2> _integrationBounds;
+  const Utilities::LargeIndex _numberOfIntervals;
+};
+
+template <class DeviceType, class SequenceType>
+struct KokkosMonteCarloWorkerFunctor {
+
+  typedef DeviceType device_type;
+  typedef double value_type;
+
+  KokkosMonteCarloWorkerFunctor(const SequenceType & sequence,
+                                const SinProductIntegrand & integrand,
+                                const uint64_t numberOfSamples) :
+    _sequence(sequence),
+    _integrand(integrand),
+    _numberOfSamples(numberOfSamples) {
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  void operator()(const Utilities::LargeIndex chunkIndex,
+                  double & partialSum) const {
+    partialSum +=
+      sumIntegrandOverChunk(_sequence, _integrand, chunkIndex,
+                            _numberOfSamples);
+  }
+
+private:
+  KokkosMonteCarloWorkerFunctor();
+  const SequenceType _sequence;
+  const SinProductIntegrand _integrand;
+  const uint64_t _numberOfSamples;
+
+};
+
+template <class DeviceType, class SequenceType>
+class KokkosMonteCarloTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType =
+    Utilities::KokkosProcessorTypeConverter<DeviceType>::ProcessorType;
+
+  KokkosMonteCarloTestFunctor(const SequenceType & sequence,
+                              const SinProductIntegrand & integrand,
+                              const uint64_t numberOfSamples) :
+    _sequence(sequence),
+    _integrand(integrand),
+    _numberOfSamples(numberOfSamples) {
+    checkNumberOfSamples<SequenceType>(numberOfSamples);
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const Utilities::LargeIndex numberOfChunks =
+      computeNumberOfChunks(_numberOfSamples);
+
+    // each index is a chunk of samples, which the host spaces mark
+    typedef KokkosMonteCarloWorkerFunctor<DeviceType, SequenceType> Worker;
+    const typename Utilities::KokkosChunkedFunctor<ProcessorType == Cpu,
+                                                   Worker>::Type
+      worker(Worker(_sequence, _integrand, _numberOfSamples));
     double totalIntegral = 0;
+    Kokkos::parallel_reduce(
+      Utilities::LargeRangePolicy<DeviceType>::create(
+        0, numberOfChunks, Utilities::getKokkosChunkSize()),
+      worker, totalIntegral);
+    totalIntegral *= _integrand.getVolume() / _numberOfSamples;
 
     *answer = totalIntegral;
   }
@@ -52,12 +218,360 @@ public:
   string
   getName() const {
     return string("kokkos ") +
-      Utilities::KokkosDeviceNameConverter<DeviceType>().getName();
+      Utilities::KokkosDeviceNameConverter<DeviceType>().getName() +
+      string(" ") + SequenceType::getName();
+  }
+
+private:
+  const SequenceType _sequence;
+  const SinProductIntegrand _integrand;
+  const uint64_t _numberOfSamples;
+};
+
+// one team per integral, with the team's vector lanes splitting up the
+//  intervals, so the whole batch goes out in a single launch.
+template <class DeviceType>
+struct KokkosBatchedWorkerFunctor {
+
+  typedef DeviceType device_type;
+  typedef typename Kokkos::TeamPolicy<DeviceType>::member_type member_type;
+  typedef Kokkos::View<double*, DeviceType> DoubleView;
+  typedef Kokkos::View<unsigned int*, DeviceType> UnsignedIntView;
+
+  KokkosBatchedWorkerFunctor(const DoubleView & lowerBounds,
+                             const DoubleView & upperBounds,
+                             const UnsignedIntView & numbersOfIntervals,
+                             const DoubleView & integrals) :
+    _lowerBounds(lowerBounds),
+    _upperBounds(upperBounds),
+    _numbersOfIntervals(numbersOfIntervals),
+    _integrals(integrals) {
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  void operator()(const member_type & teamMember) const {
+    const unsigned int integralIndex = teamMember.league_rank();
+    const unsigned int numberOfIntervals = _numbersOfIntervals(integralIndex);
+    const double integrationBounds0 = _lowerBounds(integralIndex);
+    const double dx =
+      (_upperBounds(integralIndex) - integrationBounds0) / numberOfIntervals;
+    double integral = 0;
+    Kokkos::parallel_reduce(Kokkos::ThreadVectorRange(teamMember,
+                                                      numberOfIntervals),
+                            [&] (const unsigned int intervalIndex,
+                                 double & partialSum) {
+                              const double evaluationPoint =
+                                integrationBounds0 +
+                                (double(intervalIndex) + 0.5) * dx;
+                              partialSum += sin(evaluationPoint);
+                            }, integral);
+    Kokkos::single(Kokkos::PerTeam(teamMember), [&] () {
+        _integrals(integralIndex) = integral * dx;
+      });
+  }
+
+private:
+  KokkosBatchedWorkerFunctor();
+  const DoubleView _lowerBounds;
+  const DoubleView _upperBounds;
+  const UnsignedIntView _numbersOfIntervals;
+  const DoubleView _integrals;
+
+};
+
+template <class DeviceType>
+class KokkosBatchedTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType =
+    Utilities::KokkosProcessorTypeConverter<DeviceType>::ProcessorType;
+
+  // the inputs are copied to the device once, here, rather than on every
+  //  call to computeAnswer.
+  KokkosBatchedTestFunctor(const vector<array<double, 2> > & integrationBounds,
+                           const vector<unsigned int> & numbersOfIntervals,
+                           const unsigned int vectorLength) :
+    _numberOfIntegrals(integrationBounds.size()),
+    _vectorLength(vectorLength),
+    _lowerBounds("lower bounds", _numberOfIntegrals),
+    _upperBounds("upper bounds", _numberOfIntegrals),
+    _numbersOfIntervals("numbers of intervals", _numberOfIntegrals),
+    _integrals("integrals", _numberOfIntegrals) {
+
+    typename Kokkos::View<double*, DeviceType>::HostMirror lowerBounds =
+      Kokkos::create_mirror_view(_lowerBounds);
+    typename Kokkos::View<double*, DeviceType>::HostMirror upperBounds =
+      Kokkos::create_mirror_view(_upperBounds);
+    typename Kokkos::View<unsigned int*, DeviceType>::HostMirror intervals =
+      Kokkos::create_mirror_view(_numbersOfIntervals);
+    for (unsigned int integralIndex = 0;
+         integralIndex < _numberOfIntegrals; ++integralIndex) {
+      lowerBounds(integralIndex) = integrationBounds[integralIndex][0];
+      upperBounds(integralIndex) = integrationBounds[integralIndex][1];
+      intervals(integralIndex) = numbersOfIntervals[integralIndex];
+    }
+    Kokkos::deep_copy(_lowerBounds, lowerBounds);
+    Kokkos::deep_copy(_upperBounds, upperBounds);
+    Kokkos::deep_copy(_numbersOfIntervals, intervals);
+  }
+
+  void
+  computeAnswer(vector<double> * answers) const {
+
+    // each team is a whole integral, which the host spaces mark
+    typedef KokkosBatchedWorkerFunctor<DeviceType> Worker;
+    const typename Utilities::KokkosChunkedFunctor<ProcessorType == Cpu,
+                                                   Worker>::Type
+      worker(Worker(_lowerBounds, _upperBounds, _numbersOfIntervals,
+                    _integrals));
+    Kokkos::parallel_for(Kokkos::TeamPolicy<DeviceType>(_numberOfIntegrals,
+                                                        1, _vectorLength),
+                         worker);
+
+    // the host mirror is made once per test rather than on every repeat
+    typedef typename Kokkos::View<double*, DeviceType>::HostMirror
+      HostMirror;
+    const HostMirror & integrals =
+      Utilities::Workspace::getInstance().getObject<HostMirror>(
+        "batched integrals mirror",
+        [&] () {
+          return Kokkos::create_mirror_view(_integrals);
+        });
+    Kokkos::deep_copy(integrals, _integrals);
+    const Utilities::ScopedPhase phase("gather answers");
+    answers->resize(_numberOfIntegrals);
+    for (unsigned int integralIndex = 0;
+         integralIndex < _numberOfIntegrals; ++integralIndex) {
+      (*answers)[integralIndex] = integrals(integralIndex);
+    }
+  }
+
+  string
+  getName() const {
+    return string("kokkos ") +
+      Utilities::KokkosDeviceNameConverter<DeviceType>().getName() +
+      string(" batched");
+  }
+
+private:
+  const unsigned int _numberOfIntegrals;
+  const unsigned int _vectorLength;
+  const Kokkos::View<double*, DeviceType> _lowerBounds;
+  const Kokkos::View<double*, DeviceType> _upperBounds;
+  const Kokkos::View<unsigned int*, DeviceType> _numbersOfIntervals;
+  const Kokkos::View<double*, DeviceType> _integrals;
+};
+
+template <class DeviceType>
+struct KokkosRombergWorkerFunctor {
+
+  typedef DeviceType device_type;
+  typedef RombergLevelSums value_type;
+
+  KokkosRombergWorkerFunctor(const double integrationBounds0,
+                             const double finestDx,
+                             const Utilities::LargeIndex
+                             numberOfFinestIntervals,
+                             const unsigned int numberOfLevels) :
+    _integrationBounds0(integrationBounds0),
+    _finestDx(finestDx),
+    _numberOfFinestIntervals(numberOfFinestIntervals),
+    _numberOfLevels(numberOfLevels) {
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  void init(RombergLevelSums & levelSums) const {
+    levelSums = RombergLevelSums();
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  void join(volatile RombergLevelSums & levelSums,
+            const volatile RombergLevelSums & otherLevelSums) const {
+    levelSums += otherLevelSums;
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  void operator()(const Utilities::LargeIndex pointIndex,
+                  RombergLevelSums & levelSums) const {
+    accumulateRombergPoint(_integrationBounds0, _finestDx,
+                           _numberOfFinestIntervals, _numberOfLevels,
+                           pointIndex, &levelSums);
   }
 
 private:
+  KokkosRombergWorkerFunctor();
+  const double _integrationBounds0;
+  const double _finestDx;
+  const Utilities::LargeIndex _numberOfFinestIntervals;
+  const unsigned int _numberOfLevels;
+
+};
+
+typedef Utilities::PerThreadAccumulator<RombergLevelSums>
+  KokkosThreadLevelSums;
+
+// for the host spaces, which add up each thread's points in a row of their
+//  own, indexed by kokkos's hardware thread id, instead of going through
+//  kokkos's reduction.  it's a parallel_for over blocks of points, so it
+//  only runs on the host.
+template <class DeviceType>
+struct KokkosHostRombergWorkerFunctor {
+
+  typedef DeviceType device_type;
+
+  KokkosHostRombergWorkerFunctor(const double integrationBounds0,
+                                 const double finestDx,
+                                 const Utilities::LargeIndex
+                                 numberOfFinestIntervals,
+                                 const unsigned int numberOfLevels,
+                                 KokkosThreadLevelSums * threadLevelSums) :
+    _integrationBounds0(integrationBounds0),
+    _finestDx(finestDx),
+    _numberOfFinestIntervals(numberOfFinestIntervals),
+    _numberOfLevels(numberOfLevels),
+    _threadLevelSums(threadLevelSums) {
+  }
+
+  void operator()(const Utilities::LargeIndex blockIndex) const {
+    const Utilities::BusyChunk chunk;
+    RombergLevelSums * const levelSumsOfThread =
+      _threadLevelSums->getRow(
+        Utilities::getKokkosThreadIndex<DeviceType>());
+    const Utilities::LargeIndex numberOfPoints = _numberOfFinestIntervals + 1;
+    const Utilities::LargeIndex blockBeginIndex =
+      blockIndex * RombergPointsPerBlock;
+    const unsigned int blockSize =
+      std::min(RombergPointsPerBlock, numberOfPoints - blockBeginIndex);
+    for (unsigned int offset = 0; offset < blockSize; ++offset) {
+      accumulateRombergPoint(_integrationBounds0, _finestDx,
+                             _numberOfFinestIntervals, _numberOfLevels,
+                             blockBeginIndex + offset, levelSumsOfThread);
+    }
+  }
+
+private:
+  KokkosHostRombergWorkerFunctor();
+  const double _integrationBounds0;
+  const double _finestDx;
+  const Utilities::LargeIndex _numberOfFinestIntervals;
+  const unsigned int _numberOfLevels;
+  KokkosThreadLevelSums * const _threadLevelSums;
+
+};
+
+template <class DeviceType>
+class KokkosRombergTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType =
+    Utilities::KokkosProcessorTypeConverter<DeviceType>::ProcessorType;
+
+  KokkosRombergTestFunctor(const array<double, 2> & integrationBounds,
+                           const Utilities::LargeIndex
+                           numberOfCoarsestIntervals,
+                           const unsigned int numberOfLevels) :
+    _integrationBounds(integrationBounds),
+    _numberOfCoarsestIntervals(numberOfCoarsestIntervals),
+    _numberOfLevels(numberOfLevels) {
+    checkNumberOfRombergLevels(numberOfLevels);
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const Utilities::LargeIndex numberOfFinestIntervals =
+      computeNumberOfFinestRombergIntervals(_numberOfCoarsestIntervals,
+                                            _numberOfLevels);
+    const unsigned int numberOfLevels = _numberOfLevels;
+    const double integrationBounds0 = _integrationBounds[0];
+    const double finestDx =
+      (_integrationBounds[1] - integrationBounds0) / numberOfFinestIntervals;
+
+    RombergLevelSums levelSums;
+    accumulateLevels(integrationBounds0, finestDx, numberOfFinestIntervals,
+                     numberOfLevels, &levelSums,
+                     std::integral_constant<bool, ProcessorType == Cpu>());
+
+    *answer = extrapolateRomberg(levelSums, _integrationBounds,
+                                 _numberOfCoarsestIntervals, _numberOfLevels);
+  }
+
+  Utilities::LargeIndex
+  getNumberOfEvaluations() const {
+    return computeNumberOfFinestRombergIntervals(_numberOfCoarsestIntervals,
+                                                 _numberOfLevels) + 1;
+  }
+
+  string
+  getName() const {
+    return string("kokkos ") +
+      Utilities::KokkosDeviceNameConverter<DeviceType>().getName() +
+      string(" romberg");
+  }
+
+private:
+
+  // the device reduces through kokkos
+  void
+  accumulateLevels(const double integrationBounds0,
+                   const double finestDx,
+                   const Utilities::LargeIndex numberOfFinestIntervals,
+                   const unsigned int numberOfLevels,
+                   RombergLevelSums * levelSums,
+                   std::false_type) const {
+    const KokkosRombergWorkerFunctor<DeviceType>
+      worker(integrationBounds0, finestDx, numberOfFinestIntervals,
+             numberOfLevels);
+    Kokkos::parallel_reduce(
+      Utilities::LargeRangePolicy<DeviceType>::create(
+        0, numberOfFinestIntervals + 1, Utilities::getKokkosChunkSize()),
+      worker, *levelSums);
+  }
+
+  // and the host into per-thread rows, merged in the order of the threads
+  void
+  accumulateLevels(const double integrationBounds0,
+                   const double finestDx,
+                   const Utilities::LargeIndex numberOfFinestIntervals,
+                   const unsigned int numberOfLevels,
+                   RombergLevelSums * levelSums,
+                   std::true_type) const {
+    const Utilities::LargeIndex numberOfBlocks =
+      (numberOfFinestIntervals + RombergPointsPerBlock) /
+      RombergPointsPerBlock;
+    const unsigned int numberOfThreadIndices =
+      Utilities::getKokkosNumberOfThreadIndices<DeviceType>();
+    KokkosThreadLevelSums & threadLevelSums =
+      Utilities::Workspace::getInstance().getObject<KokkosThreadLevelSums>(
+        "kokkos thread level sums", [=] () {
+          return KokkosThreadLevelSums(numberOfThreadIndices, 1,
+                                       RombergLevelSums());
+        });
+    {
+      const Utilities::ScopedPhase phase("accumulate levels");
+      threadLevelSums.reset();
+      const KokkosHostRombergWorkerFunctor<DeviceType>
+        worker(integrationBounds0, finestDx, numberOfFinestIntervals,
+               numberOfLevels, &threadLevelSums);
+      Kokkos::parallel_for(
+        Utilities::LargeRangePolicy<DeviceType>::create(
+          0, numberOfBlocks, Utilities::getKokkosChunkSize()),
+        worker);
+      // the rows are only done once the loop is
+      DeviceType().fence();
+    }
+    const Utilities::ScopedPhase phase("combine");
+    threadLevelSums.combine(levelSums,
+                            [] (RombergLevelSums x,
+                                const RombergLevelSums & y) {
+                              x += y;
+                              return x;
+                            });
+  }
+
   const array<double, 2> _integrationBounds;
-  const unsigned int _numberOfIntervals;
+  const Utilities::LargeIndex _numberOfCoarsestIntervals;
+  const unsigned int _numberOfLevels;
 };
 
 #endif // SCALARINTEGRATOR_KOKKOS_H
@@ -3,6 +3,13 @@
 #define SCALARINTEGRATOR_OMP_H
 
 #include "../Utilities.h"
+#include "ScalarIntegration_sequences.h"
+#include "ScalarIntegration_romberg.h"
+#include "../Tracer.h"
+#include "../PhaseTimers.h"
+#include "../LoadBalance.h"
+#include "../Workspace.h"
+#include "../PerThreadAccumulator.h"
 
 // header files for omp
 #include <omp.h>
@@ -13,7 +20,7 @@ public:
   static const CpuOrGpuType ProcessorType = Cpu;
 
   OmpTestFunctor(const array<double, 2> & integrationBounds,
-                 const unsigned int numberOfIntervals) :
+                 const Utilities::LargeIndex numberOfIntervals) :
     _integrationBounds(integrationBounds),
     _numberOfIntervals(numberOfIntervals) {
 
@@ -22,7 +29,33 @@ public:
   void
   computeAnswer(double * answer) const {
 
+    const double dx =
+      (_integrationBounds[1] - _integrationBounds[0]) / _numberOfIntervals;
+    const double integrationBounds0 = _integrationBounds[0];
+
+    // a block of intervals per iteration, so that marking the chunks
+    //  doesn't cost more than the sins
+    const Utilities::LargeIndex intervalsPerBlock = 1 << 14;
+    const Utilities::LargeIndex numberOfBlocks =
+      (_numberOfIntervals + intervalsPerBlock - 1) / intervalsPerBlock;
     double totalIntegral = 0;
+    Utilities::setOmpSchedule(omp_sched_static);
+#pragma omp parallel for reduction(+:totalIntegral) schedule(runtime)
+    for (Utilities::LargeIndex blockIndex = 0;
+         blockIndex < numberOfBlocks; ++blockIndex) {
+      const Utilities::BusyChunk chunk;
+      // the counter within the block is 32 bits, like forEachChunk's
+      const Utilities::LargeIndex blockBeginIndex =
+        blockIndex * intervalsPerBlock;
+      const unsigned int blockSize =
+        std::min(intervalsPerBlock, _numberOfIntervals - blockBeginIndex);
+      for (unsigned int offset = 0; offset < blockSize; ++offset) {
+        const double evaluationPoint =
+          integrationBounds0 + (double(blockBeginIndex + offset) + 0.5) * dx;
+        totalIntegral += std::sin(evaluationPoint);
+      }
+    }
+    totalIntegral *= dx;
 
     *answer = totalIntegral;
   }
@@ -34,7 +67,205 @@ public:
 
 private:
   const array<double, 2> _integrationBounds;
-  const unsigned int _numberOfIntervals;
+  const Utilities::LargeIndex _numberOfIntervals;
+};
+
+template <class SequenceType>
+class OmpMonteCarloTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  OmpMonteCarloTestFunctor(const SequenceType & sequence,
+                           const SinProductIntegrand & integrand,
+                           const uint64_t numberOfSamples) :
+    _sequence(sequence),
+    _integrand(integrand),
+    _numberOfSamples(numberOfSamples) {
+    checkNumberOfSamples<SequenceType>(numberOfSamples);
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const Utilities::LargeIndex numberOfChunks =
+      computeNumberOfChunks(_numberOfSamples);
+
+    double totalIntegral = 0;
+    Utilities::setOmpSchedule(omp_sched_static);
+#pragma omp parallel for reduction(+:totalIntegral) schedule(runtime)
+    for (Utilities::LargeIndex chunkIndex = 0;
+         chunkIndex < numberOfChunks; ++chunkIndex) {
+      const Utilities::TraceSpan span("monte carlo chunk");
+      const Utilities::BusyChunk chunk;
+      totalIntegral +=
+        sumIntegrandOverChunk(_sequence, _integrand, chunkIndex,
+                              _numberOfSamples);
+    }
+    totalIntegral *= _integrand.getVolume() / _numberOfSamples;
+
+    *answer = totalIntegral;
+  }
+
+  string
+  getName() const {
+    return string("omp ") + SequenceType::getName();
+  }
+
+private:
+  const SequenceType _sequence;
+  const SinProductIntegrand _integrand;
+  const uint64_t _numberOfSamples;
+};
+
+// the integrals are different sizes, so we hand them out dynamically.
+class OmpBatchedTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  OmpBatchedTestFunctor(const vector<array<double, 2> > & integrationBounds,
+                        const vector<unsigned int> & numbersOfIntervals) :
+    _integrationBounds(integrationBounds),
+    _numbersOfIntervals(numbersOfIntervals) {
+
+  }
+
+  void
+  computeAnswer(vector<double> * answers) const {
+
+    vector<double> & integrals = *answers;
+    const int numberOfIntegrals = _integrationBounds.size();
+    integrals.resize(numberOfIntegrals);
+
+    Utilities::setOmpSchedule(omp_sched_dynamic);
+#pragma omp parallel for schedule(runtime)
+    for (int integralIndex = 0;
+         integralIndex < numberOfIntegrals; ++integralIndex) {
+      const Utilities::TraceSpan span("integral");
+      const Utilities::BusyChunk chunk;
+      const unsigned int numberOfIntervals =
+        _numbersOfIntervals[integralIndex];
+      const double integrationBounds0 = _integrationBounds[integralIndex][0];
+      const double dx =
+        (_integrationBounds[integralIndex][1] - integrationBounds0) /
+        numberOfIntervals;
+      double integral = 0;
+#pragma omp simd reduction(+:integral)
+      for (unsigned int intervalIndex = 0;
+           intervalIndex < numberOfIntervals; ++intervalIndex) {
+        const double evaluationPoint =
+          integrationBounds0 + (double(intervalIndex) + 0.5) * dx;
+        integral += std::sin(evaluationPoint);
+      }
+      integrals[integralIndex] = integral * dx;
+    }
+  }
+
+  string
+  getName() const {
+    return string("omp batched");
+  }
+
+private:
+  const vector<array<double, 2> > & _integrationBounds;
+  const vector<unsigned int> & _numbersOfIntervals;
+};
+
+class OmpRombergTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  OmpRombergTestFunctor(const array<double, 2> & integrationBounds,
+                        const Utilities::LargeIndex numberOfCoarsestIntervals,
+                        const unsigned int numberOfLevels) :
+    _integrationBounds(integrationBounds),
+    _numberOfCoarsestIntervals(numberOfCoarsestIntervals),
+    _numberOfLevels(numberOfLevels) {
+    checkNumberOfRombergLevels(numberOfLevels);
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const Utilities::LargeIndex numberOfFinestIntervals =
+      computeNumberOfFinestRombergIntervals(_numberOfCoarsestIntervals,
+                                            _numberOfLevels);
+    const unsigned int numberOfLevels = _numberOfLevels;
+    const double integrationBounds0 = _integrationBounds[0];
+    const double finestDx =
+      (_integrationBounds[1] - integrationBounds0) / numberOfFinestIntervals;
+
+    const Utilities::LargeIndex numberOfPoints = numberOfFinestIntervals + 1;
+    const Utilities::LargeIndex numberOfBlocks =
+      (numberOfPoints + RombergPointsPerBlock - 1) / RombergPointsPerBlock;
+    // merged in the order of the threads, so that the answer doesn't change
+    //  with which of them finishes first
+    typedef Utilities::PerThreadAccumulator<RombergLevelSums>
+      ThreadLevelSums;
+    const unsigned int numberOfThreads = omp_get_max_threads();
+    ThreadLevelSums & threadLevelSums =
+      Utilities::Workspace::getInstance().getObject<ThreadLevelSums>(
+        "thread level sums", [=] () {
+          return ThreadLevelSums(numberOfThreads, 1, RombergLevelSums());
+        });
+    {
+      const Utilities::ScopedPhase phase("accumulate levels");
+      threadLevelSums.reset();
+      Utilities::setOmpSchedule(omp_sched_static);
+#pragma omp parallel
+      {
+        RombergLevelSums * const levelSumsOfThread =
+          threadLevelSums.getRow(Utilities::getOmpThreadIndex());
+#pragma omp for schedule(runtime)
+        for (Utilities::LargeIndex blockIndex = 0;
+             blockIndex < numberOfBlocks; ++blockIndex) {
+          const Utilities::BusyChunk chunk;
+          const Utilities::LargeIndex blockBeginIndex =
+            blockIndex * RombergPointsPerBlock;
+          const unsigned int blockSize =
+            std::min(RombergPointsPerBlock, numberOfPoints - blockBeginIndex);
+          for (unsigned int offset = 0; offset < blockSize; ++offset) {
+            accumulateRombergPoint(integrationBounds0, finestDx,
+                                   numberOfFinestIntervals, numberOfLevels,
+                                   blockBeginIndex + offset,
+                                   levelSumsOfThread);
+          }
+        }
+      }
+    }
+    RombergLevelSums levelSums;
+    {
+      const Utilities::ScopedPhase phase("combine");
+      threadLevelSums.combine(&levelSums,
+                              [] (RombergLevelSums x,
+                                  const RombergLevelSums & y) {
+                                x += y;
+                                return x;
+                              });
+    }
+
+    const Utilities::ScopedPhase phase("extrapolate");
+    *answer = extrapolateRomberg(levelSums, _integrationBounds,
+                                 _numberOfCoarsestIntervals, _numberOfLevels);
+  }
+
+  Utilities::LargeIndex
+  getNumberOfEvaluations() const {
+    return computeNumberOfFinestRombergIntervals(_numberOfCoarsestIntervals,
+                                                 _numberOfLevels) + 1;
+  }
+
+  string
+  getName() const {
+    return string("omp romberg");
+  }
+
+private:
+  const array<double, 2> _integrationBounds;
+  const Utilities::LargeIndex _numberOfCoarsestIntervals;
+  const unsigned int _numberOfLevels;
 };
 
 #endif // SCALARINTEGRATOR_OMP_H
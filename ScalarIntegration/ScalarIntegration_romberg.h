@@ -0,0 +1,137 @@
+// -*- C++ -*-
+#ifndef SCALARINTEGRATION_ROMBERG_H
+#define SCALARINTEGRATION_ROMBERG_H
+
+// pieces shared by the romberg functors of every backend.
+//
+// the trapezoid rule with n, 2n, 4n, ... intervals evaluates the integrand
+//  on nested grids: every point of a coarse grid is also a point of all of
+//  the finer ones.  so we walk the finest grid once, and file each
+//  evaluation under the coarsest level that contains it.  the trapezoid sum
+//  of level k is then just the sum of the bins up to k, and richardson
+//  extrapolation of those sums cancels the error terms one power of dx^2 at
+//  a time.
+
+#include "../Utilities.h"
+
+// header files for kokkos types
+#include <Kokkos_Core.hpp>
+
+const unsigned int MaxNumberOfRombergLevels = 16;
+
+// the loops over the finest grid that are scheduled by hand take the
+//  points in blocks of this many, so that there's something to schedule
+//  that's worth timing
+const Utilities::LargeIndex RombergPointsPerBlock = 4096;
+
+struct RombergLevelSums {
+
+  KOKKOS_INLINE_FUNCTION
+  RombergLevelSums() {
+    for (unsigned int level = 0; level < MaxNumberOfRombergLevels; ++level) {
+      _sums[level] = 0;
+    }
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  RombergLevelSums &
+  operator+=(const RombergLevelSums & other) {
+    for (unsigned int level = 0; level < MaxNumberOfRombergLevels; ++level) {
+      _sums[level] += other._sums[level];
+    }
+    return *this;
+  }
+
+  // kokkos joins reduction values through volatile references
+  KOKKOS_INLINE_FUNCTION
+  void
+  operator+=(const volatile RombergLevelSums & other) volatile {
+    for (unsigned int level = 0; level < MaxNumberOfRombergLevels; ++level) {
+      _sums[level] += other._sums[level];
+    }
+  }
+
+  double _sums[MaxNumberOfRombergLevels];
+};
+
+// the finest grid has numberOfCoarsestIntervals * 2^(numberOfLevels - 1)
+//  intervals, so points that are multiples of 2^(numberOfLevels - 1 - k)
+//  first show up at level k.
+KOKKOS_INLINE_FUNCTION
+unsigned int
+computeRombergLevel(const Utilities::LargeIndex pointIndex,
+                    const unsigned int numberOfLevels) {
+  unsigned int finestLevel = numberOfLevels - 1;
+  if (pointIndex == 0) {
+    return 0;
+  }
+  Utilities::LargeIndex index = pointIndex;
+  while ((index & 1) == 0 && finestLevel > 0) {
+    index >>= 1;
+    --finestLevel;
+  }
+  return finestLevel;
+}
+
+// add one point of the finest grid into its bin.  the endpoints only get
+//  half weight in the trapezoid rule.
+KOKKOS_INLINE_FUNCTION
+void
+accumulateRombergPoint(const double integrationBounds0,
+                       const double finestDx,
+                       const Utilities::LargeIndex numberOfFinestIntervals,
+                       const unsigned int numberOfLevels,
+                       const Utilities::LargeIndex pointIndex,
+                       RombergLevelSums * levelSums) {
+  const double value = sin(integrationBounds0 + pointIndex * finestDx);
+  const double weight =
+    (pointIndex == 0 || pointIndex == numberOfFinestIntervals) ? 0.5 : 1.;
+  levelSums->_sums[computeRombergLevel(pointIndex, numberOfLevels)] +=
+    weight * value;
+}
+
+inline
+Utilities::LargeIndex
+computeNumberOfFinestRombergIntervals(
+  const Utilities::LargeIndex numberOfCoarsestIntervals,
+  const unsigned int numberOfLevels) {
+  return numberOfCoarsestIntervals << (numberOfLevels - 1);
+}
+
+inline
+void
+checkNumberOfRombergLevels(const unsigned int numberOfLevels) {
+  if (numberOfLevels < 2 || numberOfLevels > MaxNumberOfRombergLevels) {
+    fprintf(stderr, "romberg needs between 2 and %u levels, not %u\n",
+            MaxNumberOfRombergLevels, numberOfLevels);
+    exit(1);
+  }
+}
+
+// turn the binned sums into trapezoid sums and extrapolate them.
+inline
+double
+extrapolateRomberg(const RombergLevelSums & levelSums,
+                   const array<double, 2> & integrationBounds,
+                   const Utilities::LargeIndex numberOfCoarsestIntervals,
+                   const unsigned int numberOfLevels) {
+  double table[MaxNumberOfRombergLevels][MaxNumberOfRombergLevels];
+  double cumulativeSum = 0;
+  double dx =
+    (integrationBounds[1] - integrationBounds[0]) / numberOfCoarsestIntervals;
+  for (unsigned int level = 0; level < numberOfLevels; ++level) {
+    cumulativeSum += levelSums._sums[level];
+    table[level][0] = cumulativeSum * dx;
+    double powerOfFour = 1;
+    for (unsigned int column = 1; column <= level; ++column) {
+      powerOfFour *= 4;
+      table[level][column] = table[level][column - 1] +
+        (table[level][column - 1] - table[level - 1][column - 1]) /
+        (powerOfFour - 1);
+    }
+    dx /= 2;
+  }
+  return table[numberOfLevels - 1][numberOfLevels - 1];
+}
+
+#endif // SCALARINTEGRATION_ROMBERG_H
@@ -0,0 +1,375 @@
+// -*- C++ -*-
+#ifndef SCALARINTEGRATION_SEQUENCES_H
+#define SCALARINTEGRATION_SEQUENCES_H
+
+// sample point sequences and the integrand for multi-dimensional
+//  (quasi-)monte carlo integration.  every sequence supports skip-ahead,
+//  so each chunk of samples can be generated independently by whichever
+//  thread or kokkos work item owns it.
+
+#include "../Utilities.h"
+#include "../CounterBasedRandom.h"
+
+#include <cstdint>
+
+// header files for kokkos types
+#include <Kokkos_Core.hpp>
+
+// the largest number of dimensions for which we have sobol direction numbers
+//  and halton bases.
+const unsigned int MaxNumberOfDimensions = 16;
+// each work item generates this many consecutive samples
+const unsigned int NumberOfSamplesPerChunk = 1024;
+
+// sobol sequence with gray code ordering.  point n is the xor of the
+//  direction numbers picked out by the bits of gray(n), so we can jump to
+//  any n directly and then walk forward one xor per dimension per point.
+class SobolSequence {
+public:
+
+  struct State {
+    uint32_t _index;
+    uint32_t _coordinates[MaxNumberOfDimensions];
+  };
+
+  SobolSequence(const unsigned int numberOfDimensions) :
+    _numberOfDimensions(numberOfDimensions) {
+
+    // primitive polynomials and initial direction numbers from joe and kuo,
+    //  "Constructing Sobol sequences with better two-dimensional
+    //  projections", for dimensions 2 through 16.  dimension 1 is the van
+    //  der corput sequence.
+    const unsigned int degrees[MaxNumberOfDimensions] =
+      {0, 1, 2, 3, 3, 4, 4, 5, 5, 5, 5, 5, 5, 6, 6, 6};
+    const unsigned int polynomials[MaxNumberOfDimensions] =
+      {0, 0, 1, 1, 2, 1, 4, 2, 4, 7, 11, 13, 14, 1, 13, 16};
+    const unsigned int initialNumbers[MaxNumberOfDimensions][6] =
+      {{0, 0, 0, 0, 0, 0},
+       {1, 0, 0, 0, 0, 0},
+       {1, 3, 0, 0, 0, 0},
+       {1, 3, 1, 0, 0, 0},
+       {1, 1, 1, 0, 0, 0},
+       {1, 1, 3, 3, 0, 0},
+       {1, 3, 5, 13, 0, 0},
+       {1, 1, 5, 5, 17, 0},
+       {1, 1, 5, 5, 5, 0},
+       {1, 1, 7, 11, 19, 0},
+       {1, 1, 5, 1, 1, 0},
+       {1, 1, 1, 3, 11, 0},
+       {1, 3, 5, 5, 31, 0},
+       {1, 3, 3, 9, 7, 49},
+       {1, 1, 1, 15, 21, 21},
+       {1, 3, 1, 13, 27, 49}};
+
+    for (unsigned int bitIndex = 0; bitIndex < 32; ++bitIndex) {
+      _directionNumbers[0][bitIndex] = uint32_t(1) << (31 - bitIndex);
+    }
+    for (unsigned int dimension = 1;
+         dimension < MaxNumberOfDimensions; ++dimension) {
+      uint32_t * directionNumbers = _directionNumbers[dimension];
+      const unsigned int degree = degrees[dimension];
+      for (unsigned int bitIndex = 0; bitIndex < degree; ++bitIndex) {
+        directionNumbers[bitIndex] =
+          initialNumbers[dimension][bitIndex] << (31 - bitIndex);
+      }
+      for (unsigned int bitIndex = degree; bitIndex < 32; ++bitIndex) {
+        uint32_t value = directionNumbers[bitIndex - degree];
+        value ^= value >> degree;
+        for (unsigned int k = 1; k < degree; ++k) {
+          if ((polynomials[dimension] >> (degree - 1 - k)) & 1) {
+            value ^= directionNumbers[bitIndex - k];
+          }
+        }
+        directionNumbers[bitIndex] = value;
+      }
+    }
+  }
+
+  // the functors check the number of samples against
+  //  getMaximumNumberOfPoints, so the index fits in 32 bits
+  KOKKOS_INLINE_FUNCTION
+  void
+  skipTo(const uint64_t index, State * state) const {
+    const uint32_t grayCode = uint32_t(index) ^ (uint32_t(index) >> 1);
+    state->_index = uint32_t(index);
+    for (unsigned int dimension = 0;
+         dimension < _numberOfDimensions; ++dimension) {
+      uint32_t coordinate = 0;
+      for (unsigned int bitIndex = 0; bitIndex < 32; ++bitIndex) {
+        if ((grayCode >> bitIndex) & 1) {
+          coordinate ^= _directionNumbers[dimension][bitIndex];
+        }
+      }
+      state->_coordinates[dimension] = coordinate;
+    }
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  void
+  generatePoint(State * state, double * point) const {
+    for (unsigned int dimension = 0;
+         dimension < _numberOfDimensions; ++dimension) {
+      point[dimension] =
+        state->_coordinates[dimension] * (1. / 4294967296.);
+    }
+    // the next gray code differs in the lowest zero bit of the index
+    unsigned int changedBit = 0;
+    for (uint32_t index = state->_index; index & 1; index >>= 1) {
+      ++changedBit;
+    }
+    for (unsigned int dimension = 0;
+         dimension < _numberOfDimensions; ++dimension) {
+      state->_coordinates[dimension] ^=
+        _directionNumbers[dimension][changedBit];
+    }
+    ++state->_index;
+  }
+
+  // the walk forward needs one more direction number than the index has
+  //  bits, so we stop one short of 2^32.
+  static
+  uint64_t
+  getMaximumNumberOfPoints() {
+    return (uint64_t(1) << 32) - 1;
+  }
+
+  static
+  string
+  getName() {
+    return string("sobol");
+  }
+
+private:
+  unsigned int _numberOfDimensions;
+  uint32_t _directionNumbers[MaxNumberOfDimensions][32];
+};
+
+// halton sequence: dimension d is the radical inverse of the index in the
+//  d'th prime base, so skipping ahead is just remembering the index.
+class HaltonSequence {
+public:
+
+  struct State {
+    uint64_t _index;
+  };
+
+  HaltonSequence(const unsigned int numberOfDimensions) :
+    _numberOfDimensions(numberOfDimensions) {
+    const unsigned int primes[MaxNumberOfDimensions] =
+      {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+    for (unsigned int dimension = 0;
+         dimension < MaxNumberOfDimensions; ++dimension) {
+      _bases[dimension] = primes[dimension];
+    }
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  void
+  skipTo(const uint64_t index, State * state) const {
+    state->_index = index;
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  void
+  generatePoint(State * state, double * point) const {
+    for (unsigned int dimension = 0;
+         dimension < _numberOfDimensions; ++dimension) {
+      const unsigned int base = _bases[dimension];
+      const double inverseBase = 1. / base;
+      double factor = inverseBase;
+      double radicalInverse = 0;
+      for (uint64_t index = state->_index; index > 0; index /= base) {
+        radicalInverse += (index % base) * factor;
+        factor *= inverseBase;
+      }
+      point[dimension] = radicalInverse;
+    }
+    ++state->_index;
+  }
+
+  static
+  uint64_t
+  getMaximumNumberOfPoints() {
+    return ~uint64_t(0);
+  }
+
+  static
+  string
+  getName() {
+    return string("halton");
+  }
+
+private:
+  unsigned int _numberOfDimensions;
+  unsigned int _bases[MaxNumberOfDimensions];
+};
+
+// plain pseudo-random monte carlo.  the counter is (sample index, pair of
+//  dimensions), so this is as easy to skip through as the others.
+class PseudoRandomSequence {
+public:
+
+  struct State {
+    uint64_t _index;
+  };
+
+  PseudoRandomSequence(const unsigned int numberOfDimensions,
+                       const uint64_t seed = 0) :
+    _numberOfDimensions(numberOfDimensions),
+    _generator(seed) {
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  void
+  skipTo(const uint64_t index, State * state) const {
+    state->_index = index;
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  void
+  generatePoint(State * state, double * point) const {
+    for (unsigned int dimension = 0;
+         dimension < _numberOfDimensions; dimension += 2) {
+      const Utilities::PhiloxBlock block =
+        _generator.generateBlock(state->_index, dimension / 2);
+      point[dimension] =
+        Utilities::CounterBasedRandomNumberGenerator::convertToUniformDouble(
+          block._values[0], block._values[1]);
+      if (dimension + 1 < _numberOfDimensions) {
+        point[dimension + 1] =
+          Utilities::CounterBasedRandomNumberGenerator::convertToUniformDouble(
+            block._values[2], block._values[3]);
+      }
+    }
+    ++state->_index;
+  }
+
+  static
+  uint64_t
+  getMaximumNumberOfPoints() {
+    return ~uint64_t(0);
+  }
+
+  static
+  string
+  getName() {
+    return string("random");
+  }
+
+private:
+  unsigned int _numberOfDimensions;
+  Utilities::CounterBasedRandomNumberGenerator _generator;
+};
+
+// the product of sin over a box, because we love integrating sin.
+class SinProductIntegrand {
+public:
+
+  SinProductIntegrand(const vector<array<double, 2> > & integrationBounds) :
+    _numberOfDimensions(integrationBounds.size()),
+    _volume(1) {
+    if (_numberOfDimensions > MaxNumberOfDimensions) {
+      fprintf(stderr, "cannot integrate in %u dimensions, the most we can "
+              "do is %u\n", _numberOfDimensions, MaxNumberOfDimensions);
+      exit(1);
+    }
+    for (unsigned int dimension = 0;
+         dimension < _numberOfDimensions; ++dimension) {
+      _lowerBounds[dimension] = integrationBounds[dimension][0];
+      _widths[dimension] =
+        integrationBounds[dimension][1] - integrationBounds[dimension][0];
+      _volume *= _widths[dimension];
+    }
+  }
+
+  // evaluate at a point in the unit cube
+  KOKKOS_INLINE_FUNCTION
+  double
+  evaluate(const double * unitPoint) const {
+    double value = 1;
+    for (unsigned int dimension = 0;
+         dimension < _numberOfDimensions; ++dimension) {
+      value *= sin(_lowerBounds[dimension] +
+                   unitPoint[dimension] * _widths[dimension]);
+    }
+    return value;
+  }
+
+  double
+  computeExactIntegral() const {
+    double integral = 1;
+    for (unsigned int dimension = 0;
+         dimension < _numberOfDimensions; ++dimension) {
+      integral *= std::cos(_lowerBounds[dimension]) -
+        std::cos(_lowerBounds[dimension] + _widths[dimension]);
+    }
+    return integral;
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  unsigned int
+  getNumberOfDimensions() const {
+    return _numberOfDimensions;
+  }
+
+  KOKKOS_INLINE_FUNCTION
+  double
+  getVolume() const {
+    return _volume;
+  }
+
+private:
+  unsigned int _numberOfDimensions;
+  double _volume;
+  double _lowerBounds[MaxNumberOfDimensions];
+  double _widths[MaxNumberOfDimensions];
+};
+
+// the sum of the integrand over one chunk of the sequence.  every backend
+//  splits the samples into the same chunks, so they all see the same points.
+template <class SequenceType>
+KOKKOS_INLINE_FUNCTION
+double
+sumIntegrandOverChunk(const SequenceType & sequence,
+                      const SinProductIntegrand & integrand,
+                      const uint64_t chunkIndex,
+                      const uint64_t numberOfSamples) {
+  const uint64_t beginIndex = chunkIndex * NumberOfSamplesPerChunk;
+  const uint64_t endIndex =
+    (beginIndex + NumberOfSamplesPerChunk < numberOfSamples) ?
+    beginIndex + NumberOfSamplesPerChunk : numberOfSamples;
+  // chunks are small, so the inner loop can count in 32 bits
+  const unsigned int chunkSize = endIndex - beginIndex;
+  typename SequenceType::State state;
+  sequence.skipTo(beginIndex, &state);
+  double point[MaxNumberOfDimensions];
+  double sum = 0;
+  for (unsigned int sampleIndex = 0; sampleIndex < chunkSize; ++sampleIndex) {
+    sequence.generatePoint(&state, point);
+    sum += integrand.evaluate(point);
+  }
+  return sum;
+}
+
+inline
+uint64_t
+computeNumberOfChunks(const uint64_t numberOfSamples) {
+  return (numberOfSamples + NumberOfSamplesPerChunk - 1) /
+    NumberOfSamplesPerChunk;
+}
+
+// past its maximum a sequence would wrap around and repeat its points, so
+//  the monte carlo functors refuse to be made for that many samples
+template <class SequenceType>
+void
+checkNumberOfSamples(const uint64_t numberOfSamples) {
+  if (numberOfSamples > SequenceType::getMaximumNumberOfPoints()) {
+    fprintf(stderr, "the %s sequence has at most %llu points, not %llu\n",
+            SequenceType::getName().c_str(),
+            (unsigned long long)SequenceType::getMaximumNumberOfPoints(),
+            (unsigned long long)numberOfSamples);
+    exit(1);
+  }
+}
+
+#endif // SCALARINTEGRATION_SEQUENCES_H
@@ -3,6 +3,9 @@
 #define SCALARINTEGRATOR_SERIAL_H
 
 #include "../Utilities.h"
+#include "../PhaseTimers.h"
+#include "ScalarIntegration_sequences.h"
+#include "ScalarIntegration_romberg.h"
 
 class SerialTestFunctor {
 public:
@@ -10,7 +13,7 @@ public:
   static const CpuOrGpuType ProcessorType = Cpu;
 
   SerialTestFunctor(const array<double, 2> & integrationBounds,
-                    const unsigned int numberOfIntervals) :
+                    const Utilities::LargeIndex numberOfIntervals) :
     _integrationBounds(integrationBounds),
     _numberOfIntervals(numberOfIntervals) {
 
@@ -19,18 +22,24 @@ public:
   void
   computeAnswer(double * answer) const {
 
-    const size_t numberOfIntervals = _numberOfIntervals;
+    const Utilities::LargeIndex numberOfIntervals = _numberOfIntervals;
     const double dx =
       (_integrationBounds[1] - _integrationBounds[0]) / numberOfIntervals;
     const double integrationBounds0 = _integrationBounds[0];
 
     double totalIntegral = 0;
-    for (size_t intervalIndex = 0;
-         intervalIndex < numberOfIntervals; ++intervalIndex) {
-      const double evaluationPoint =
-        integrationBounds0 + (double(intervalIndex) + 0.5) * dx;
-      totalIntegral += std::sin(evaluationPoint);
-    }
+    Utilities::forEachChunk(0, numberOfIntervals,
+                            [&] (const Utilities::LargeIndex chunkBeginIndex,
+                                 const unsigned int chunkSize) {
+      const double chunkEvaluationPoint =
+        integrationBounds0 + (double(chunkBeginIndex) + 0.5) * dx;
+      for (unsigned int intervalIndex = 0;
+           intervalIndex < chunkSize; ++intervalIndex) {
+        const double evaluationPoint =
+          chunkEvaluationPoint + double(intervalIndex) * dx;
+        totalIntegral += std::sin(evaluationPoint);
+      }
+    });
     totalIntegral *= dx;
 
     *answer = totalIntegral;
@@ -43,7 +52,161 @@ public:
 
 private:
   const array<double, 2> _integrationBounds;
-  const unsigned int _numberOfIntervals;
+  const Utilities::LargeIndex _numberOfIntervals;
+};
+
+template <class SequenceType>
+class SerialMonteCarloTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  SerialMonteCarloTestFunctor(const SequenceType & sequence,
+                              const SinProductIntegrand & integrand,
+                              const uint64_t numberOfSamples) :
+    _sequence(sequence),
+    _integrand(integrand),
+    _numberOfSamples(numberOfSamples) {
+    checkNumberOfSamples<SequenceType>(numberOfSamples);
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const uint64_t numberOfChunks = computeNumberOfChunks(_numberOfSamples);
+
+    double totalIntegral = 0;
+    for (uint64_t chunkIndex = 0; chunkIndex < numberOfChunks; ++chunkIndex) {
+      totalIntegral +=
+        sumIntegrandOverChunk(_sequence, _integrand, chunkIndex,
+                              _numberOfSamples);
+    }
+    totalIntegral *= _integrand.getVolume() / _numberOfSamples;
+
+    *answer = totalIntegral;
+  }
+
+  string
+  getName() const {
+    return string("serial ") + SequenceType::getName();
+  }
+
+private:
+  const SequenceType _sequence;
+  const SinProductIntegrand _integrand;
+  const uint64_t _numberOfSamples;
+};
+
+// many small integrals at once, each with its own bounds and intervals.
+//  the integrals are small by construction, so their intervals are counted
+//  in 32 bits.
+class SerialBatchedTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  SerialBatchedTestFunctor(const vector<array<double, 2> > & integrationBounds,
+                           const vector<unsigned int> & numbersOfIntervals) :
+    _integrationBounds(integrationBounds),
+    _numbersOfIntervals(numbersOfIntervals) {
+
+  }
+
+  void
+  computeAnswer(vector<double> * answers) const {
+
+    vector<double> & integrals = *answers;
+    const unsigned int numberOfIntegrals = _integrationBounds.size();
+    integrals.resize(numberOfIntegrals);
+
+    for (unsigned int integralIndex = 0;
+         integralIndex < numberOfIntegrals; ++integralIndex) {
+      const unsigned int numberOfIntervals =
+        _numbersOfIntervals[integralIndex];
+      const double integrationBounds0 = _integrationBounds[integralIndex][0];
+      const double dx =
+        (_integrationBounds[integralIndex][1] - integrationBounds0) /
+        numberOfIntervals;
+      double integral = 0;
+      for (unsigned int intervalIndex = 0;
+           intervalIndex < numberOfIntervals; ++intervalIndex) {
+        const double evaluationPoint =
+          integrationBounds0 + (double(intervalIndex) + 0.5) * dx;
+        integral += std::sin(evaluationPoint);
+      }
+      integrals[integralIndex] = integral * dx;
+    }
+  }
+
+  string
+  getName() const {
+    return string("serial batched");
+  }
+
+private:
+  const vector<array<double, 2> > & _integrationBounds;
+  const vector<unsigned int> & _numbersOfIntervals;
+};
+
+// romberg extrapolation of the trapezoid rule on nested grids, from a single
+//  pass over the finest grid.
+class SerialRombergTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  SerialRombergTestFunctor(const array<double, 2> & integrationBounds,
+                           const Utilities::LargeIndex
+                           numberOfCoarsestIntervals,
+                           const unsigned int numberOfLevels) :
+    _integrationBounds(integrationBounds),
+    _numberOfCoarsestIntervals(numberOfCoarsestIntervals),
+    _numberOfLevels(numberOfLevels) {
+    checkNumberOfRombergLevels(numberOfLevels);
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const Utilities::LargeIndex numberOfFinestIntervals =
+      computeNumberOfFinestRombergIntervals(_numberOfCoarsestIntervals,
+                                            _numberOfLevels);
+    const unsigned int numberOfLevels = _numberOfLevels;
+    const double integrationBounds0 = _integrationBounds[0];
+    const double finestDx =
+      (_integrationBounds[1] - integrationBounds0) / numberOfFinestIntervals;
+
+    RombergLevelSums levelSums;
+    {
+      const Utilities::ScopedPhase phase("accumulate levels");
+      for (Utilities::LargeIndex pointIndex = 0;
+           pointIndex <= numberOfFinestIntervals; ++pointIndex) {
+        accumulateRombergPoint(integrationBounds0, finestDx,
+                               numberOfFinestIntervals, numberOfLevels,
+                               pointIndex, &levelSums);
+      }
+    }
+
+    const Utilities::ScopedPhase phase("extrapolate");
+    *answer = extrapolateRomberg(levelSums, _integrationBounds,
+                                 _numberOfCoarsestIntervals, _numberOfLevels);
+  }
+
+  Utilities::LargeIndex
+  getNumberOfEvaluations() const {
+    return computeNumberOfFinestRombergIntervals(_numberOfCoarsestIntervals,
+                                                 _numberOfLevels) + 1;
+  }
+
+  string
+  getName() const {
+    return string("serial romberg");
+  }
+
+private:
+  const array<double, 2> _integrationBounds;
+  const Utilities::LargeIndex _numberOfCoarsestIntervals;
+  const unsigned int _numberOfLevels;
 };
 
 #endif // SCALARINTEGRATOR_SERIAL_H
@@ -0,0 +1,253 @@
+// -*- C++ -*-
+#ifndef SCALARINTEGRATOR_STDPAR_H
+#define SCALARINTEGRATOR_STDPAR_H
+
+#include "../Utilities.h"
+#include "ScalarIntegration_sequences.h"
+#include "ScalarIntegration_romberg.h"
+#include "../PhaseTimers.h"
+#include "../StandardParallel.h"
+
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <execution>
+
+class StdParTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  StdParTestFunctor(const array<double, 2> & integrationBounds,
+                    const Utilities::LargeIndex numberOfIntervals) :
+    _integrationBounds(integrationBounds),
+    _numberOfIntervals(numberOfIntervals) {
+
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const Utilities::LargeIndex numberOfIntervals = _numberOfIntervals;
+    const double dx =
+      (_integrationBounds[1] - _integrationBounds[0]) / numberOfIntervals;
+    const double integrationBounds0 = _integrationBounds[0];
+
+    double totalIntegral =
+      std::transform_reduce(
+        std::execution::par_unseq,
+        Utilities::IndexIterator<Utilities::LargeIndex>(0),
+        Utilities::IndexIterator<Utilities::LargeIndex>(numberOfIntervals),
+        0., std::plus<double>(),
+        [=] (const Utilities::LargeIndex intervalIndex) {
+          const double evaluationPoint =
+            integrationBounds0 + (double(intervalIndex) + 0.5) * dx;
+          return std::sin(evaluationPoint);
+        });
+    totalIntegral *= dx;
+
+    *answer = totalIntegral;
+  }
+
+  string
+  getName() const {
+    return string("stdpar");
+  }
+
+private:
+  const array<double, 2> _integrationBounds;
+  const Utilities::LargeIndex _numberOfIntervals;
+};
+
+template <class SequenceType>
+class StdParMonteCarloTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  StdParMonteCarloTestFunctor(const SequenceType & sequence,
+                              const SinProductIntegrand & integrand,
+                              const uint64_t numberOfSamples) :
+    _sequence(sequence),
+    _integrand(integrand),
+    _numberOfSamples(numberOfSamples) {
+    checkNumberOfSamples<SequenceType>(numberOfSamples);
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const uint64_t numberOfChunks = computeNumberOfChunks(_numberOfSamples);
+
+    const SequenceType & sequence = _sequence;
+    const SinProductIntegrand & integrand = _integrand;
+    const uint64_t numberOfSamples = _numberOfSamples;
+    double totalIntegral =
+      std::transform_reduce(
+        std::execution::par_unseq,
+        Utilities::IndexIterator<uint64_t>(0),
+        Utilities::IndexIterator<uint64_t>(numberOfChunks),
+        0., std::plus<double>(),
+        [&] (const uint64_t chunkIndex) {
+          return sumIntegrandOverChunk(sequence, integrand, chunkIndex,
+                                       numberOfSamples);
+        });
+    totalIntegral *= _integrand.getVolume() / _numberOfSamples;
+
+    *answer = totalIntegral;
+  }
+
+  string
+  getName() const {
+    return string("stdpar ") + SequenceType::getName();
+  }
+
+private:
+  const SequenceType _sequence;
+  const SinProductIntegrand _integrand;
+  const uint64_t _numberOfSamples;
+};
+
+// nested parallelism: the outer loop is par and not par_unseq, because its
+//  iterations start parallel algorithms of their own, which the library
+//  may have to synchronize
+class StdParBatchedTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  StdParBatchedTestFunctor(const vector<array<double, 2> > &
+                           integrationBounds,
+                           const vector<unsigned int> & numbersOfIntervals) :
+    _integrationBounds(integrationBounds),
+    _numbersOfIntervals(numbersOfIntervals) {
+
+  }
+
+  void
+  computeAnswer(vector<double> * answers) const {
+
+    vector<double> & integrals = *answers;
+    const unsigned int numberOfIntegrals = _integrationBounds.size();
+    integrals.resize(numberOfIntegrals);
+
+    const vector<array<double, 2> > & integrationBounds = _integrationBounds;
+    const vector<unsigned int> & numbersOfIntervals = _numbersOfIntervals;
+    std::for_each(std::execution::par,
+                  Utilities::IndexIterator<unsigned int>(0),
+                  Utilities::IndexIterator<unsigned int>(numberOfIntegrals),
+                  [&] (const unsigned int integralIndex) {
+      const unsigned int numberOfIntervals =
+        numbersOfIntervals[integralIndex];
+      const double integrationBounds0 = integrationBounds[integralIndex][0];
+      const double dx =
+        (integrationBounds[integralIndex][1] - integrationBounds0) /
+        numberOfIntervals;
+      const double integral =
+        std::transform_reduce(
+          std::execution::par_unseq,
+          Utilities::IndexIterator<unsigned int>(0),
+          Utilities::IndexIterator<unsigned int>(numberOfIntervals),
+          0., std::plus<double>(),
+          [=] (const unsigned int intervalIndex) {
+            const double evaluationPoint =
+              integrationBounds0 + (double(intervalIndex) + 0.5) * dx;
+            return std::sin(evaluationPoint);
+          });
+      integrals[integralIndex] = integral * dx;
+    });
+  }
+
+  string
+  getName() const {
+    return string("stdpar batched");
+  }
+
+private:
+  const vector<array<double, 2> > & _integrationBounds;
+  const vector<unsigned int> & _numbersOfIntervals;
+};
+
+class StdParRombergTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  StdParRombergTestFunctor(const array<double, 2> & integrationBounds,
+                           const Utilities::LargeIndex
+                           numberOfCoarsestIntervals,
+                           const unsigned int numberOfLevels) :
+    _integrationBounds(integrationBounds),
+    _numberOfCoarsestIntervals(numberOfCoarsestIntervals),
+    _numberOfLevels(numberOfLevels) {
+    checkNumberOfRombergLevels(numberOfLevels);
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const Utilities::LargeIndex numberOfFinestIntervals =
+      computeNumberOfFinestRombergIntervals(_numberOfCoarsestIntervals,
+                                            _numberOfLevels);
+    const unsigned int numberOfLevels = _numberOfLevels;
+    const double integrationBounds0 = _integrationBounds[0];
+    const double finestDx =
+      (_integrationBounds[1] - integrationBounds0) / numberOfFinestIntervals;
+
+    // a whole set of level sums per point would be mostly zeros to add up,
+    //  so each iteration does a block of points
+    const Utilities::LargeIndex numberOfPoints = numberOfFinestIntervals + 1;
+    const Utilities::LargeIndex numberOfBlocks =
+      (numberOfPoints + RombergPointsPerBlock - 1) / RombergPointsPerBlock;
+    RombergLevelSums levelSums;
+    {
+      const Utilities::ScopedPhase phase("accumulate levels");
+      levelSums =
+        std::transform_reduce(
+          std::execution::par_unseq,
+          Utilities::IndexIterator<Utilities::LargeIndex>(0),
+          Utilities::IndexIterator<Utilities::LargeIndex>(numberOfBlocks),
+          RombergLevelSums(),
+          [] (RombergLevelSums x, const RombergLevelSums & y) {
+            x += y;
+            return x;
+          },
+          [=] (const Utilities::LargeIndex blockIndex) {
+            RombergLevelSums blockSums;
+            const Utilities::LargeIndex blockEnd =
+              std::min(numberOfPoints,
+                       (blockIndex + 1) * RombergPointsPerBlock);
+            for (Utilities::LargeIndex pointIndex =
+                   blockIndex * RombergPointsPerBlock;
+                 pointIndex < blockEnd; ++pointIndex) {
+              accumulateRombergPoint(integrationBounds0, finestDx,
+                                     numberOfFinestIntervals, numberOfLevels,
+                                     pointIndex, &blockSums);
+            }
+            return blockSums;
+          });
+    }
+
+    const Utilities::ScopedPhase phase("extrapolate");
+    *answer = extrapolateRomberg(levelSums, _integrationBounds,
+                                 _numberOfCoarsestIntervals, _numberOfLevels);
+  }
+
+  Utilities::LargeIndex
+  getNumberOfEvaluations() const {
+    return computeNumberOfFinestRombergIntervals(_numberOfCoarsestIntervals,
+                                                 _numberOfLevels) + 1;
+  }
+
+  string
+  getName() const {
+    return string("stdpar romberg");
+  }
+
+private:
+  const array<double, 2> _integrationBounds;
+  const Utilities::LargeIndex _numberOfCoarsestIntervals;
+  const unsigned int _numberOfLevels;
+};
+
+#endif // SCALARINTEGRATOR_STDPAR_H
@@ -0,0 +1,268 @@
+// -*- C++ -*-
+#ifndef SCALARINTEGRATOR_STEALING_H
+#define SCALARINTEGRATOR_STEALING_H
+
+#include "../Utilities.h"
+#include "ScalarIntegration_sequences.h"
+#include "ScalarIntegration_romberg.h"
+#include "../PhaseTimers.h"
+#include "../Tracer.h"
+#include "../WorkStealingPool.h"
+
+class StealingTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  StealingTestFunctor(const array<double, 2> & integrationBounds,
+                      const Utilities::LargeIndex numberOfIntervals) :
+    _integrationBounds(integrationBounds),
+    _numberOfIntervals(numberOfIntervals) {
+
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const Utilities::LargeIndex numberOfIntervals = _numberOfIntervals;
+    const double dx =
+      (_integrationBounds[1] - _integrationBounds[0]) / numberOfIntervals;
+    const double integrationBounds0 = _integrationBounds[0];
+
+    double totalIntegral =
+      Utilities::stealingParallelReduce(
+        Utilities::LargeIndex(0), numberOfIntervals,
+        Utilities::LargeIndex(1 << 16), 0.,
+        [&] (const Utilities::LargeIndex beginIndex,
+             const Utilities::LargeIndex endIndex,
+             double partialSum) {
+          for (Utilities::LargeIndex intervalIndex = beginIndex;
+               intervalIndex < endIndex; ++intervalIndex) {
+            const double evaluationPoint =
+              integrationBounds0 + (double(intervalIndex) + 0.5) * dx;
+            partialSum += std::sin(evaluationPoint);
+          }
+          return partialSum;
+        },
+        [] (const double x, const double y) {
+          return x + y;
+        });
+    totalIntegral *= dx;
+
+    *answer = totalIntegral;
+  }
+
+  string
+  getName() const {
+    return string("stealing");
+  }
+
+private:
+  const array<double, 2> _integrationBounds;
+  const Utilities::LargeIndex _numberOfIntervals;
+};
+
+template <class SequenceType>
+class StealingMonteCarloTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  StealingMonteCarloTestFunctor(const SequenceType & sequence,
+                                const SinProductIntegrand & integrand,
+                                const uint64_t numberOfSamples) :
+    _sequence(sequence),
+    _integrand(integrand),
+    _numberOfSamples(numberOfSamples) {
+    checkNumberOfSamples<SequenceType>(numberOfSamples);
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const uint64_t numberOfChunks = computeNumberOfChunks(_numberOfSamples);
+
+    const SequenceType & sequence = _sequence;
+    const SinProductIntegrand & integrand = _integrand;
+    const uint64_t numberOfSamples = _numberOfSamples;
+    // a chunk is already thousands of samples
+    double totalIntegral =
+      Utilities::stealingParallelReduce(
+        uint64_t(0), numberOfChunks, uint64_t(1), 0.,
+        [&] (const uint64_t beginIndex,
+             const uint64_t endIndex,
+             double partialSum) {
+          const Utilities::TraceSpan span("monte carlo chunks");
+          for (uint64_t chunkIndex = beginIndex;
+               chunkIndex < endIndex; ++chunkIndex) {
+            partialSum +=
+              sumIntegrandOverChunk(sequence, integrand, chunkIndex,
+                                    numberOfSamples);
+          }
+          return partialSum;
+        },
+        [] (const double x, const double y) {
+          return x + y;
+        });
+    totalIntegral *= _integrand.getVolume() / _numberOfSamples;
+
+    *answer = totalIntegral;
+  }
+
+  string
+  getName() const {
+    return string("stealing ") + SequenceType::getName();
+  }
+
+private:
+  const SequenceType _sequence;
+  const SinProductIntegrand _integrand;
+  const uint64_t _numberOfSamples;
+};
+
+// nested parallelism, like tbb's: a loop over the integrals, each of which
+//  reduces over its intervals.  the inner loops are just more tasks for
+//  the same workers, so an idle worker steals from a big integral as
+//  readily as it does a whole one.
+class StealingBatchedTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  StealingBatchedTestFunctor(const vector<array<double, 2> > &
+                             integrationBounds,
+                             const vector<unsigned int> & numbersOfIntervals) :
+    _integrationBounds(integrationBounds),
+    _numbersOfIntervals(numbersOfIntervals) {
+
+  }
+
+  void
+  computeAnswer(vector<double> * answers) const {
+
+    vector<double> & integrals = *answers;
+    const unsigned int numberOfIntegrals = _integrationBounds.size();
+    integrals.resize(numberOfIntegrals);
+
+    const vector<array<double, 2> > & integrationBounds = _integrationBounds;
+    const vector<unsigned int> & numbersOfIntervals = _numbersOfIntervals;
+    // one integral per task, whatever --grain-size says, which only sizes
+    //  the inner loops' pieces
+    Utilities::stealingParallelForWithGrainSize(
+      0u, numberOfIntegrals, 1u,
+      [&] (const unsigned int beginIndex,
+           const unsigned int endIndex) {
+      const Utilities::TraceSpan span("integrals");
+      for (unsigned int integralIndex = beginIndex;
+           integralIndex < endIndex; ++integralIndex) {
+        const unsigned int numberOfIntervals =
+          numbersOfIntervals[integralIndex];
+        const double integrationBounds0 = integrationBounds[integralIndex][0];
+        const double dx =
+          (integrationBounds[integralIndex][1] - integrationBounds0) /
+          numberOfIntervals;
+        const double integral =
+          Utilities::stealingParallelReduce(
+            0u, numberOfIntervals, 4096u, 0.,
+            [&] (const unsigned int beginIntervalIndex,
+                 const unsigned int endIntervalIndex,
+                 double partialSum) {
+              for (unsigned int intervalIndex = beginIntervalIndex;
+                   intervalIndex < endIntervalIndex; ++intervalIndex) {
+                const double evaluationPoint =
+                  integrationBounds0 + (double(intervalIndex) + 0.5) * dx;
+                partialSum += std::sin(evaluationPoint);
+              }
+              return partialSum;
+            },
+            [] (const double x, const double y) {
+              return x + y;
+            });
+        integrals[integralIndex] = integral * dx;
+      }
+    });
+  }
+
+  string
+  getName() const {
+    return string("stealing batched");
+  }
+
+private:
+  const vector<array<double, 2> > & _integrationBounds;
+  const vector<unsigned int> & _numbersOfIntervals;
+};
+
+class StealingRombergTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  StealingRombergTestFunctor(const array<double, 2> & integrationBounds,
+                             const Utilities::LargeIndex
+                             numberOfCoarsestIntervals,
+                             const unsigned int numberOfLevels) :
+    _integrationBounds(integrationBounds),
+    _numberOfCoarsestIntervals(numberOfCoarsestIntervals),
+    _numberOfLevels(numberOfLevels) {
+    checkNumberOfRombergLevels(numberOfLevels);
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const Utilities::LargeIndex numberOfFinestIntervals =
+      computeNumberOfFinestRombergIntervals(_numberOfCoarsestIntervals,
+                                            _numberOfLevels);
+    const unsigned int numberOfLevels = _numberOfLevels;
+    const double integrationBounds0 = _integrationBounds[0];
+    const double finestDx =
+      (_integrationBounds[1] - integrationBounds0) / numberOfFinestIntervals;
+
+    RombergLevelSums levelSums;
+    {
+      const Utilities::ScopedPhase phase("accumulate levels");
+      levelSums =
+        Utilities::stealingParallelReduce(
+          Utilities::LargeIndex(0), numberOfFinestIntervals + 1,
+          RombergPointsPerBlock, RombergLevelSums(),
+          [&] (const Utilities::LargeIndex beginIndex,
+               const Utilities::LargeIndex endIndex,
+               RombergLevelSums partialSums) {
+            for (Utilities::LargeIndex pointIndex = beginIndex;
+                 pointIndex < endIndex; ++pointIndex) {
+              accumulateRombergPoint(integrationBounds0, finestDx,
+                                     numberOfFinestIntervals, numberOfLevels,
+                                     pointIndex, &partialSums);
+            }
+            return partialSums;
+          },
+          [] (RombergLevelSums x, const RombergLevelSums & y) {
+            x += y;
+            return x;
+          });
+    }
+
+    const Utilities::ScopedPhase phase("extrapolate");
+    *answer = extrapolateRomberg(levelSums, _integrationBounds,
+                                 _numberOfCoarsestIntervals, _numberOfLevels);
+  }
+
+  Utilities::LargeIndex
+  getNumberOfEvaluations() const {
+    return computeNumberOfFinestRombergIntervals(_numberOfCoarsestIntervals,
+                                                 _numberOfLevels) + 1;
+  }
+
+  string
+  getName() const {
+    return string("stealing romberg");
+  }
+
+private:
+  const array<double, 2> _integrationBounds;
+  const Utilities::LargeIndex _numberOfCoarsestIntervals;
+  const unsigned int _numberOfLevels;
+};
+
+#endif // SCALARINTEGRATOR_STEALING_H
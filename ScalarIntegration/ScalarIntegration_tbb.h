@@ -3,6 +3,11 @@
 #define SCALARINTEGRATOR_TBB_H
 
 #include "../Utilities.h"
+#include "ScalarIntegration_sequences.h"
+#include "ScalarIntegration_romberg.h"
+#include "../PhaseTimers.h"
+#include "../Tracer.h"
+#include "../LoadBalance.h"
 
 // header files for tbb
 #include <tbb/blocked_range.h>
@@ -15,7 +20,7 @@ public:
   static const CpuOrGpuType ProcessorType = Cpu;
 
   TbbTestFunctor(const array<double, 2> & integrationBounds,
-                 const unsigned int numberOfIntervals) :
+                 const Utilities::LargeIndex numberOfIntervals) :
     _integrationBounds(integrationBounds),
     _numberOfIntervals(numberOfIntervals) {
 
@@ -24,7 +29,28 @@ public:
   void
   computeAnswer(double * answer) const {
 
-    double totalIntegral = 0;
+    const double dx =
+      (_integrationBounds[1] - _integrationBounds[0]) / _numberOfIntervals;
+    const double integrationBounds0 = _integrationBounds[0];
+
+    double totalIntegral =
+      Utilities::tbbParallelReduce(
+        Utilities::LargeIndex(0), _numberOfIntervals, 0.,
+        [&] (const tbb::blocked_range<Utilities::LargeIndex> & range,
+             double partialSum) {
+          const Utilities::BusyChunk chunk;
+          for (Utilities::LargeIndex intervalIndex = range.begin();
+               intervalIndex != range.end(); ++intervalIndex) {
+            const double evaluationPoint =
+              integrationBounds0 + (double(intervalIndex) + 0.5) * dx;
+            partialSum += std::sin(evaluationPoint);
+          }
+          return partialSum;
+        },
+        [] (const double x, const double y) {
+          return x + y;
+        });
+    totalIntegral *= dx;
 
     *answer = totalIntegral;
   }
@@ -36,7 +62,206 @@ public:
 
 private:
   const array<double, 2> _integrationBounds;
-  const unsigned int _numberOfIntervals;
+  const Utilities::LargeIndex _numberOfIntervals;
+};
+
+template <class SequenceType>
+class TbbMonteCarloTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  TbbMonteCarloTestFunctor(const SequenceType & sequence,
+                           const SinProductIntegrand & integrand,
+                           const uint64_t numberOfSamples) :
+    _sequence(sequence),
+    _integrand(integrand),
+    _numberOfSamples(numberOfSamples) {
+    checkNumberOfSamples<SequenceType>(numberOfSamples);
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const uint64_t numberOfChunks = computeNumberOfChunks(_numberOfSamples);
+
+    const SequenceType & sequence = _sequence;
+    const SinProductIntegrand & integrand = _integrand;
+    const uint64_t numberOfSamples = _numberOfSamples;
+    double totalIntegral =
+      Utilities::tbbParallelReduce(
+        uint64_t(0), numberOfChunks, 0.,
+        [&] (const tbb::blocked_range<uint64_t> & range,
+             double partialSum) {
+          const Utilities::TraceSpan span("monte carlo chunks");
+          const Utilities::BusyChunk chunk;
+          for (uint64_t chunkIndex = range.begin();
+               chunkIndex != range.end(); ++chunkIndex) {
+            partialSum +=
+              sumIntegrandOverChunk(sequence, integrand, chunkIndex,
+                                    numberOfSamples);
+          }
+          return partialSum;
+        },
+        [] (const double x, const double y) {
+          return x + y;
+        });
+    totalIntegral *= _integrand.getVolume() / _numberOfSamples;
+
+    *answer = totalIntegral;
+  }
+
+  string
+  getName() const {
+    return string("tbb ") + SequenceType::getName();
+  }
+
+private:
+  const SequenceType _sequence;
+  const SinProductIntegrand _integrand;
+  const uint64_t _numberOfSamples;
+};
+
+// nested parallelism: a parallel_for over the integrals, each of which does
+//  a parallel_reduce over its intervals.  tbb's scheduler balances the two
+//  levels for us, so a few big integrals don't starve the other threads.
+//  the inner loops run several at a time, so they keep tbb's defaults.
+class TbbBatchedTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  TbbBatchedTestFunctor(const vector<array<double, 2> > & integrationBounds,
+                        const vector<unsigned int> & numbersOfIntervals) :
+    _integrationBounds(integrationBounds),
+    _numbersOfIntervals(numbersOfIntervals) {
+
+  }
+
+  void
+  computeAnswer(vector<double> * answers) const {
+
+    vector<double> & integrals = *answers;
+    const unsigned int numberOfIntegrals = _integrationBounds.size();
+    integrals.resize(numberOfIntegrals);
+
+    const vector<array<double, 2> > & integrationBounds = _integrationBounds;
+    const vector<unsigned int> & numbersOfIntervals = _numbersOfIntervals;
+    Utilities::tbbParallelFor(
+      0u, numberOfIntegrals,
+      [&] (const tbb::blocked_range<unsigned int> & range) {
+      const Utilities::TraceSpan span("integrals");
+      const Utilities::BusyChunk chunk;
+      for (unsigned int integralIndex = range.begin();
+           integralIndex != range.end(); ++integralIndex) {
+        const unsigned int numberOfIntervals =
+          numbersOfIntervals[integralIndex];
+        const double integrationBounds0 = integrationBounds[integralIndex][0];
+        const double dx =
+          (integrationBounds[integralIndex][1] - integrationBounds0) /
+          numberOfIntervals;
+        const double integral =
+          tbb::parallel_reduce(
+            tbb::blocked_range<unsigned int>(0, numberOfIntervals),
+            0.,
+            [&] (const tbb::blocked_range<unsigned int> & intervals,
+                 double partialSum) {
+              const Utilities::BusyChunk chunk;
+              for (unsigned int intervalIndex = intervals.begin();
+                   intervalIndex != intervals.end(); ++intervalIndex) {
+                const double evaluationPoint =
+                  integrationBounds0 + (double(intervalIndex) + 0.5) * dx;
+                partialSum += std::sin(evaluationPoint);
+              }
+              return partialSum;
+            },
+            [] (const double x, const double y) {
+              return x + y;
+            });
+        integrals[integralIndex] = integral * dx;
+      }
+    });
+  }
+
+  string
+  getName() const {
+    return string("tbb batched");
+  }
+
+private:
+  const vector<array<double, 2> > & _integrationBounds;
+  const vector<unsigned int> & _numbersOfIntervals;
+};
+
+class TbbRombergTestFunctor {
+public:
+
+  static const CpuOrGpuType ProcessorType = Cpu;
+
+  TbbRombergTestFunctor(const array<double, 2> & integrationBounds,
+                        const Utilities::LargeIndex numberOfCoarsestIntervals,
+                        const unsigned int numberOfLevels) :
+    _integrationBounds(integrationBounds),
+    _numberOfCoarsestIntervals(numberOfCoarsestIntervals),
+    _numberOfLevels(numberOfLevels) {
+    checkNumberOfRombergLevels(numberOfLevels);
+  }
+
+  void
+  computeAnswer(double * answer) const {
+
+    const Utilities::LargeIndex numberOfFinestIntervals =
+      computeNumberOfFinestRombergIntervals(_numberOfCoarsestIntervals,
+                                            _numberOfLevels);
+    const unsigned int numberOfLevels = _numberOfLevels;
+    const double integrationBounds0 = _integrationBounds[0];
+    const double finestDx =
+      (_integrationBounds[1] - integrationBounds0) / numberOfFinestIntervals;
+
+    RombergLevelSums levelSums;
+    {
+      const Utilities::ScopedPhase phase("accumulate levels");
+      levelSums =
+        Utilities::tbbParallelReduce(
+          Utilities::LargeIndex(0), numberOfFinestIntervals + 1,
+          RombergLevelSums(),
+          [&] (const tbb::blocked_range<Utilities::LargeIndex> & range,
+               RombergLevelSums partialSums) {
+            const Utilities::BusyChunk chunk;
+            for (Utilities::LargeIndex pointIndex = range.begin();
+                 pointIndex != range.end(); ++pointIndex) {
+              accumulateRombergPoint(integrationBounds0, finestDx,
+                                     numberOfFinestIntervals, numberOfLevels,
+                                     pointIndex, &partialSums);
+            }
+            return partialSums;
+          },
+          [] (RombergLevelSums x, const RombergLevelSums & y) {
+            x += y;
+            return x;
+          });
+    }
+
+    const Utilities::ScopedPhase phase("extrapolate");
+    *answer = extrapolateRomberg(levelSums, _integrationBounds,
+                                 _numberOfCoarsestIntervals, _numberOfLevels);
+  }
+
+  Utilities::LargeIndex
+  getNumberOfEvaluations() const {
+    return computeNumberOfFinestRombergIntervals(_numberOfCoarsestIntervals,
+                                                 _numberOfLevels) + 1;
+  }
+
+  string
+  getName() const {
+    return string("tbb romberg");
+  }
+
+private:
+  const array<double, 2> _integrationBounds;
+  const Utilities::LargeIndex _numberOfCoarsestIntervals;
+  const unsigned int _numberOfLevels;
 };
 
 #endif // SCALARINTEGRATOR_TBB_H
@@ -0,0 +1,143 @@
+// -*- C++ -*-
+#ifndef SCALING_ANALYSIS_H
+#define SCALING_ANALYSIS_H
+
+// what a thread sweep says about a backend.  in strong scaling the problem
+//  stays the same size and the speedup is the serial time over the parallel
+//  time; in weak scaling the problem grows with the number of threads, and
+//  the speedup is scaled up by the growth, so that perfect scaling is a
+//  speedup of p either way.  from the speedup come the parallel efficiency,
+//  the knee past which more threads stop paying for themselves, and for
+//  strong scaling the karp-flatt serial fraction.
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Utilities.h"
+#include "Roofline.h"
+
+namespace Utilities {
+
+enum ScalingMode {StrongScaling, WeakScaling};
+
+inline
+string
+getScalingModeName(const ScalingMode scalingMode) {
+  return (scalingMode == StrongScaling) ? string("strong") : string("weak");
+}
+
+// a thread count is past the knee once each thread added to the one before
+//  it gains less than this much speedup
+const double ScalingKneeMarginalSpeedup = 0.5;
+
+struct ScalingPoint {
+  unsigned int _numberOfThreads;
+  LargeIndex _problemSize;
+  double _elapsedTime;
+  double _speedup;
+};
+
+inline
+double
+computeParallelEfficiency(const ScalingPoint & point) {
+  return point._speedup / point._numberOfThreads;
+}
+
+// the experimentally determined serial fraction, which stays flat when the
+//  trouble is serial work and climbs when it is parallel overhead.  it's
+//  amdahl's law run backwards, so it only means something for strong
+//  scaling, and it isn't defined for one thread.
+inline
+double
+computeKarpFlattSerialFraction(const ScalingPoint & point) {
+  if (point._numberOfThreads < 2) {
+    return NAN;
+  }
+  const double inverseThreads = 1. / point._numberOfThreads;
+  return (1. / point._speedup - inverseThreads) / (1. - inverseThreads);
+}
+
+// the last thread count before the marginal speedup first drops below the
+//  threshold, or the last one of all if it never does.  the points have to
+//  be in increasing order of threads.
+inline
+unsigned int
+findScalingKnee(const vector<ScalingPoint> & points) {
+  for (size_t pointIndex = 1; pointIndex < points.size(); ++pointIndex) {
+    const ScalingPoint & previous = points[pointIndex - 1];
+    const ScalingPoint & current = points[pointIndex];
+    if (current._numberOfThreads <= previous._numberOfThreads) {
+      continue;
+    }
+    const double marginalSpeedup =
+      (current._speedup - previous._speedup) /
+      (current._numberOfThreads - previous._numberOfThreads);
+    if (marginalSpeedup < ScalingKneeMarginalSpeedup) {
+      return previous._numberOfThreads;
+    }
+  }
+  return points.empty() ? 0 : points.back()._numberOfThreads;
+}
+
+// how many times more work the scaled problem is, by flops if there are any
+//  and by bytes if not.  if it has neither, we take the scaler's word for it.
+inline
+double
+computeWorkRatio(const WorkCounts & scaledWorkCounts,
+                 const WorkCounts & baseWorkCounts,
+                 const unsigned int workScaleFactor) {
+  if (baseWorkCounts._flops > 0) {
+    return scaledWorkCounts._flops / baseWorkCounts._flops;
+  }
+  if (baseWorkCounts._bytes > 0) {
+    return scaledWorkCounts._bytes / baseWorkCounts._bytes;
+  }
+  return workScaleFactor;
+}
+
+inline
+void
+printScalingSummary(const string & testName,
+                    const ScalingMode scalingMode,
+                    const vector<ScalingPoint> & points) {
+  if (points.empty()) {
+    return;
+  }
+  printf("%s %s scaling:\n", testName.c_str(),
+         getScalingModeName(scalingMode).c_str());
+  const bool showKarpFlatt = (scalingMode == StrongScaling);
+  printf("  %7s %12s %10s %8s %10s", "threads", "size", "time",
+         "speedup", "efficiency");
+  if (showKarpFlatt == true) {
+    printf(" %10s", "karp-flatt");
+  }
+  printf("\n");
+  for (const ScalingPoint & point : points) {
+    printf("  %7u %12lld %10.2e %8.2f %9.1f%%",
+           point._numberOfThreads,
+           (long long)point._problemSize,
+           point._elapsedTime,
+           point._speedup,
+           100. * computeParallelEfficiency(point));
+    if (showKarpFlatt == true && point._numberOfThreads < 2) {
+      printf(" %10s", "-");
+    } else if (showKarpFlatt == true) {
+      printf(" %10.3f", computeKarpFlattSerialFraction(point));
+    }
+    printf("\n");
+  }
+  const unsigned int kneeNumberOfThreads = findScalingKnee(points);
+  if (kneeNumberOfThreads < points.back()._numberOfThreads) {
+    printf("  knee at %u threads: past it, each thread added gains less "
+           "than %.1f in speedup\n",
+           kneeNumberOfThreads, ScalingKneeMarginalSpeedup);
+  } else {
+    printf("  no knee up to %u threads\n", kneeNumberOfThreads);
+  }
+}
+
+}
+
+#endif // SCALING_ANALYSIS_H
@@ -0,0 +1,156 @@
+// -*- C++ -*-
+#ifndef STANDARD_PARALLEL_H
+#define STANDARD_PARALLEL_H
+
+// what the exercises need to run on c++17's parallel algorithms, so that
+//  plain standard c++ can be timed next to tbb, omp and kokkos.  the
+//  algorithms take iterators and not index ranges, so the loops go over an
+//  IndexIterator, which counts instead of pointing at anything.
+//
+//   std::for_each(std::execution::par_unseq,
+//                 Utilities::IndexIterator<LargeIndex>(0),
+//                 Utilities::IndexIterator<LargeIndex>(numberOfElements),
+//                 [&] (const LargeIndex index) {
+//                   ...
+//                 });
+//
+//  the standard gives no way to say how many threads to use.  gcc's
+//  library runs the algorithms on tbb, so the driver sets the number of
+//  threads the same way that it does for tbb.  par_unseq lets the
+//  iterations interleave on one thread, so its bodies mustn't lock
+//  anything, which is why they don't mark their chunks for the load
+//  balance report.  a span can lock the tracer, so the few loops whose
+//  bodies are traced use par instead.
+
+#include <cstddef>
+#include <iterator>
+#include <execution>
+
+namespace Utilities {
+
+template <class Index>
+class IndexIterator {
+public:
+
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef Index value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef const Index * pointer;
+  typedef Index reference;
+
+  IndexIterator() :
+    _index(0) {
+  }
+
+  explicit
+  IndexIterator(const Index index) :
+    _index(index) {
+  }
+
+  Index
+  operator*() const {
+    return _index;
+  }
+
+  Index
+  operator[](const difference_type offset) const {
+    return _index + offset;
+  }
+
+  IndexIterator &
+  operator++() {
+    ++_index;
+    return *this;
+  }
+
+  IndexIterator
+  operator++(int) {
+    const IndexIterator previous = *this;
+    ++_index;
+    return previous;
+  }
+
+  IndexIterator &
+  operator--() {
+    --_index;
+    return *this;
+  }
+
+  IndexIterator
+  operator--(int) {
+    const IndexIterator previous = *this;
+    --_index;
+    return previous;
+  }
+
+  IndexIterator &
+  operator+=(const difference_type offset) {
+    _index += offset;
+    return *this;
+  }
+
+  IndexIterator &
+  operator-=(const difference_type offset) {
+    _index -= offset;
+    return *this;
+  }
+
+  IndexIterator
+  operator+(const difference_type offset) const {
+    return IndexIterator(_index + offset);
+  }
+
+  friend
+  IndexIterator
+  operator+(const difference_type offset,
+            const IndexIterator & iterator) {
+    return IndexIterator(iterator._index + offset);
+  }
+
+  IndexIterator
+  operator-(const difference_type offset) const {
+    return IndexIterator(_index - offset);
+  }
+
+  difference_type
+  operator-(const IndexIterator & other) const {
+    return difference_type(_index) - difference_type(other._index);
+  }
+
+  bool
+  operator==(const IndexIterator & other) const {
+    return _index == other._index;
+  }
+
+  bool
+  operator!=(const IndexIterator & other) const {
+    return _index != other._index;
+  }
+
+  bool
+  operator<(const IndexIterator & other) const {
+    return _index < other._index;
+  }
+
+  bool
+  operator>(const IndexIterator & other) const {
+    return _index > other._index;
+  }
+
+  bool
+  operator<=(const IndexIterator & other) const {
+    return _index <= other._index;
+  }
+
+  bool
+  operator>=(const IndexIterator & other) const {
+    return _index >= other._index;
+  }
+
+private:
+  Index _index;
+};
+
+}
+
+#endif // STANDARD_PARALLEL_H
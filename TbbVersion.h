@@ -0,0 +1,39 @@
+// -*- C++ -*-
+#ifndef TBB_VERSION_H
+#define TBB_VERSION_H
+
+// the parts of tbb that moved between the versions that the exercises
+//  build against, from the tbb 4.3 that the makefiles default to up to
+//  onetbb.  TBB_INTERFACE_VERSION is 8000 for 4.3, 9000 for 4.4, 9100 for
+//  2017 and 11000 for 2019.
+
+// onetbb took out the header that had tbb's version
+#if __has_include(<tbb/version.h>)
+#include <tbb/version.h>
+#else
+#include <tbb/tbb_stddef.h>
+#endif
+
+#include <tbb/task_arena.h>
+
+namespace Utilities {
+
+// the calling thread's slot in its tbb arena, which is 0 for the thread
+//  that made the arena and below the number of threads that tbb was
+//  initialized with, or negative for a thread that isn't in one.  tbb 2017
+//  moved it to this_task_arena, and 4.4 renamed 4.3's current_slot.
+inline
+int
+getTbbThreadIndex() {
+#if TBB_INTERFACE_VERSION >= 9100
+  return tbb::this_task_arena::current_thread_index();
+#elif TBB_INTERFACE_VERSION >= 9000
+  return tbb::task_arena::current_thread_index();
+#else
+  return tbb::task_arena::current_slot();
+#endif
+}
+
+}
+
+#endif // TBB_VERSION_H
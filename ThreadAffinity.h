@@ -0,0 +1,387 @@
+// -*- C++ -*-
+#ifndef THREAD_AFFINITY_H
+#define THREAD_AFFINITY_H
+
+// where the threads of each backend run.  one policy, picked on the command
+//  line, is turned into a list of hardware threads from hwloc's view of the
+//  machine, and thread i of whichever backend is running is pinned to entry
+//  i of that list.  omp threads pin themselves in a parallel region, which
+//  also covers kokkos's openmp backend because it runs on the same pool,
+//  and tbb's workers pin themselves through a task_scheduler_observer as
+//  they join.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+
+#include <hwloc.h>
+
+// header files for pinning tbb's workers as they start
+#include <tbb/task_scheduler_observer.h>
+
+#include "TbbVersion.h"
+
+// header files for omp
+#include <omp.h>
+
+namespace Utilities {
+
+// compact: fill up each core's hardware threads, then the next core.
+//  scatter: round-robin over the packages, then over their cores, and only
+//  then over the hyperthreads.  one-per-core: every core's first hardware
+//  thread, in order, before any core gets a second.  cpuset: the hardware
+//  threads listed on the command line, in that order.
+enum AffinityPolicy {NoAffinity,
+                     CompactAffinity,
+                     ScatterAffinity,
+                     OnePerCoreAffinity,
+                     CpusetAffinity};
+
+inline
+string
+getAffinityPolicyName(const AffinityPolicy policy) {
+  const char * const policyNames[] =
+    {"none", "compact", "scatter", "one-per-core", "cpuset"};
+  return string(policyNames[policy]);
+}
+
+// one os cpu number of a cpu list, which has to be all digits
+inline
+int
+parseCpuNumber(const string & text, const string & list) {
+  char * end = NULL;
+  errno = 0;
+  const long cpu = strtol(text.c_str(), &end, 10);
+  if (text.empty() == true || isdigit((unsigned char)text[0]) == 0 ||
+      *end != '\0' || errno == ERANGE ||
+      cpu > std::numeric_limits<int>::max()) {
+    fprintf(stderr, "invalid cpu list %s\n", list.c_str());
+    exit(1);
+  }
+  return cpu;
+}
+
+// a list of os cpu numbers like "0-3,8,10-11"
+inline
+vector<int>
+parseCpuList(const string & list) {
+  vector<int> cpus;
+  std::istringstream listStream(list);
+  string item;
+  while (std::getline(listStream, item, ',')) {
+    const size_t dashPosition = item.find('-');
+    const int firstCpu = parseCpuNumber(item.substr(0, dashPosition), list);
+    const int lastCpu = (dashPosition == string::npos) ? firstCpu :
+      parseCpuNumber(item.substr(dashPosition + 1), list);
+    if (lastCpu < firstCpu) {
+      fprintf(stderr, "invalid cpu list %s\n", list.c_str());
+      exit(1);
+    }
+    for (int cpu = firstCpu; cpu <= lastCpu; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  if (cpus.empty() == true) {
+    fprintf(stderr, "invalid cpu list %s\n", list.c_str());
+    exit(1);
+  }
+  return cpus;
+}
+
+// the other way around, with runs collapsed into ranges
+inline
+string
+formatCpuList(const vector<int> & cpus) {
+  std::ostringstream list;
+  for (size_t index = 0; index < cpus.size(); ) {
+    size_t runEnd = index + 1;
+    while (runEnd < cpus.size() && cpus[runEnd] == cpus[runEnd - 1] + 1) {
+      ++runEnd;
+    }
+    list << ((index == 0) ? "" : ",") << cpus[index];
+    if (runEnd - index > 1) {
+      list << "-" << cpus[runEnd - 1];
+    }
+    index = runEnd;
+  }
+  return list.str();
+}
+
+class HardwareTopology {
+public:
+
+  // the topology is loaded once, on first use
+  static
+  HardwareTopology &
+  getInstance() {
+    static HardwareTopology hardwareTopology;
+    return hardwareTopology;
+  }
+
+  ~HardwareTopology() {
+    hwloc_topology_destroy(_topology);
+  }
+
+  string
+  getDescription() const {
+    std::ostringstream description;
+    description << countObjects(HWLOC_OBJ_PACKAGE) << " packages, "
+                << countObjects(HWLOC_OBJ_NUMANODE) << " numa nodes, "
+                << countObjects(HWLOC_OBJ_CORE) << " cores, "
+                << _processingUnits.size() << " hardware threads";
+    return description.str();
+  }
+
+  // the os cpu numbers of the hardware threads, in the order that the policy
+  //  hands them out.  there's one entry per hardware thread, except for
+  //  cpuset, which has whatever was asked for.
+  vector<int>
+  getCpuOrder(const AffinityPolicy policy,
+              const vector<int> & explicitCpus) const {
+    if (policy == CpusetAffinity) {
+      return explicitCpus;
+    }
+    vector<ProcessingUnit> processingUnits = _processingUnits;
+    if (policy == ScatterAffinity) {
+      std::stable_sort(processingUnits.begin(), processingUnits.end(),
+                       [] (const ProcessingUnit & a,
+                           const ProcessingUnit & b) {
+                         if (a._threadInCore != b._threadInCore) {
+                           return a._threadInCore < b._threadInCore;
+                         }
+                         if (a._coreInPackage != b._coreInPackage) {
+                           return a._coreInPackage < b._coreInPackage;
+                         }
+                         return a._package < b._package;
+                       });
+    } else if (policy == OnePerCoreAffinity) {
+      std::stable_sort(processingUnits.begin(), processingUnits.end(),
+                       [] (const ProcessingUnit & a,
+                           const ProcessingUnit & b) {
+                         return a._threadInCore < b._threadInCore;
+                       });
+    }
+    vector<int> cpus;
+    for (const ProcessingUnit & processingUnit : processingUnits) {
+      cpus.push_back(processingUnit._osIndex);
+    }
+    return cpus;
+  }
+
+  void
+  pinCurrentThread(const int cpu) const {
+    hwloc_bitmap_t cpuSet = hwloc_bitmap_alloc();
+    hwloc_bitmap_only(cpuSet, cpu);
+    const int status =
+      hwloc_set_cpubind(_topology, cpuSet, HWLOC_CPUBIND_THREAD);
+    hwloc_bitmap_free(cpuSet);
+    if (status != 0) {
+      fprintf(stderr, "cannot pin a thread to cpu %d\n", cpu);
+      exit(1);
+    }
+  }
+
+  // the cpus that the calling thread may run on, or false if hwloc can't
+  //  tell
+  bool
+  getCurrentThreadCpus(hwloc_bitmap_t cpuSet) const {
+    return hwloc_get_cpubind(_topology, cpuSet, HWLOC_CPUBIND_THREAD) == 0;
+  }
+
+  void
+  setCurrentThreadCpus(hwloc_const_bitmap_t cpuSet) const {
+    if (hwloc_set_cpubind(_topology, cpuSet, HWLOC_CPUBIND_THREAD) != 0) {
+      fprintf(stderr, "cannot put a thread back on its cpus\n");
+      exit(1);
+    }
+  }
+
+private:
+
+  struct ProcessingUnit {
+    int _osIndex;
+    unsigned int _package;
+    unsigned int _coreInPackage;
+    unsigned int _threadInCore;
+  };
+
+  HardwareTopology() {
+    hwloc_topology_init(&_topology);
+    hwloc_topology_load(_topology);
+
+    // hwloc's logical order is already compact
+    const unsigned int numberOfProcessingUnits =
+      hwloc_get_nbobjs_by_type(_topology, HWLOC_OBJ_PU);
+    vector<unsigned int> numberOfCoresSeenInPackage;
+    int previousCoreIndex = -1;
+    unsigned int threadInCore = 0;
+    for (unsigned int puIndex = 0; puIndex < numberOfProcessingUnits;
+         ++puIndex) {
+      const hwloc_obj_t pu =
+        hwloc_get_obj_by_type(_topology, HWLOC_OBJ_PU, puIndex);
+      const hwloc_obj_t core =
+        hwloc_get_ancestor_obj_by_type(_topology, HWLOC_OBJ_CORE, pu);
+      const hwloc_obj_t package =
+        hwloc_get_ancestor_obj_by_type(_topology, HWLOC_OBJ_PACKAGE, pu);
+      ProcessingUnit processingUnit;
+      processingUnit._osIndex = pu->os_index;
+      processingUnit._package = (package == NULL) ? 0 : package->logical_index;
+      if (numberOfCoresSeenInPackage.size() <= processingUnit._package) {
+        numberOfCoresSeenInPackage.resize(processingUnit._package + 1, 0);
+      }
+      // machines that hwloc can't see cores on get one core per thread
+      const int coreIndex = (core == NULL) ? -2 - int(puIndex) :
+        int(core->logical_index);
+      if (coreIndex != previousCoreIndex) {
+        ++numberOfCoresSeenInPackage[processingUnit._package];
+        threadInCore = 0;
+      }
+      processingUnit._coreInPackage =
+        numberOfCoresSeenInPackage[processingUnit._package] - 1;
+      processingUnit._threadInCore = threadInCore++;
+      previousCoreIndex = coreIndex;
+      _processingUnits.push_back(processingUnit);
+    }
+  }
+
+  HardwareTopology(const HardwareTopology &);
+  HardwareTopology & operator=(const HardwareTopology &);
+
+  unsigned int
+  countObjects(const hwloc_obj_type_t type) const {
+    return std::max(1, hwloc_get_nbobjs_by_type(_topology, type));
+  }
+
+  hwloc_topology_t _topology;
+  vector<ProcessingUnit> _processingUnits;
+};
+
+struct AffinityOptions {
+
+  AffinityOptions() :
+    _policy(NoAffinity) {
+  }
+
+  AffinityPolicy _policy;
+  // for cpuset
+  vector<int> _cpus;
+};
+
+// where each of numberOfThreads threads goes, wrapping around if there are
+//  more threads than cpus.  empty if nothing gets pinned.
+inline
+vector<int>
+computePlacement(const AffinityOptions & options,
+                 const unsigned int numberOfThreads) {
+  vector<int> placement;
+  if (options._policy == NoAffinity) {
+    return placement;
+  }
+  const vector<int> cpuOrder =
+    HardwareTopology::getInstance().getCpuOrder(options._policy,
+                                                options._cpus);
+  for (unsigned int threadIndex = 0; threadIndex < numberOfThreads;
+       ++threadIndex) {
+    placement.push_back(cpuOrder[threadIndex % cpuOrder.size()]);
+  }
+  return placement;
+}
+
+inline
+string
+describePlacement(const AffinityOptions & options,
+                  const vector<int> & placement) {
+  if (placement.empty() == true) {
+    return string("unpinned");
+  }
+  return getAffinityPolicyName(options._policy) + string(" on cpus ") +
+    formatCpuList(placement);
+}
+
+// pins the first placement.size() threads of omp's pool, which includes
+//  the calling thread as thread 0.
+inline
+void
+applyOmpPlacement(const vector<int> & placement) {
+  if (placement.empty() == true) {
+    return;
+  }
+  const HardwareTopology & topology = HardwareTopology::getInstance();
+#pragma omp parallel num_threads(placement.size())
+  {
+    topology.pinCurrentThread(placement[omp_get_thread_num()]);
+  }
+}
+
+// puts the thread that made it back on the cpus that it had then, when it
+//  goes away.  it's for the placements that pin the calling thread along
+//  with their workers, since the calling thread outlives them.
+class SavedThreadCpus {
+public:
+
+  SavedThreadCpus() :
+    _cpuSet(hwloc_bitmap_alloc()),
+    _isSaved(HardwareTopology::getInstance().getCurrentThreadCpus(_cpuSet)) {
+  }
+
+  ~SavedThreadCpus() {
+    if (_isSaved == true) {
+      HardwareTopology::getInstance().setCurrentThreadCpus(_cpuSet);
+    }
+    hwloc_bitmap_free(_cpuSet);
+  }
+
+private:
+  SavedThreadCpus(const SavedThreadCpus &);
+  SavedThreadCpus & operator=(const SavedThreadCpus &);
+
+  const hwloc_bitmap_t _cpuSet;
+  const bool _isSaved;
+};
+
+// pins tbb's threads as they join the scheduler while it's alive.  each
+//  thread gets the placement of its slot in the arena, which is 0 for the
+//  thread that made the scheduler, so a worker that leaves and joins again
+//  goes back to the same cpu.  the thread that made it gets its own cpus
+//  back when it's destroyed, which it has to be on that thread.
+class TbbPlacementObserver : public tbb::task_scheduler_observer {
+public:
+
+  TbbPlacementObserver(const vector<int> & placement) :
+    _placement(placement) {
+    if (_placement.empty() == false) {
+      observe(true);
+    }
+  }
+
+  ~TbbPlacementObserver() {
+    if (_placement.empty() == false) {
+      observe(false);
+    }
+  }
+
+  virtual
+  void
+  on_scheduler_entry(bool) {
+    const int slot = getTbbThreadIndex();
+    if (slot >= 0) {
+      HardwareTopology::getInstance().pinCurrentThread(
+        _placement[slot % _placement.size()]);
+    }
+  }
+
+private:
+  // destroyed after the observer stops observing
+  const SavedThreadCpus _creatorCpus;
+  const vector<int> _placement;
+};
+
+}
+
+#endif // THREAD_AFFINITY_H
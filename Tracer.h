@@ -0,0 +1,246 @@
+// -*- C++ -*-
+#ifndef TRACER_H
+#define TRACER_H
+
+// a timeline of what every thread was doing, for the things that an
+//  average over a whole repeat hides, like threads sitting idle while one
+//  straggler finishes.  code marks spans of its work with a TraceSpan, and
+//  each thread appends the begin and end events to a ring buffer of its
+//  own, so that tracing takes no locks once a thread has its buffer.  when
+//  the process exits, every buffer is written out in chrome's trace event
+//  format, which chrome://tracing and perfetto open.  that's from an atexit
+//  handler, so that a run that stops on a wrong answer still leaves the
+//  trace of what led up to it.
+//
+//   const Utilities::TraceSpan span("chunk");
+//
+//  the name has to outlive the run, so it's a string literal or comes from
+//  internName.  when tracing is off, a span costs a check of one flag.
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <chrono>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace Utilities {
+
+// events per thread.  a thread that makes more than this keeps the most
+//  recent ones.
+const size_t TraceBufferCapacity = 1 << 16;
+
+// for the strings in the json that the tracer and the results write
+inline
+string
+escapeJsonString(const string & input) {
+  string output;
+  for (const char character : input) {
+    if (character == '"' || character == '\\') {
+      output += '\\';
+      output += character;
+    } else if ((unsigned char)character < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x",
+               (unsigned int)(unsigned char)character);
+      output += escaped;
+    } else {
+      output += character;
+    }
+  }
+  return output;
+}
+
+struct TraceEvent {
+  const char * _name;
+  // nanoseconds since the tracer was enabled
+  int64_t _time;
+  // 'B' for begin or 'E' for end
+  char _type;
+};
+
+struct ThreadTraceBuffer {
+
+  ThreadTraceBuffer(const long threadId) :
+    _threadId(threadId),
+    _events(TraceBufferCapacity),
+    _numberOfEvents(0) {
+  }
+
+  const long _threadId;
+  vector<TraceEvent> _events;
+  // including the ones that have been overwritten
+  uint64_t _numberOfEvents;
+};
+
+class Tracer {
+public:
+
+  static
+  Tracer &
+  getInstance() {
+    static Tracer tracer;
+    return tracer;
+  }
+
+  // traces from now on, and writes the trace to the file at exit
+  void
+  enable(const string & fileName,
+         const string & processName) {
+    _fileName = fileName;
+    _processName = processName;
+    _startTime = std::chrono::steady_clock::now();
+    if (_enabled == false) {
+      atexit(writeAtExit);
+    }
+    _enabled = true;
+  }
+
+  bool
+  isEnabled() const {
+    return _enabled;
+  }
+
+  // a copy of the name that lasts as long as the tracer does
+  const char *
+  internName(const string & name) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _names.insert(name).first->c_str();
+  }
+
+  void
+  append(const char * const name,
+         const char type) {
+    // each thread's buffer belongs to the tracer, so that it outlives the
+    //  thread, like the workers of a tbb scheduler that's been torn down
+    static thread_local ThreadTraceBuffer * buffer = nullptr;
+    if (buffer == nullptr) {
+      buffer = addThreadBuffer();
+    }
+    TraceEvent & event =
+      buffer->_events[buffer->_numberOfEvents % TraceBufferCapacity];
+    event._name = name;
+    event._time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - _startTime).count();
+    event._type = type;
+    ++buffer->_numberOfEvents;
+  }
+
+private:
+
+  Tracer() :
+    _enabled(false) {
+  }
+
+  Tracer(const Tracer &);
+  Tracer & operator=(const Tracer &);
+
+  // the tracer was made before this was registered, so it's still there
+  static
+  void
+  writeAtExit() {
+    getInstance().write(getInstance()._fileName,
+                        getInstance()._processName);
+  }
+
+  // this runs at exit, so it can't exit itself
+  void
+  write(const string & fileName,
+        const string & processName) const {
+    FILE * file = fopen(fileName.c_str(), "w");
+    if (file == NULL) {
+      fprintf(stderr, "cannot open %s for writing the trace\n",
+              fileName.c_str());
+      return;
+    }
+    const long processId = getpid();
+    fprintf(file, "{\"traceEvents\": [\n");
+    fprintf(file, "  {\"name\": \"process_name\", \"ph\": \"M\", "
+            "\"pid\": %ld, \"args\": {\"name\": \"%s\"}}",
+            processId, escapeJsonString(processName).c_str());
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint64_t numberOfDroppedEvents = 0;
+    for (const std::unique_ptr<ThreadTraceBuffer> & buffer : _buffers) {
+      const uint64_t numberOfEvents = buffer->_numberOfEvents;
+      const uint64_t firstEventIndex =
+        (numberOfEvents > TraceBufferCapacity) ?
+        numberOfEvents - TraceBufferCapacity : 0;
+      numberOfDroppedEvents += firstEventIndex;
+      // a buffer that has wrapped around can start with the ends of spans
+      //  whose beginnings were overwritten, which are left out
+      int depth = 0;
+      for (uint64_t eventIndex = firstEventIndex;
+           eventIndex < numberOfEvents; ++eventIndex) {
+        const TraceEvent & event =
+          buffer->_events[eventIndex % TraceBufferCapacity];
+        if (event._type == 'E' && depth == 0) {
+          continue;
+        }
+        depth += (event._type == 'B') ? 1 : -1;
+        fprintf(file, ",\n  {\"name\": \"%s\", \"ph\": \"%c\", "
+                "\"ts\": %.3f, \"pid\": %ld, \"tid\": %ld}",
+                escapeJsonString(event._name).c_str(), event._type,
+                event._time / 1e3,
+                processId, buffer->_threadId);
+      }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    printf("wrote the trace of %zu threads to %s",
+           _buffers.size(), fileName.c_str());
+    if (numberOfDroppedEvents > 0) {
+      printf(", without the oldest %llu events",
+             (unsigned long long)numberOfDroppedEvents);
+    }
+    printf("\n");
+  }
+
+  ThreadTraceBuffer *
+  addThreadBuffer() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _buffers.push_back(std::unique_ptr<ThreadTraceBuffer>(
+                         new ThreadTraceBuffer(syscall(SYS_gettid))));
+    return _buffers.back().get();
+  }
+
+  bool _enabled;
+  string _fileName;
+  string _processName;
+  std::chrono::steady_clock::time_point _startTime;
+  mutable std::mutex _mutex;
+  std::set<string> _names;
+  vector<std::unique_ptr<ThreadTraceBuffer> > _buffers;
+};
+
+class TraceSpan {
+public:
+
+  TraceSpan(const char * const name) :
+    _name(Tracer::getInstance().isEnabled() ? name : nullptr) {
+    if (_name != nullptr) {
+      Tracer::getInstance().append(_name, 'B');
+    }
+  }
+
+  ~TraceSpan() {
+    if (_name != nullptr) {
+      Tracer::getInstance().append(_name, 'E');
+    }
+  }
+
+private:
+  TraceSpan(const TraceSpan &);
+  TraceSpan & operator=(const TraceSpan &);
+
+  const char * const _name;
+};
+
+}
+
+#endif // TRACER_H
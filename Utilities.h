@@ -2,11 +2,42 @@
 #ifndef UTILITIES_H
 #define UTILITIES_H
 
+// CPU_ONLY (make CPU_ONLY=1) builds without cuda, with the host compiler and
+//  against a kokkos that was built without it.
+#ifndef CPU_ONLY
 #include <cuda_runtime.h>
+#endif
+
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
 
 // header files for kokkos types
 #include <Kokkos_Core.hpp>
 
+// which of kokkos's optional host execution spaces this kokkos was built
+//  with, under either version's name for it
+#if defined(KOKKOS_HAVE_SERIAL) || defined(KOKKOS_ENABLE_SERIAL)
+#define HAVE_KOKKOS_SERIAL
+#endif
+#if defined(KOKKOS_HAVE_PTHREAD) || defined(KOKKOS_ENABLE_THREADS)
+#define HAVE_KOKKOS_THREADS
+#endif
+
+// c++17's parallel algorithms, which are only there when the build is c++17
+//  (make STDPAR=1) and the standard library has them
+#if __cplusplus >= 201703L
+#include <execution>
+#endif
+#if defined(__cpp_lib_execution)
+#define HAVE_STDPAR
+#endif
+
+#include "CacheFlusher.h"
+
 // this silly thing is to avoid unused variable warnings from the compiler
 // with -Wall on.
 // here we disable compiler warnings...because that's the whole idea.
@@ -17,6 +48,7 @@ void ignoreUnusedVariables(T & t) {
 }
 #pragma GCC diagnostic pop
 
+#ifndef CPU_ONLY
 // stolen from http://stackoverflow.com/questions/14038589/what-is-the-canonical-way-to-check-for-errors-using-the-cuda-runtime-api
 #define checkCudaError(ans) { gpuAssert((ans), __FILE__, __LINE__); }
 inline
@@ -29,21 +61,108 @@ gpuAssert(const cudaError_t code, const char *file, const int line, bool abort=t
     }
   }
 }
+#endif
 
 enum CpuOrGpuType {Cpu, Gpu};
 
 namespace Utilities {
 
+// problem sizes can go past 2^32, so index spaces are 64 bits wide.  it's
+//  signed because that's what openmp loops and kokkos policies prefer.
+typedef int64_t LargeIndex;
+
+// a vector's allocator that leaves new entries default-initialized, which
+//  for plain numbers means not written at all, where resize would otherwise
+//  zero them.  it's for the inputs, which get every entry overwritten by
+//  the generator or the dataset cache right after they're sized.
+template <class T>
+class DefaultInitAllocator : public std::allocator<T> {
+public:
+
+  template <class U>
+  struct rebind {
+    typedef DefaultInitAllocator<U> other;
+  };
+
+  DefaultInitAllocator() {
+  }
+
+  template <class U>
+  DefaultInitAllocator(const DefaultInitAllocator<U> &) {
+  }
+
+  template <class U>
+  void
+  construct(U * const pointer) {
+    ::new((void *)pointer) U;
+  }
+
+  template <class U, class... Arguments>
+  void
+  construct(U * const pointer, Arguments &&... arguments) {
+    ::new((void *)pointer) U(std::forward<Arguments>(arguments)...);
+  }
+};
+
+template <class T>
+using InputVector = std::vector<T, DefaultInitAllocator<T> >;
+
+template <class DeviceType>
+struct LargeRangePolicy {
+  typedef Kokkos::RangePolicy<DeviceType,
+                              Kokkos::IndexType<LargeIndex> > type;
+
+  // [beginIndex, endIndex) handed out in chunks of chunkSize iterations.  a
+  //  chunk size of 0 leaves kokkos to pick its own.
+  static
+  type
+  create(const LargeIndex beginIndex,
+         const LargeIndex endIndex,
+         const unsigned int chunkSize) {
+    if (chunkSize == 0) {
+      return type(beginIndex, endIndex);
+    }
+    return type(beginIndex, endIndex, Kokkos::ChunkSize(chunkSize));
+  }
+};
+
+// the largest chunk that still fits in a 32-bit loop counter
+const LargeIndex MaximumChunkSize = LargeIndex(1) << 30;
+
+// walk a 64-bit index space in chunks, so that the inner loop can count with
+//  a 32-bit unsigned int.  unsigned arithmetic is allowed to wrap, so the
+//  compiler can't assume that it doesn't; what keeps the counter from
+//  wrapping is that no chunk is bigger than MaximumChunkSize.  the chunk
+//  functor is called with the first index of the chunk and the size of the
+//  chunk.
+template <class ChunkFunctor>
+inline
+void
+forEachChunk(const LargeIndex beginIndex,
+             const LargeIndex endIndex,
+             const ChunkFunctor & chunkFunctor) {
+  for (LargeIndex chunkBeginIndex = beginIndex;
+       chunkBeginIndex < endIndex; chunkBeginIndex += MaximumChunkSize) {
+    const unsigned int chunkSize =
+      std::min(MaximumChunkSize, endIndex - chunkBeginIndex);
+    chunkFunctor(chunkBeginIndex, chunkSize);
+  }
+}
+
+#ifndef CPU_ONLY
 __global__
 void
 countThreads_kernel(unsigned int * totalCount) {
   atomicAdd(totalCount, 1);
 }
+#endif
 
 void
-resetProcessorForTiming(const CpuOrGpuType processorType) {
+resetProcessorForTiming(const CpuOrGpuType processorType,
+                        const CacheState cacheState = ColdCache) {
 
   if (processorType == Gpu) {
+#ifndef CPU_ONLY
     // allocate somewhere for the threads to count
     unsigned int *dev_junkDataCounter;
     checkCudaError(cudaMalloc((void **) &dev_junkDataCounter,
@@ -65,11 +184,9 @@ resetProcessorForTiming(const CpuOrGpuType processorType) {
 
     // clean up
     checkCudaError(cudaFree(dev_junkDataCounter));
-  } else {
-    volatile double junkSum = 0;
-    const size_t sizeOfJunk = 1e7;
-    vector<double> junk(sizeOfJunk, 1);
-    std::accumulate(junk.begin(), junk.end(), junkSum);
+#endif
+  } else if (cacheState == ColdCache) {
+    CacheFlusher::getInstance().flush();
   }
 }
 
@@ -82,10 +199,26 @@ struct KokkosProcessorTypeConverter<Kokkos::OpenMP> {
   static const CpuOrGpuType ProcessorType = Cpu;
 };
 
+#ifdef HAVE_KOKKOS_SERIAL
+template <>
+struct KokkosProcessorTypeConverter<Kokkos::Serial> {
+  static const CpuOrGpuType ProcessorType = Cpu;
+};
+#endif
+
+#ifdef HAVE_KOKKOS_THREADS
+template <>
+struct KokkosProcessorTypeConverter<Kokkos::Threads> {
+  static const CpuOrGpuType ProcessorType = Cpu;
+};
+#endif
+
+#ifndef CPU_ONLY
 template <>
 struct KokkosProcessorTypeConverter<Kokkos::Cuda> {
   static const CpuOrGpuType ProcessorType = Gpu;
 };
+#endif
 
 template <class DeviceType>
 struct KokkosDeviceNameConverter {
@@ -100,6 +233,29 @@ struct KokkosDeviceNameConverter<Kokkos::OpenMP> {
   }
 };
 
+#ifdef HAVE_KOKKOS_SERIAL
+template <>
+struct KokkosDeviceNameConverter<Kokkos::Serial> {
+  static
+  string
+  getName() {
+    return string("Serial");
+  }
+};
+#endif
+
+#ifdef HAVE_KOKKOS_THREADS
+template <>
+struct KokkosDeviceNameConverter<Kokkos::Threads> {
+  static
+  string
+  getName() {
+    return string("Threads");
+  }
+};
+#endif
+
+#ifndef CPU_ONLY
 template <>
 struct KokkosDeviceNameConverter<Kokkos::Cuda> {
   static
@@ -108,6 +264,7 @@ struct KokkosDeviceNameConverter<Kokkos::Cuda> {
     return string("Cuda");
   }
 };
+#endif
 
 }
 
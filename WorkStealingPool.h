@@ -0,0 +1,644 @@
+// -*- C++ -*-
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+// a small work-stealing thread pool, so that the exercises can be timed on
+//  a runtime that has nothing in it but splitting, spawning and stealing,
+//  and compared against what tbb and omp cost.  every worker has a
+//  chase-lev deque: it pushes and pops tasks at the bottom of its own, and
+//  idle workers steal from the top of someone else's.
+//
+//   Utilities::stealingParallelFor(LargeIndex(0), numberOfElements, 4096,
+//     [&] (const LargeIndex beginIndex, const LargeIndex endIndex) {
+//       ...
+//     });
+//
+//  the loops split their range in half until it's no bigger than the grain
+//  size, spawning the right half and running the left, so they split the
+//  same way on any number of threads and the reductions come out bit for
+//  bit the same.  the thread that starts a loop works on it as worker 0,
+//  and a loop started from inside another one is just more tasks for the
+//  same workers.  the pool counts how many tasks it spawns and how many of
+//  them get stolen, which the harness reports per repeat.
+//
+//  the deque follows le, pop, cohen and zappa nardelli, "correct and
+//  efficient work-stealing for weak memory models" (ppopp 2013).
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ThreadAffinity.h"
+#include "LoadBalance.h"
+
+namespace Utilities {
+
+struct WorkStealingTask {
+
+  WorkStealingTask(void (*execute)(WorkStealingTask *)) :
+    _execute(execute),
+    _done(false) {
+  }
+
+  void (*_execute)(WorkStealingTask *);
+  std::atomic<bool> _done;
+};
+
+class WorkStealingDeque {
+public:
+
+  WorkStealingDeque() :
+    _top(0),
+    _bottom(0),
+    _array(new TaskArray(InitialCapacity)) {
+    _arrays.push_back(std::unique_ptr<TaskArray>(_array.load()));
+  }
+
+  // owner only
+  void
+  push(WorkStealingTask * const task) {
+    const int64_t bottom = _bottom.load(std::memory_order_relaxed);
+    const int64_t top = _top.load(std::memory_order_acquire);
+    TaskArray * array = _array.load(std::memory_order_relaxed);
+    if (bottom - top > int64_t(array->_capacity) - 1) {
+      array = grow(array, top, bottom);
+    }
+    array->put(bottom, task);
+    std::atomic_thread_fence(std::memory_order_release);
+    _bottom.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  // owner only.  the most recently pushed task, or null if there's nothing
+  //  left or a thief got the last one.
+  WorkStealingTask *
+  pop() {
+    const int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    TaskArray * const array = _array.load(std::memory_order_relaxed);
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = _top.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    WorkStealingTask * task = array->get(bottom);
+    if (top == bottom) {
+      // the last one, which a thief may be after too
+      if (_top.compare_exchange_strong(top, top + 1,
+                                       std::memory_order_seq_cst,
+                                       std::memory_order_relaxed) == false) {
+        task = nullptr;
+      }
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return task;
+  }
+
+  // anyone.  the oldest task, or null if there's nothing or another thief
+  //  got there first.
+  WorkStealingTask *
+  steal() {
+    int64_t top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = _bottom.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return nullptr;
+    }
+    TaskArray * const array = _array.load(std::memory_order_acquire);
+    WorkStealingTask * const task = array->get(top);
+    if (_top.compare_exchange_strong(top, top + 1,
+                                     std::memory_order_seq_cst,
+                                     std::memory_order_relaxed) == false) {
+      return nullptr;
+    }
+    return task;
+  }
+
+private:
+
+  static const size_t InitialCapacity = 256;
+
+  struct TaskArray {
+
+    TaskArray(const size_t capacity) :
+      _capacity(capacity),
+      _tasks(new std::atomic<WorkStealingTask *>[capacity]) {
+    }
+
+    WorkStealingTask *
+    get(const int64_t index) const {
+      return _tasks[index & (_capacity - 1)].load(std::memory_order_relaxed);
+    }
+
+    void
+    put(const int64_t index,
+        WorkStealingTask * const task) {
+      _tasks[index & (_capacity - 1)].store(task, std::memory_order_relaxed);
+    }
+
+    const size_t _capacity;
+    std::unique_ptr<std::atomic<WorkStealingTask *>[]> _tasks;
+  };
+
+  WorkStealingDeque(const WorkStealingDeque &);
+  WorkStealingDeque & operator=(const WorkStealingDeque &);
+
+  TaskArray *
+  grow(TaskArray * const array,
+       const int64_t top,
+       const int64_t bottom) {
+    TaskArray * const biggerArray = new TaskArray(2 * array->_capacity);
+    _arrays.push_back(std::unique_ptr<TaskArray>(biggerArray));
+    for (int64_t index = top; index < bottom; ++index) {
+      biggerArray->put(index, array->get(index));
+    }
+    _array.store(biggerArray, std::memory_order_release);
+    return biggerArray;
+  }
+
+  // the thieves hammer on the top and the owner on the bottom, so they're
+  //  on different cache lines
+  std::atomic<int64_t> _top;
+  char _topPadding[64];
+  std::atomic<int64_t> _bottom;
+  char _bottomPadding[64];
+  std::atomic<TaskArray *> _array;
+  // every array that it's had, since thieves may still be reading an old
+  //  one
+  vector<std::unique_ptr<TaskArray> > _arrays;
+};
+
+class WorkStealingPool {
+public:
+
+  static
+  WorkStealingPool &
+  getInstance() {
+    static WorkStealingPool workStealingPool;
+    return workStealingPool;
+  }
+
+  // the calling thread is worker 0, so this starts numberOfThreads - 1
+  //  threads, pinned to the placement if there is one
+  void
+  start(const unsigned int numberOfThreads,
+        const vector<int> & placement) {
+    stop();
+    _placement = placement;
+    _stopping = false;
+    for (unsigned int workerIndex = 0;
+         workerIndex < std::max(1u, numberOfThreads); ++workerIndex) {
+      _workers.push_back(std::unique_ptr<Worker>(new Worker(workerIndex)));
+    }
+    if (_placement.empty() == false) {
+      HardwareTopology::getInstance().pinCurrentThread(_placement[0]);
+    }
+    for (unsigned int workerIndex = 1;
+         workerIndex < _workers.size(); ++workerIndex) {
+      _threads.push_back(std::thread(&WorkStealingPool::runWorker, this,
+                                     workerIndex));
+    }
+  }
+
+  void
+  stop() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stopping = true;
+    }
+    _wakeUp.notify_all();
+    for (std::thread & thread : _threads) {
+      thread.join();
+    }
+    _threads.clear();
+    _workers.clear();
+  }
+
+  unsigned int
+  getNumberOfThreads() const {
+    return _workers.size();
+  }
+
+  // which of the workers this is, for indexing per-thread partials from
+  //  inside a loop
+  static
+  unsigned int
+  getCurrentWorkerIndex() {
+    return getCurrentWorker()->_workerIndex;
+  }
+
+  // counted over all of the workers since the last reset
+  uint64_t
+  getNumberOfSpawns() const {
+    uint64_t numberOfSpawns = 0;
+    for (const std::unique_ptr<Worker> & worker : _workers) {
+      numberOfSpawns += worker->_numberOfSpawns.load();
+    }
+    return numberOfSpawns;
+  }
+
+  uint64_t
+  getNumberOfSteals() const {
+    uint64_t numberOfSteals = 0;
+    for (const std::unique_ptr<Worker> & worker : _workers) {
+      numberOfSteals += worker->_numberOfSteals.load();
+    }
+    return numberOfSteals;
+  }
+
+  void
+  resetCounts() {
+    for (const std::unique_ptr<Worker> & worker : _workers) {
+      worker->_numberOfSpawns.store(0);
+      worker->_numberOfSteals.store(0);
+    }
+  }
+
+  // runs the function with the calling thread as worker 0 and the others
+  //  stealing, or just runs it if this thread is already one of the
+  //  workers, as in a nested loop
+  template <class Function>
+  void
+  run(const Function & function) {
+    if (_workers.empty() == true) {
+      fprintf(stderr, "the work-stealing pool hasn't been started\n");
+      exit(1);
+    }
+    if (getCurrentWorker() != nullptr) {
+      function();
+      return;
+    }
+    getCurrentWorker() = _workers[0].get();
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _active.store(true);
+    }
+    _wakeUp.notify_all();
+    function();
+    _active.store(false);
+    getCurrentWorker() = nullptr;
+  }
+
+  // owner only: puts the task where the owner will pop it and thieves can
+  //  steal it
+  void
+  spawn(WorkStealingTask * const task) {
+    Worker * const worker = getCurrentWorker();
+    worker->_deque.push(task);
+    worker->_numberOfSpawns.store(
+      worker->_numberOfSpawns.load(std::memory_order_relaxed) + 1,
+      std::memory_order_relaxed);
+  }
+
+  // waits for a task that this worker spawned.  if nobody stole it, it's
+  //  still on top of the deque and runs here; if someone did, this worker
+  //  steals other work until it's done.
+  void
+  wait(WorkStealingTask * const task) {
+    Worker * const worker = getCurrentWorker();
+    WorkStealingTask * const topTask = worker->_deque.pop();
+    if (topTask == task) {
+      execute(task);
+      return;
+    }
+    // what's left underneath belongs to the tasks that we're inside of
+    if (topTask != nullptr) {
+      worker->_deque.push(topTask);
+    }
+    while (task->_done.load(std::memory_order_acquire) == false) {
+      WorkStealingTask * const stolenTask = trySteal(worker);
+      if (stolenTask != nullptr) {
+        execute(stolenTask);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+private:
+
+  struct Worker {
+
+    Worker(const unsigned int workerIndex) :
+      _workerIndex(workerIndex),
+      _numberOfSpawns(0),
+      _numberOfSteals(0),
+      _randomState(0x9E3779B97F4A7C15ULL * (workerIndex + 1)) {
+    }
+
+    const unsigned int _workerIndex;
+    WorkStealingDeque _deque;
+    std::atomic<uint64_t> _numberOfSpawns;
+    std::atomic<uint64_t> _numberOfSteals;
+    // picks the victims
+    uint64_t _randomState;
+    char _padding[64];
+  };
+
+  WorkStealingPool() :
+    _active(false),
+    _stopping(false) {
+  }
+
+  ~WorkStealingPool() {
+    stop();
+  }
+
+  WorkStealingPool(const WorkStealingPool &);
+  WorkStealingPool & operator=(const WorkStealingPool &);
+
+  static
+  Worker * &
+  getCurrentWorker() {
+    static thread_local Worker * worker = nullptr;
+    return worker;
+  }
+
+  static
+  void
+  execute(WorkStealingTask * const task) {
+    task->_execute(task);
+    // the task lives on the stack of whoever's waiting for it, so this is
+    //  the last time that it's touched
+    task->_done.store(true, std::memory_order_release);
+  }
+
+  // one pass over the other workers, starting at a random one
+  WorkStealingTask *
+  trySteal(Worker * const thief) {
+    const unsigned int numberOfWorkers = _workers.size();
+    if (numberOfWorkers == 1) {
+      return nullptr;
+    }
+    uint64_t & state = thief->_randomState;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    const unsigned int firstVictim = state % numberOfWorkers;
+    for (unsigned int attempt = 0; attempt < numberOfWorkers; ++attempt) {
+      const unsigned int victimIndex =
+        (firstVictim + attempt) % numberOfWorkers;
+      if (victimIndex == thief->_workerIndex) {
+        continue;
+      }
+      WorkStealingTask * const task = _workers[victimIndex]->_deque.steal();
+      if (task != nullptr) {
+        thief->_numberOfSteals.store(
+          thief->_numberOfSteals.load(std::memory_order_relaxed) + 1,
+          std::memory_order_relaxed);
+        return task;
+      }
+    }
+    return nullptr;
+  }
+
+  // steal while a loop is running, and sleep while none is
+  void
+  runWorker(const unsigned int workerIndex) {
+    if (_placement.empty() == false) {
+      HardwareTopology::getInstance().pinCurrentThread(
+        _placement[workerIndex % _placement.size()]);
+    }
+    Worker * const worker = _workers[workerIndex].get();
+    getCurrentWorker() = worker;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wakeUp.wait(lock, [this] () {
+            return _active.load() == true || _stopping == true;
+          });
+        if (_stopping == true) {
+          return;
+        }
+      }
+      while (_active.load(std::memory_order_acquire) == true) {
+        WorkStealingTask * const task = trySteal(worker);
+        if (task != nullptr) {
+          execute(task);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    }
+  }
+
+  vector<std::unique_ptr<Worker> > _workers;
+  vector<std::thread> _threads;
+  vector<int> _placement;
+  // whether a loop is running
+  std::atomic<bool> _active;
+  bool _stopping;
+  std::mutex _mutex;
+  std::condition_variable _wakeUp;
+};
+
+// starts the pool for one test's number of threads, like tbb's
+//  global_control.  the calling thread is worker 0, so it gets its own cpus
+//  back when the pool stops.
+class WorkStealingPoolInit {
+public:
+
+  WorkStealingPoolInit(const unsigned int numberOfThreads,
+                       const vector<int> & placement) {
+    WorkStealingPool::getInstance().start(numberOfThreads, placement);
+  }
+
+  ~WorkStealingPoolInit() {
+    WorkStealingPool::getInstance().stop();
+  }
+
+private:
+  WorkStealingPoolInit(const WorkStealingPoolInit &);
+  WorkStealingPoolInit & operator=(const WorkStealingPoolInit &);
+
+  // destroyed after the pool stops
+  const SavedThreadCpus _callerCpus;
+};
+
+template <class Index, class Body>
+struct StealingForTask : public WorkStealingTask {
+
+  StealingForTask(const Index beginIndex,
+                  const Index endIndex,
+                  const Index grainSize,
+                  const Body & body) :
+    WorkStealingTask(&StealingForTask::executeTask),
+    _beginIndex(beginIndex),
+    _endIndex(endIndex),
+    _grainSize(grainSize),
+    _body(body) {
+  }
+
+  static
+  void
+  executeTask(WorkStealingTask * const task);
+
+  const Index _beginIndex;
+  const Index _endIndex;
+  const Index _grainSize;
+  const Body & _body;
+};
+
+template <class Index, class Body>
+void
+runStealingForRange(const Index beginIndex,
+                    const Index endIndex,
+                    const Index grainSize,
+                    const Body & body) {
+  if (endIndex - beginIndex <= grainSize) {
+    const BusyChunk chunk;
+    body(beginIndex, endIndex);
+    return;
+  }
+  WorkStealingPool & pool = WorkStealingPool::getInstance();
+  const Index middleIndex = beginIndex + (endIndex - beginIndex) / 2;
+  StealingForTask<Index, Body> rightHalf(middleIndex, endIndex, grainSize,
+                                         body);
+  pool.spawn(&rightHalf);
+  runStealingForRange(beginIndex, middleIndex, grainSize, body);
+  pool.wait(&rightHalf);
+}
+
+template <class Index, class Body>
+void
+StealingForTask<Index, Body>::executeTask(WorkStealingTask * const task) {
+  const StealingForTask & forTask = *static_cast<StealingForTask *>(task);
+  runStealingForRange(forTask._beginIndex, forTask._endIndex,
+                      forTask._grainSize, forTask._body);
+}
+
+template <class Index, class Value, class Body, class Join>
+struct StealingReduceTask : public WorkStealingTask {
+
+  StealingReduceTask(const Index beginIndex,
+                     const Index endIndex,
+                     const Index grainSize,
+                     const Value & identity,
+                     const Body & body,
+                     const Join & join) :
+    WorkStealingTask(&StealingReduceTask::executeTask),
+    _beginIndex(beginIndex),
+    _endIndex(endIndex),
+    _grainSize(grainSize),
+    _identity(identity),
+    _body(body),
+    _join(join),
+    _result(identity) {
+  }
+
+  static
+  void
+  executeTask(WorkStealingTask * const task);
+
+  const Index _beginIndex;
+  const Index _endIndex;
+  const Index _grainSize;
+  const Value & _identity;
+  const Body & _body;
+  const Join & _join;
+  Value _result;
+};
+
+template <class Index, class Value, class Body, class Join>
+Value
+runStealingReduceRange(const Index beginIndex,
+                       const Index endIndex,
+                       const Index grainSize,
+                       const Value & identity,
+                       const Body & body,
+                       const Join & join) {
+  if (endIndex - beginIndex <= grainSize) {
+    const BusyChunk chunk;
+    return body(beginIndex, endIndex, identity);
+  }
+  WorkStealingPool & pool = WorkStealingPool::getInstance();
+  const Index middleIndex = beginIndex + (endIndex - beginIndex) / 2;
+  StealingReduceTask<Index, Value, Body, Join>
+    rightHalf(middleIndex, endIndex, grainSize, identity, body, join);
+  pool.spawn(&rightHalf);
+  const Value leftResult =
+    runStealingReduceRange(beginIndex, middleIndex, grainSize, identity,
+                           body, join);
+  pool.wait(&rightHalf);
+  return join(leftResult, rightHalf._result);
+}
+
+template <class Index, class Value, class Body, class Join>
+void
+StealingReduceTask<Index, Value, Body, Join>::executeTask(
+  WorkStealingTask * const task) {
+  StealingReduceTask & reduceTask = *static_cast<StealingReduceTask *>(task);
+  reduceTask._result =
+    runStealingReduceRange(reduceTask._beginIndex, reduceTask._endIndex,
+                           reduceTask._grainSize, reduceTask._identity,
+                           reduceTask._body, reduceTask._join);
+}
+
+// body(beginIndex, endIndex) for pieces of [beginIndex, endIndex) no
+//  bigger than the grain size, whatever --grain-size says.  this is for
+//  loops whose bodies run parallel loops of their own, like the outer loop
+//  of nested parallelism, whose pieces aren't in the same units as the
+//  leaves' that --grain-size is tuned for.
+template <class Index, class Body>
+void
+stealingParallelForWithGrainSize(const Index beginIndex,
+                                 const Index endIndex,
+                                 const Index grainSize,
+                                 const Body & body) {
+  if (endIndex <= beginIndex) {
+    return;
+  }
+  WorkStealingPool::getInstance().run([&] () {
+      runStealingForRange(beginIndex, endIndex, std::max(Index(1), grainSize),
+                          body);
+    });
+}
+
+// the same, for the loops that do the work, with the grain size that
+//  --grain-size overrides
+template <class Index, class Body>
+void
+stealingParallelFor(const Index beginIndex,
+                    const Index endIndex,
+                    const Index defaultGrainSize,
+                    const Body & body) {
+  const unsigned int grainSizeOption =
+    LoadBalance::getInstance().getSchedulingOptions()._grainSize;
+  stealingParallelForWithGrainSize(beginIndex, endIndex,
+                                   (grainSizeOption > 0) ?
+                                   Index(grainSizeOption) : defaultGrainSize,
+                                   body);
+}
+
+// body(beginIndex, endIndex, identity) returns the piece's value, and
+//  join(left, right) combines the values of neighboring pieces
+template <class Index, class Value, class Body, class Join>
+Value
+stealingParallelReduce(const Index beginIndex,
+                       const Index endIndex,
+                       const Index defaultGrainSize,
+                       const Value & identity,
+                       const Body & body,
+                       const Join & join) {
+  const unsigned int grainSizeOption =
+    LoadBalance::getInstance().getSchedulingOptions()._grainSize;
+  const Index grainSize = std::max(Index(1), (grainSizeOption > 0) ?
+                                   Index(grainSizeOption) : defaultGrainSize);
+  if (endIndex <= beginIndex) {
+    return identity;
+  }
+  Value result = identity;
+  WorkStealingPool::getInstance().run([&] () {
+      result = runStealingReduceRange(beginIndex, endIndex, grainSize,
+                                      identity, body, join);
+    });
+  return result;
+}
+
+}
+
+#endif // WORK_STEALING_POOL_H
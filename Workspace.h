@@ -0,0 +1,190 @@
+// -*- C++ -*-
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+// scratch memory that outlives a single call to computeAnswer.  a functor
+//  asks the workspace for its buffers, per-thread partials and kokkos views
+//  by name on every call, and gets the same ones back on every repeat after
+//  the first, so allocation, first touch and view initialization happen
+//  once per test instead of inside every timed repeat.  the harness empties
+//  the workspace before and after each test, and keeps the time it spends
+//  making things out of the repeats' times and reports it as the setup
+//  time.
+//
+//   Utilities::Workspace & workspace = Utilities::Workspace::getInstance();
+//   double * partialSums =
+//     workspace.getBuffer<double>("partial sums", numberOfChunks);
+//
+//  it isn't thread-safe, so ask for everything before the parallel part.
+//
+//  it's for what computeAnswer itself makes, like the batched kokkos
+//  integrator's host mirror of its answers.  inputs that don't change from
+//  one repeat to the next, like that integrator's bounds, are copied to the
+//  device once in the functor's constructor instead, which runs before the
+//  test's repeats and isn't counted in its setup time.  the other kokkos
+//  functors reduce straight into host scalars and make no views at all.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <map>
+#include <memory>
+#include <typeinfo>
+#include <algorithm>
+
+// header files for omp
+#include <omp.h>
+
+namespace Utilities {
+
+// per-thread partials are padded out to this, so that no two threads
+//  write to the same cache line
+const size_t WorkspaceAlignment = 64;
+
+template <class T>
+struct PerThreadBuffer {
+
+  PerThreadBuffer(T * const entries,
+                  const size_t stride) :
+    _entries(entries),
+    _stride(stride) {
+  }
+
+  T *
+  operator[](const unsigned int threadIndex) const {
+    return _entries + threadIndex * _stride;
+  }
+
+  T * _entries;
+  // entries from the start of one thread's row to the next
+  size_t _stride;
+};
+
+class Workspace {
+public:
+
+  static
+  Workspace &
+  getInstance() {
+    static Workspace workspace;
+    return workspace;
+  }
+
+  // numberOfEntries aligned and zeroed entries the first time they're asked
+  //  for, or when more of them are asked for than last time.  otherwise
+  //  it's the same memory, with whatever the last repeat left in it.
+  template <class T>
+  T *
+  getBuffer(const string & name,
+            const size_t numberOfEntries) {
+    const size_t numberOfBytes = numberOfEntries * sizeof(T);
+    Slot & slot = findSlot(name, typeid(T));
+    if (slot._object == nullptr || slot._numberOfBytes < numberOfBytes) {
+      const double tic = omp_get_wtime();
+      void * memory = NULL;
+      const size_t allocatedBytes =
+        std::max(numberOfBytes, WorkspaceAlignment);
+      if (posix_memalign(&memory, WorkspaceAlignment, allocatedBytes) != 0) {
+        fprintf(stderr, "cannot allocate %zu bytes for workspace buffer %s\n",
+                allocatedBytes, name.c_str());
+        exit(1);
+      }
+      memset(memory, 0, allocatedBytes);
+      slot._object.reset(memory, free);
+      slot._numberOfBytes = allocatedBytes;
+      _setupTime += omp_get_wtime() - tic;
+    }
+    return static_cast<T *>(slot._object.get());
+  }
+
+  // a row of numberOfEntries for each thread, each row starting on its own
+  //  cache line
+  template <class T>
+  PerThreadBuffer<T>
+  getPerThreadBuffer(const string & name,
+                     const unsigned int numberOfThreads,
+                     const size_t numberOfEntries) {
+    const size_t entriesPerLine =
+      std::max(size_t(1), WorkspaceAlignment / sizeof(T));
+    const size_t stride =
+      ((numberOfEntries + entriesPerLine - 1) / entriesPerLine) *
+      entriesPerLine;
+    return PerThreadBuffer<T>(getBuffer<T>(name, numberOfThreads * stride),
+                              stride);
+  }
+
+  // anything else that's expensive to make, like a kokkos view or its host
+  //  mirror.  the factory makes it the first time; after that it's the one
+  //  that was made, so the name has to say everything that it depends on.
+  template <class T, class Factory>
+  T &
+  getObject(const string & name,
+            const Factory & factory) {
+    Slot & slot = findSlot(name, typeid(T));
+    if (slot._object == nullptr) {
+      const double tic = omp_get_wtime();
+      slot._object = std::make_shared<T>(factory());
+      slot._numberOfBytes = sizeof(T);
+      _setupTime += omp_get_wtime() - tic;
+    }
+    return *static_cast<T *>(slot._object.get());
+  }
+
+  // seconds spent allocating and making things since the last release
+  double
+  getSetupTime() const {
+    return _setupTime;
+  }
+
+  // frees everything.  the harness does this at the end of every test,
+  //  which also gets rid of any kokkos views before kokkos is finalized.
+  void
+  release() {
+    _slots.clear();
+    _setupTime = 0;
+  }
+
+private:
+
+  struct Slot {
+
+    Slot() :
+      _type(nullptr),
+      _numberOfBytes(0) {
+    }
+
+    // the only thing that knows how to destroy what's in here
+    std::shared_ptr<void> _object;
+    const std::type_info * _type;
+    size_t _numberOfBytes;
+  };
+
+  Workspace() :
+    _setupTime(0) {
+  }
+
+  Workspace(const Workspace &);
+  Workspace & operator=(const Workspace &);
+
+  Slot &
+  findSlot(const string & name,
+           const std::type_info & type) {
+    Slot & slot = _slots[name];
+    if (slot._type == nullptr) {
+      slot._type = &type;
+    } else if (*slot._type != type) {
+      fprintf(stderr, "workspace entry %s was asked for as two different "
+              "types\n", name.c_str());
+      exit(1);
+    }
+    return slot;
+  }
+
+  std::map<string, Slot> _slots;
+  double _setupTime;
+};
+
+}
+
+#endif // WORKSPACE_H